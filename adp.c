@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "mdp.h"
+#include "environment.h"
+#include "runner.h"
+#include "adp_agent.h"
+
+/* Process command-line arguments, verifying usage */
+void
+process_args (int argc, char * argv[], double * gamma, unsigned int * trials,
+              unsigned int * replicas, double * epsilon );
+  
+/*
+ * Usage: adp gamma mdpfile trials [replicas [epsilon]] < policy
+ *
+ * Runs Passive-ADP-Agent in an environment for the given number of trials
+ * on a fixed policy read from standard input.
+ *
+ * After each step the agent re-evaluates the policy in the model it has
+ * learned, propagating utility changes larger than epsilon (default
+ * ADP_DEFAULT_EPSILON) from the state whose transitions changed.
+ *
+ * With replicas, that many independent agents (each with its own random
+ * number stream) run concurrently, one per processor, and the utilities
+ * printed are their means. One replica is the same as a single agent.
+ *
+ * Trials are capped at MDP_MAX_EPISODE_STEPS steps and each replica's run
+ * at MDP_RUN_SECONDS seconds when those are set; a warning reports any
+ * trials cut short.
+ *
+ * When MDP_CONVERGE_WINDOW is set, a replica stops once that many
+ * consecutive trials have changed no utility by more than
+ * MDP_CONVERGE_TOLERANCE (default CONVERGE_DEFAULT_TOLERANCE); the trial
+ * at which each replica converged is reported.
+ *
+ * When MDP_TRAJLOG is set, each replica's experience is recorded to that
+ * trajectory log (suffixed with the replica number when there are
+ * several), which trajplay can replay.
+ */
+int
+main (int argc, char* argv[])
+{
+  // Read and process configurations
+  double gamma, epsilon;
+  unsigned int trials, replicas;
+
+  process_args (argc, argv, &gamma, &trials, &replicas, &epsilon);
+
+  // Initialize environment
+  environment * p_env = env_create (argv[2]);
+  mdp * p_mdp = env_get_structure (p_env);
+
+  // Read policy from stdin
+  unsigned int * policy = malloc ( sizeof(unsigned int) * p_mdp->numStates );
+
+  if (NULL == policy)
+  {
+    fprintf (stderr, "%s: Unable to allocate policy (%s)\n", argv[0],
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  mdp_read_policy (stdin, p_mdp, policy);
+  
+  // Run Passive-ADP-Agent replicas!
+  adp_agent_config config = { gamma, policy, epsilon };
+  rl_agent_factory factory = adp_agent_factory (&config, p_env);
+  runner_options opts = runner_default_options ();
+
+  opts.replicas = replicas;
+  opts.trials = trials;
+
+  runner_result * p_result = runner_run (p_env, &factory, &opts);
+
+  if (p_result->truncated > 0 || p_result->timeouts > 0)
+    fprintf (stderr, "%s: Warning: %llu trials truncated and %llu replicas "
+             "stopped by limits\n", argv[0], p_result->truncated,
+             p_result->timeouts);
+
+  runner_print_convergence (stderr, argv[0], p_result);
+
+  // Print utilities
+  unsigned int state;
+  for ( state=0 ; state < p_mdp->numStates ; state++)
+    if (p_mdp->numAvailableActions[state] > 0 || p_mdp->terminal[state] )
+      printf ("%1.3f\n", p_result->mean[state]);
+    else
+      printf("X\n");
+
+  runner_result_free (p_result);
+  free (policy);
+  mdp_free (p_mdp);
+  env_free (p_env);
+} // main
+
+
+/* Process command-line arguments, verifying usage */
+void
+process_args (int argc, char * argv[], double * gamma, unsigned int * trials,
+              unsigned int * replicas, double * epsilon )
+{
+  if (argc < 4 || argc > 6)
+  {
+    fprintf (stderr,"Usage: %s gamma mdpfile trials [replicas [epsilon]]\n",
+             argv[0]);
+    exit (EXIT_FAILURE);
+  }
+  
+  char * endptr; // String End Location for number parsing
+
+  // Read gamma, the discount factor, as a double
+  *gamma = strtod (argv[1], &endptr);
+
+  if ( (endptr - argv[1])/sizeof(char) < strlen (argv[1]) )
+  {
+    fprintf (stderr, "%s: Illegal non-numeric value in argument gamma=%s\n",
+             argv[0], argv[1]);
+    exit (EXIT_FAILURE);
+  }
+
+  // Read trials, number of times to run as an unsigned integer
+  *trials = (unsigned int)strtol (argv[3], &endptr,10);
+
+  if ( (endptr - argv[3])/sizeof(char) < strlen (argv[3]) )
+  {
+    fprintf (stderr, "%s: Illegal non-numeric value in argument trials=%s\n",
+             argv[0], argv[3]);
+    exit (EXIT_FAILURE);
+  }
+
+  // Read replicas, number of independent agents, as an unsigned integer
+  *replicas = 1;
+
+  if (argc >= 5)
+  {
+    *replicas = (unsigned int)strtol (argv[4], &endptr,10);
+
+    if ( (endptr - argv[4])/sizeof(char) < strlen (argv[4]) ||
+         0 == *replicas )
+    {
+      fprintf (stderr, "%s: Illegal value in argument replicas=%s\n",
+               argv[0], argv[4]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+  // Read epsilon, the largest change not propagated, as a double
+  *epsilon = ADP_DEFAULT_EPSILON;
+
+  if (6 == argc)
+  {
+    *epsilon = strtod (argv[5], &endptr);
+
+    if ( (endptr - argv[5])/sizeof(char) < strlen (argv[5]) ||
+         *epsilon <= 0 )
+    {
+      fprintf (stderr, "%s: Illegal value in argument epsilon=%s\n",
+               argv[0], argv[5]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+} // process_args
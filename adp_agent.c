@@ -0,0 +1,213 @@
+/*
+ * File
+ *   adp_agent.c
+ *
+ * Summary
+ *   Passive adaptive dynamic programming agent instances.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "mdp.h"
+#include "model.h"
+#include "pqueue.h"
+#include "policy_evaluation.h"
+#include "environment.h"
+#include "runner.h"
+#include "adp_agent.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+adp_agent *
+adp_agent_create (mdp * p_mdp, double gamma, double epsilon)
+{
+  adp_agent * p_agent = malloc (sizeof(adp_agent));
+
+  if (NULL == p_agent)
+  {
+    fprintf (stderr, "adp_agent_create: Unable to allocate agent (%s)",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  p_agent->p_mdp = p_mdp;   // Assign MDP object
+  p_agent->gamma = gamma; // Set other constants
+  p_agent->epsilon = epsilon;
+
+  // Allocate policy
+  p_agent->policy = malloc ( sizeof(unsigned int) * p_mdp->numStates );
+
+  if (NULL == p_agent->policy)
+  {
+    fprintf (stderr, "adp_agent_create: Unable to allocate policy (%s)",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  // Allocate utilities (zeroed by calloc)
+  p_agent->utilities = calloc ( p_mdp->numStates, sizeof(double) );
+
+  if (NULL == p_agent->utilities)
+  {
+    fprintf (stderr, "adp_agent_create: Unable to allocate utilities (%s)",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  // Counts of the transitions observed, and evaluation workspace
+  p_agent->p_model = model_create (p_mdp->numStates, p_mdp->numActions);
+  p_agent->p_queue = pqueue_create (p_mdp->numStates);
+
+  // Indicate no previous state
+  p_agent->prevValid = false;
+
+  return p_agent;
+} // adp_agent_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+adp_agent_free (adp_agent * p_agent)
+{
+  free (p_agent->policy);
+  free (p_agent->utilities);
+  model_free (p_agent->p_model);
+  pqueue_free (p_agent->p_queue);
+  mdp_free (p_agent->p_mdp);
+  free (p_agent);
+} // adp_agent_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int
+adp_agent_action (void * context, unsigned int state, double reward)
+{
+  adp_agent * p_agent = context;
+  const mdp * p_mdp = p_agent->p_mdp;
+  const learned_model * p_model = p_agent->p_model;
+  unsigned int action = p_agent->policy[state];
+
+  // A state never left (e.g., a terminal state) is estimated by its
+  // reward alone
+  if (MDP_IS_TERMINAL(p_mdp, state) ||
+      0 == p_model->pairs[state * p_model->numActions + action].total)
+    p_agent->utilities[state] = reward;
+
+  if (p_agent->prevValid) {
+    model_observe (p_agent->p_model, p_agent->prevState, p_agent->prevAction,
+                   state, p_agent->prevReward);
+
+    // Only the previous state's equation changed
+    policy_evaluation_local (p_agent->policy, p_model, p_agent->prevState,
+                             p_agent->epsilon, p_agent->gamma,
+                             p_agent->utilities, p_agent->p_queue);
+  }
+
+  if (MDP_IS_TERMINAL(p_mdp, state)) {
+    p_agent->prevValid = false;
+  } else {
+    p_agent->prevState = state;
+    p_agent->prevAction = action;
+    p_agent->prevReward = reward;
+    p_agent->prevValid = true;
+  }
+
+  return action; // Return the policy action for the state
+} // adp_agent_action
+
+
+/*  Procedure
+ *    adp_agent_truncate
+ *
+ *  Purpose
+ *    Forget the previous state when a trial is cut short, since it has no
+ *    successor
+ */
+static void
+adp_agent_truncate (void * context)
+{
+  adp_agent * p_agent = context;
+
+  p_agent->prevValid = false;
+} // adp_agent_truncate
+
+
+////////////////////////////////////////////////////////////////////////////////
+rl_agent
+adp_agent_interface (adp_agent * p_agent)
+{
+  rl_agent agent = { p_agent, adp_agent_action, adp_agent_truncate };
+
+  return agent;
+} // adp_agent_interface
+
+
+/*  Procedure
+ *    factory_create
+ *
+ *  Purpose
+ *    Create a replica from an adp_agent_config
+ */
+static rl_agent
+factory_create (void * config, const environment * p_env)
+{
+  const adp_agent_config * p_config = config;
+  adp_agent * p_agent = adp_agent_create (env_get_structure (p_env),
+                                          p_config->gamma,
+                                          p_config->epsilon);
+
+  memcpy (p_agent->policy, p_config->policy,
+          sizeof(unsigned int) * p_agent->p_mdp->numStates);
+
+  return adp_agent_interface (p_agent);
+} // factory_create
+
+
+/*  Procedure
+ *    factory_values
+ *
+ *  Purpose
+ *    Report a replica's utilities
+ */
+static void
+factory_values (void * context, double * values)
+{
+  const adp_agent * p_agent = context;
+
+  memcpy (values, p_agent->utilities,
+          sizeof(double) * p_agent->p_mdp->numStates);
+} // factory_values
+
+
+/*  Procedure
+ *    factory_destroy
+ *
+ *  Purpose
+ *    Release a replica
+ */
+static void
+factory_destroy (void * context)
+{
+  adp_agent_free (context);
+} // factory_destroy
+
+
+////////////////////////////////////////////////////////////////////////////////
+rl_agent_factory
+adp_agent_factory (adp_agent_config * p_config, const environment * p_env)
+{
+  rl_agent_factory factory;
+
+  factory.config = p_config;
+  factory.valueLength = p_env->p_mdp->numStates;
+  factory.valueWidth = 1;
+  factory.create = factory_create;
+  factory.values = factory_values;
+  factory.destroy = factory_destroy;
+
+  return factory;
+} // adp_agent_factory
@@ -0,0 +1,181 @@
+/*
+ * File
+ *   adp_agent.h
+ *
+ * Summary
+ *   A passive adaptive dynamic programming agent (Passive-ADP-Agent of
+ *   Russell & Norvig, Artificial Intelligence, 2010, p. 834) following a
+ *   fixed policy. It learns the transition model of the policy from
+ *   counts kept in a sparse model (see model.h) and, after each step,
+ *   re-evaluates the policy in it. Since only one state's transitions
+ *   change per step, the evaluation starts from the previous utilities
+ *   and updates only the states that change reaches
+ *   (policy_evaluation_local), rather than solving for all of them anew.
+ *   Each agent owns its state, so several may run at once.
+ *
+ */
+#ifndef __ADP_AGENT_H__
+#define __ADP_AGENT_H__
+
+#include <stdbool.h>
+
+#include "mdp.h"
+#include "model.h"
+#include "pqueue.h"
+#include "environment.h"
+#include "runner.h"
+
+/* Largest utility change ignored unless configured otherwise */
+#define ADP_DEFAULT_EPSILON 1e-6
+
+typedef struct {
+  mdp *         p_mdp;      /* MDP to operate on/in */
+  double        gamma;      /* Discount factor to use */
+  double        epsilon;    /* Largest utility change not propagated */
+  unsigned int* policy;     /* Policy: array of actions for each state */
+  double *      utilities;  /* Array of utilities */
+  learned_model * p_model;  /* Transitions and rewards observed */
+  pqueue *      p_queue;    /* States awaiting evaluation */
+  unsigned int  prevState;  /* Previous state encountered */
+  unsigned int  prevAction; /* Previous action taken */
+  double        prevReward; /* Previous reward received */
+  bool          prevValid;  /* Whether the previous state-action pair is
+                               valid (i.e., not restarting after terminal
+                               state) */
+} adp_agent;
+
+typedef struct {
+  double gamma;                 /* Discount factor to use */
+  const unsigned int * policy;  /* Policy followed by every agent */
+  double epsilon;               /* Largest utility change not propagated */
+} adp_agent_config;
+
+
+/*  Procedure
+ *    adp_agent_create
+ *
+ *  Purpose
+ *    Create a passive ADP agent using partial MDP information
+ *
+ *  Parameters
+ *    p_mdp
+ *    gamma
+ *    epsilon
+ *
+ *  Produces
+ *    p_agent, an adp_agent*
+ *
+ *  Preconditions
+ *    p_mdp points to a valid MDP struct (as from env_get_structure, so
+ *    its transitionProb may be NULL); the agent takes ownership of it
+ *    0 < gamma < 1
+ *    epsilon > 0
+ *
+ *  Postconditions
+ *    p_agent->policy is an allocated numStates array, to be filled in by
+ *    the caller before running the agent.
+ *    p_agent->utilities is a zeroed numStates array and p_agent->p_model
+ *    has nothing observed.
+ *    p_agent must be released with adp_agent_free.
+ *    Any failure causes program exit.
+ */
+adp_agent *
+adp_agent_create (mdp * p_mdp, double gamma, double epsilon);
+
+
+/*  Procedure
+ *    adp_agent_free
+ *
+ *  Purpose
+ *    Release a passive ADP agent and its MDP
+ *
+ *  Parameters
+ *    p_agent
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_agent was produced by adp_agent_create
+ *
+ *  Postconditions
+ *    All memory for p_agent is freed
+ */
+void
+adp_agent_free (adp_agent * p_agent);
+
+
+/*  Procedure
+ *    adp_agent_action
+ *
+ *  Purpose
+ *    Receive reward for a prior action; indicate action to take in given
+ *    state
+ *
+ *  Parameters
+ *    context
+ *    state
+ *    reward
+ *
+ *  Produces
+ *    action, an unsigned int
+ *
+ *  Preconditions
+ *    context is an adp_agent* produced by adp_agent_create whose policy
+ *    has been filled in
+ *    0 <= state < numStates
+ *
+ *  Postconditions
+ *    U[state] = reward if the policy action of state was never taken.
+ *    The transition from prevState to state was counted, and the
+ *    utilities re-evaluated by policy_evaluation_local from prevState.
+ *    action = policy[state]
+ */
+unsigned int
+adp_agent_action (void * context, unsigned int state, double reward);
+
+
+/*  Procedure
+ *    adp_agent_interface
+ *
+ *  Purpose
+ *    Wrap a passive ADP agent for use with env_run
+ *
+ *  Parameters
+ *    p_agent
+ *
+ *  Produces
+ *    agent, an rl_agent
+ */
+rl_agent
+adp_agent_interface (adp_agent * p_agent);
+
+
+/*  Procedure
+ *    adp_agent_factory
+ *
+ *  Purpose
+ *    Describe how to create passive ADP agent replicas for runner_run
+ *
+ *  Parameters
+ *    p_config
+ *    p_env
+ *
+ *  Produces
+ *    factory, an rl_agent_factory
+ *
+ *  Preconditions
+ *    p_config and p_config->policy outlive any use of factory;
+ *    p_config->policy is a numStates length array of valid actions
+ *    p_env was produced by env_create
+ *
+ *  Postconditions
+ *    Each agent created by factory is adp_agent_create applied to
+ *    env_get_structure of its environment, p_config->gamma and
+ *    p_config->epsilon, with a copy of p_config->policy. Its values are
+ *    the utilities U[s].
+ */
+rl_agent_factory
+adp_agent_factory (adp_agent_config * p_config, const environment * p_env);
+
+#endif // __ADP_AGENT_H__
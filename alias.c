@@ -0,0 +1,176 @@
+/*
+ * File
+ *   alias.c
+ *
+ * Summary
+ *   Construction of Walker alias tables (using Vose's method) for the
+ *   transition distributions of an MDP.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+
+#include "mdp.h"
+#include "alias.h"
+
+
+/*  Procedure
+ *    alias_malloc
+ *
+ *  Purpose
+ *    Allocate memory or exit with a message naming what was requested
+ */
+static void *
+alias_malloc (size_t bytes, const char * what)
+{
+  void * ptr = malloc (bytes);
+
+  if (NULL == ptr)
+  {
+    fprintf (stderr,"alias_build failed: Could not allocate %s (%s)\n",
+             what, strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+  return ptr;
+} // alias_malloc
+
+
+////////////////////////////////////////////////////////////////////////////////
+alias_table *
+alias_build (const mdp * p_mdp)
+{
+  unsigned int S = p_mdp->numStates;
+  unsigned int A = p_mdp->numActions;
+  unsigned int s, a, t, pair;
+
+  alias_table * p_table = alias_malloc (sizeof(alias_table), "alias_table");
+
+  p_table->numStates = S;
+  p_table->numActions = A;
+  p_table->offset = alias_malloc (sizeof(unsigned int) * (S*A + 1), "offset");
+
+  //----------------------------------------
+  // Count successors with nonzero probability (one column each)
+
+  p_table->offset[0] = 0;
+  for (s=0 ; s < S ; s++)
+    for (a=0 ; a < A ; a++)
+    {
+      unsigned int n = 0;
+
+      for (t=0 ; t < S ; t++)
+        if (p_mdp->transitionProb[t][s][a] > 0)
+          n++;
+
+      pair = s * A + a;
+      p_table->offset[pair+1] = p_table->offset[pair] + n;
+    }
+
+  unsigned int numColumns = p_table->offset[S*A];
+
+  // Allocate at least one column so an empty table has valid arrays
+  p_table->outcome = alias_malloc (sizeof(unsigned int) * (numColumns+1),
+                                   "outcome");
+  p_table->alias = alias_malloc (sizeof(unsigned int) * (numColumns+1),
+                                 "alias");
+  p_table->threshold = alias_malloc (sizeof(double) * (numColumns+1),
+                                     "threshold");
+
+  // Scratch: scaled probabilities and work lists of one pair's columns
+  double * scaled = alias_malloc (sizeof(double) * S, "scaled");
+  unsigned int * small = alias_malloc (sizeof(unsigned int) * S, "small");
+  unsigned int * large = alias_malloc (sizeof(unsigned int) * S, "large");
+
+  //----------------------------------------
+  // Build each pair's columns
+
+  for (pair=0 ; pair < S*A ; pair++)
+  {
+    unsigned int first = p_table->offset[pair];
+    unsigned int n = p_table->offset[pair+1] - first;
+    unsigned int numSmall = 0, numLarge = 0;
+    unsigned int i;
+    double total = 0.0;
+
+    if (0 == n)
+      continue;
+
+    s = pair / A;
+    a = pair % A;
+
+    // Gather successors and normalize (probabilities may not sum to one)
+    i = 0;
+    for (t=0 ; t < S ; t++)
+      if (p_mdp->transitionProb[t][s][a] > 0)
+      {
+        p_table->outcome[first+i] = t;
+        scaled[i] = p_mdp->transitionProb[t][s][a];
+        total += scaled[i];
+        i++;
+      }
+
+    // Scale so the average column holds probability one
+    for (i=0 ; i < n ; i++)
+    {
+      scaled[i] *= n / total;
+
+      if (scaled[i] < 1.0)
+        small[numSmall++] = i;
+      else
+        large[numLarge++] = i;
+    }
+
+    // Pair each under-full column with an over-full one, which donates
+    // the remainder of the under-full column's probability
+    while (numSmall > 0 && numLarge > 0)
+    {
+      unsigned int l = small[--numSmall];
+      unsigned int g = large[numLarge-1];
+
+      p_table->threshold[first+l] = scaled[l];
+      p_table->alias[first+l] = p_table->outcome[first+g];
+
+      scaled[g] -= 1.0 - scaled[l];
+
+      if (scaled[g] < 1.0)
+      {
+        numLarge--;
+        small[numSmall++] = g;
+      }
+    }
+
+    // Remaining columns are full (up to round-off)
+    while (numLarge > 0)
+    {
+      unsigned int g = large[--numLarge];
+      p_table->threshold[first+g] = 1.0;
+      p_table->alias[first+g] = p_table->outcome[first+g];
+    }
+    while (numSmall > 0)
+    {
+      unsigned int l = small[--numSmall];
+      p_table->threshold[first+l] = 1.0;
+      p_table->alias[first+l] = p_table->outcome[first+l];
+    }
+  }
+
+  free (scaled);
+  free (small);
+  free (large);
+
+  return p_table;
+} // alias_build
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+alias_free (alias_table * p_table)
+{
+  free (p_table->offset);
+  free (p_table->outcome);
+  free (p_table->alias);
+  free (p_table->threshold);
+  free (p_table);
+} // alias_free
@@ -0,0 +1,126 @@
+/*
+ * File
+ *   alias.h
+ *
+ * Summary
+ *   Walker alias tables for sampling the successor state of every
+ *   state-action pair of an MDP in constant time. Only successors with
+ *   nonzero probability are stored, as one column each; a column holds the
+ *   probability of keeping its own successor and the successor to take
+ *   otherwise (its alias).
+ *
+ */
+#ifndef __ALIAS_H__
+#define __ALIAS_H__
+
+#include "mdp.h"
+
+typedef struct {
+  unsigned int numStates;  /* Number of states of the MDP */
+  unsigned int numActions; /* Number of actions of the MDP */
+  unsigned int *offset;    /* A numStates*numActions+1 length array; the
+                              columns for (s,a) are offset[s*numActions+a]
+                              to offset[s*numActions+a+1]-1 */
+  unsigned int *outcome;   /* Successor state of each column */
+  unsigned int *alias;     /* Alternative successor state of each column */
+  double *threshold;       /* Probability of keeping outcome in each column */
+} alias_table;
+
+
+/*  Procedure
+ *    alias_build
+ *
+ *  Purpose
+ *    Construct alias tables for every state-action pair of an MDP
+ *
+ *  Parameters
+ *    p_mdp
+ *
+ *  Produces
+ *    p_table, an alias_table*
+ *
+ *  Preconditions
+ *    p_mdp points to a valid, complete mdp
+ *
+ *  Postconditions
+ *    alias_sample (p_table, s, a, u) for u uniform in [0,1) yields t
+ *      with probability P(t|s,a) / sum_{t'} P(t'|s,a)
+ *    p_table must be released with alias_free.
+ *    Any failure causes program exit.
+ */
+alias_table *
+alias_build (const mdp * p_mdp);
+
+
+/*  Procedure
+ *    alias_free
+ *
+ *  Purpose
+ *    Release an alias table
+ *
+ *  Parameters
+ *    p_table
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_table was produced by alias_build
+ *
+ *  Postconditions
+ *    All memory for p_table is freed
+ */
+void
+alias_free (alias_table * p_table);
+
+
+/*  Procedure
+ *    alias_sample
+ *
+ *  Purpose
+ *    Sample a successor state in constant time
+ *
+ *  Parameters
+ *    p_table
+ *    state
+ *    action
+ *    u
+ *
+ *  Produces
+ *    nextState
+ *
+ *  Preconditions
+ *    p_table was produced by alias_build
+ *    0 <= state < p_table->numStates, 0 <= action < p_table->numActions
+ *    0 <= u < 1
+ *
+ *  Postconditions
+ *    nextState is distributed according to P(.|state,action) when u is
+ *    uniform. When P(.|state,action) is all zero (as for an unavailable
+ *    action), nextState = state.
+ */
+static inline unsigned int
+alias_sample (const alias_table * p_table, unsigned int state,
+              unsigned int action, double u)
+{
+  unsigned int pair = state * p_table->numActions + action;
+  unsigned int first = p_table->offset[pair];
+  unsigned int n = p_table->offset[pair+1] - first;
+
+  if (0 == n)
+    return state;
+
+  // One uniform picks both the column (integer part) and the coin (fraction)
+  double x = u * n;
+  unsigned int column = (unsigned int)x;
+
+  if (column >= n) // Guard against round-off when u is just below 1
+    column = n - 1;
+
+  column += first;
+
+  return (x - (double)(column - first) < p_table->threshold[column]) ?
+    p_table->outcome[column] : p_table->alias[column];
+} // alias_sample
+
+#endif // __ALIAS_H__
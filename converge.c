@@ -0,0 +1,165 @@
+/*
+ * File
+ *   converge.c
+ *
+ * Summary
+ *   Convergence monitors for learners' values.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "mdp.h"
+#include "max.h"
+#include "converge.h"
+
+
+/*  Procedure
+ *    converge_malloc
+ *
+ *  Purpose
+ *    Allocate memory or exit with a message naming what was requested
+ */
+static void *
+converge_malloc (size_t bytes, const char * what)
+{
+  void * ptr = malloc (bytes);
+
+  if (NULL == ptr)
+  {
+    fprintf (stderr,"converge_create failed: Could not allocate %s (%s)\n",
+             what, strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+  return ptr;
+} // converge_malloc
+
+
+/*  Procedure
+ *    converge_policy
+ *
+ *  Purpose
+ *    Record the greedy action of every state with actions available,
+ *    reporting whether any differs from the one recorded before
+ *
+ *  Practica
+ *    Takes O(numStates*numActions) time, so it is only done for trials
+ *    that may be quiet.
+ */
+static bool
+converge_policy (converge_monitor * p_monitor, const double * values)
+{
+  const mdp * p_mdp = p_monitor->p_mdp;
+  bool changed = false;
+  unsigned int state, action;
+
+  for (state=0 ; state < p_mdp->numStates ; state++)
+  {
+    uint64_t mask = p_mdp->stateInfo[state].actionMask;
+
+    if (0 == mask)
+      continue;
+
+    action = arg_max_value_mask (mask, values + (size_t)state *
+                                 p_monitor->width);
+
+    if (action != p_monitor->policy[state])
+    {
+      p_monitor->policy[state] = action;
+      changed = true;
+    }
+  }
+
+  return changed;
+} // converge_policy
+
+
+////////////////////////////////////////////////////////////////////////////////
+converge_monitor *
+converge_create (const mdp * p_mdp, unsigned int length, unsigned int width,
+                 double tolerance, unsigned int window)
+{
+  converge_monitor * p_monitor = converge_malloc (sizeof(converge_monitor),
+                                                  "converge_monitor");
+
+  p_monitor->p_mdp = p_mdp;
+  p_monitor->length = length;
+  p_monitor->width = width;
+  p_monitor->tolerance = tolerance;
+  p_monitor->window = window;
+
+  // Allocate at least one entry so empty arrays are valid
+  p_monitor->current = converge_malloc (sizeof(double) * (length + 1),
+                                        "values");
+  p_monitor->previous = converge_malloc (sizeof(double) * (length + 1),
+                                         "values");
+  p_monitor->policy = NULL;
+
+  if (width > 1)
+  {
+    p_monitor->policy = converge_malloc (sizeof(unsigned int) *
+                                         p_mdp->numStates, "policy");
+    memset (p_monitor->policy, 0, sizeof(unsigned int) * p_mdp->numStates);
+  }
+
+  p_monitor->trials = 0;
+  p_monitor->quiet = 0;
+  p_monitor->converged = 0;
+
+  return p_monitor;
+} // converge_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+converge_free (converge_monitor * p_monitor)
+{
+  free (p_monitor->current);
+  free (p_monitor->previous);
+  free (p_monitor->policy);
+  free (p_monitor);
+} // converge_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+converge_observe (converge_monitor * p_monitor)
+{
+  const double * values = p_monitor->current;
+  double * swap;
+  bool changed = (0 == p_monitor->trials++); // Nothing to compare with yet
+  unsigned int i;
+
+  // One value beyond tolerance decides the trial
+  for (i=0 ; i < p_monitor->length && !changed ; i++)
+    changed = (fabs (values[i] - p_monitor->previous[i]) >
+               p_monitor->tolerance);
+
+  if (!changed && NULL != p_monitor->policy)
+  {
+    // The greedy actions of the trial before were recorded only if it
+    // was quiet too
+    if (0 == p_monitor->quiet)
+      converge_policy (p_monitor, p_monitor->previous);
+
+    changed = converge_policy (p_monitor, values);
+  }
+
+  swap = p_monitor->previous;
+  p_monitor->previous = p_monitor->current;
+  p_monitor->current = swap;
+
+  p_monitor->quiet = changed ? 0 : p_monitor->quiet + 1;
+
+  if (p_monitor->quiet < p_monitor->window)
+    return false;
+
+  if (0 == p_monitor->converged)
+    p_monitor->converged = p_monitor->trials;
+
+  return true;
+} // converge_observe
@@ -0,0 +1,130 @@
+/*
+ * File
+ *   converge.h
+ *
+ * Summary
+ *   Online convergence monitors for learners. After each trial a monitor
+ *   is shown the learner's values (utilities, or Q-values with the greedy
+ *   policy they give) and judges them converged once, for a window of
+ *   consecutive trials, no value moved by more than a tolerance and no
+ *   greedy action changed.
+ *
+ */
+#ifndef __CONVERGE_H__
+#define __CONVERGE_H__
+
+#include <stdbool.h>
+
+#include "mdp.h"
+
+/* Largest change of a value counted as none unless configured otherwise */
+#define CONVERGE_DEFAULT_TOLERANCE 1e-4
+
+typedef struct {
+  const mdp *    p_mdp;      /* MDP whose states the values describe */
+  unsigned int   length;     /* Values observed each trial */
+  unsigned int   width;      /* Values per state: numActions for Q-values
+                                Q[s*numActions+a], otherwise 1 */
+  double         tolerance;  /* Largest change of a value counted as none */
+  unsigned int   window;     /* Consecutive quiet trials required */
+  double *       current;    /* Where the values after the latest trial are
+                                written before converge_observe */
+  double *       previous;   /* Values observed after the previous trial */
+  unsigned int * policy;     /* Greedy action of each state after the
+                                previous trial (Q-values only, else NULL) */
+  unsigned int   trials;     /* Trials observed */
+  unsigned int   quiet;      /* Consecutive trials, up to the latest, with
+                                no change beyond tolerance */
+  unsigned int   converged;  /* Trial (counting from 1) at which the values
+                                were judged converged, or 0 */
+} converge_monitor;
+
+
+/*  Procedure
+ *    converge_create
+ *
+ *  Purpose
+ *    Allocate a convergence monitor
+ *
+ *  Parameters
+ *    p_mdp
+ *    length
+ *    width
+ *    tolerance
+ *    window
+ *
+ *  Produces
+ *    p_monitor, a converge_monitor*
+ *
+ *  Preconditions
+ *    p_mdp points to a valid mdp struct (its transitions are not read)
+ *      that outlives p_monitor
+ *    width = 1, or width = p_mdp->numActions and
+ *      length = p_mdp->numStates * width
+ *    tolerance >= 0
+ *    window > 0
+ *
+ *  Postconditions
+ *    p_monitor has observed no trials; p_monitor->current is a length
+ *    array.
+ *    p_monitor must be released with converge_free.
+ *    Any failure causes program exit.
+ */
+converge_monitor *
+converge_create (const mdp * p_mdp, unsigned int length, unsigned int width,
+                 double tolerance, unsigned int window);
+
+
+/*  Procedure
+ *    converge_free
+ *
+ *  Purpose
+ *    Release a convergence monitor
+ *
+ *  Parameters
+ *    p_monitor
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_monitor was produced by converge_create
+ *
+ *  Postconditions
+ *    All memory for p_monitor is freed
+ */
+void
+converge_free (converge_monitor * p_monitor);
+
+
+/*  Procedure
+ *    converge_observe
+ *
+ *  Purpose
+ *    Judge a learner's values at the end of a trial
+ *
+ *  Parameters
+ *    p_monitor
+ *
+ *  Produces
+ *    converged, a bool
+ *
+ *  Preconditions
+ *    p_monitor->current holds the values after the trial
+ *
+ *  Postconditions
+ *    The trial was quiet when it was not the first observed, no value
+ *    differs from the previous trial's by more than p_monitor->tolerance
+ *    and, for Q-values, every state's greedy action (the first available
+ *    action of largest value) is unchanged.
+ *    converged is true when the latest p_monitor->window trials were all
+ *    quiet; p_monitor->converged then records the trial, if it was not
+ *    already set.
+ *    p_monitor->current and p_monitor->previous were exchanged (so the
+ *    values are not copied), and the contents of p_monitor->current are
+ *    unspecified. Takes O(length) time, and less for a trial not quiet.
+ */
+bool
+converge_observe (converge_monitor * p_monitor);
+
+#endif // __CONVERGE_H__
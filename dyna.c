@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "mdp.h"
+#include "environment.h"
+#include "runner.h"
+#include "qlearn_agent.h"
+
+/* Process command-line arguments, verifying usage */
+void
+process_args (int argc, char * argv[], qlearn_agent_config * p_config,
+              unsigned int * trials, unsigned int * replicas);
+
+/*
+ Usage: dyna gamma reward attempts mdpfile trials backups
+             [threshold [replicas]]
+
+ Runs Dyna-Q in an environment for the given number of trials: the
+ Q-Learning-Agent of qlearn (with the same exploration function) that
+ also learns a model of the transitions and rewards it experiences and,
+ after every real step, makes backups simulated from that model.
+
+ With threshold 0 (the default), the pairs backed up are drawn
+ uniformly from those experienced. With a positive threshold they are
+ chosen by prioritized sweeping: pairs are queued when a backup would
+ change them by more than threshold, and those changing most are backed
+ up first, working back from each change through the pairs observed to
+ lead to it. With backups 0, this is qlearn.
+
+ With replicas, that many independent agents (each with its own random
+ number stream) run concurrently, one per processor, and the Q-values
+ printed are their means.
+
+ Trials are capped at MDP_MAX_EPISODE_STEPS steps and each replica's run
+ at MDP_RUN_SECONDS seconds when those are set; a warning reports any
+ trials cut short.
+
+ When MDP_CONVERGE_WINDOW is set, a replica stops once that many
+ consecutive trials have changed no Q-value by more than
+ MDP_CONVERGE_TOLERANCE (default CONVERGE_DEFAULT_TOLERANCE) and no
+ state's greedy action; the trial at which each replica converged is
+ reported.
+
+ When MDP_TRAJLOG is set, each replica's experience is recorded to that
+ trajectory log (suffixed with the replica number when there are
+ several), which trajplay can replay.
+*/
+int
+main (int argc, char* argv[])
+{
+  // Read and process configurations
+  qlearn_agent_config config;
+  unsigned int trials, replicas;
+
+  process_args (argc, argv, &config, &trials, &replicas);
+
+  // Initialize environment
+  environment * p_env = env_create (argv[4]);
+
+  // Run Dyna-Q replicas!
+  rl_agent_factory factory = qlearn_agent_factory (&config, p_env);
+  runner_options opts = runner_default_options ();
+
+  opts.replicas = replicas;
+  opts.trials = trials;
+
+  runner_result * p_result = runner_run (p_env, &factory, &opts);
+
+  if (p_result->truncated > 0 || p_result->timeouts > 0)
+    fprintf (stderr, "%s: Warning: %llu trials truncated and %llu replicas "
+             "stopped by limits\n", argv[0], p_result->truncated,
+             p_result->timeouts);
+
+  runner_print_convergence (stderr, argv[0], p_result);
+
+  mdp * p_mdp = env_get_structure (p_env);
+
+  qlearn_print (p_mdp, p_result->mean);
+
+  mdp_free (p_mdp);
+  runner_result_free (p_result);
+  env_free (p_env);
+
+  return 0;
+} // main
+
+
+/* Process command-line arguments, verifying usage */
+void
+process_args (int argc, char * argv[], qlearn_agent_config * p_config,
+              unsigned int * trials, unsigned int * replicas)
+{
+  if (argc < 7 || argc > 9)
+  {
+    fprintf (stderr,
+             "Usage: %s gamma reward attempts mdpfile trials backups "
+             "[threshold [replicas]]\n", argv[0]);
+    exit (EXIT_FAILURE);
+  }
+
+  char * endptr; // String End Location for number parsing
+  const char * names[] = { "gamma", "reward", "attempts" };
+  double * params[] = { &p_config->gamma, &p_config->reward,
+                        &p_config->attempts };
+  int i;
+
+  // Read gamma, the optimistic reward and attempts as doubles
+  for (i=0 ; i < 3 ; i++)
+  {
+    *params[i] = strtod (argv[i+1], &endptr);
+
+    if ( (endptr - argv[i+1])/sizeof(char) < strlen (argv[i+1]) )
+    {
+      fprintf (stderr, "%s: Illegal non-numeric value in argument %s=%s\n",
+               argv[0], names[i], argv[i+1]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+  // Read trials, number of times to run as an unsigned integer
+  *trials = (unsigned int)strtol(argv[5], &endptr, 10);
+
+  if ( (endptr - argv[5])/sizeof(char) < strlen (argv[5]) )
+  {
+    fprintf (stderr, "%s: Illegal non-numeric value in argument trials=%s\n",
+             argv[0], argv[5]);
+    exit (EXIT_FAILURE);
+  }
+
+  // Read backups, planning backups per step, as an unsigned integer
+  p_config->backups = (unsigned int)strtol(argv[6], &endptr, 10);
+
+  if ( (endptr - argv[6])/sizeof(char) < strlen (argv[6]) )
+  {
+    fprintf (stderr, "%s: Illegal non-numeric value in argument backups=%s\n",
+             argv[0], argv[6]);
+    exit (EXIT_FAILURE);
+  }
+
+  // Read threshold, the smallest change swept, as a double
+  p_config->threshold = 0;
+
+  if (argc >= 8)
+  {
+    p_config->threshold = strtod (argv[7], &endptr);
+
+    if ( (endptr - argv[7])/sizeof(char) < strlen (argv[7]) ||
+         p_config->threshold < 0 )
+    {
+      fprintf (stderr, "%s: Illegal value in argument threshold=%s\n",
+               argv[0], argv[7]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+  // Read replicas, number of independent agents, as an unsigned integer
+  *replicas = 1;
+
+  if (9 == argc)
+  {
+    *replicas = (unsigned int)strtol(argv[8], &endptr, 10);
+
+    if ( (endptr - argv[8])/sizeof(char) < strlen (argv[8]) ||
+         0 == *replicas )
+    {
+      fprintf (stderr, "%s: Illegal value in argument replicas=%s\n",
+               argv[0], argv[8]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+  // Learn only from experience and the model, one step at a time
+  p_config->replays = 0;
+  p_config->replayCapacity = QLEARN_REPLAY_CAPACITY;
+  p_config->lambda = 0;
+} // process_args
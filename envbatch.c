@@ -0,0 +1,231 @@
+/*
+ * File
+ *   envbatch.c
+ *
+ * Summary
+ *   Lockstep simulation of many episodes of an environment's MDP.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+#include "mdp.h"
+#include "alias.h"
+#include "rng.h"
+#include "environment.h"
+#include "envbatch.h"
+#include "instrument.h"
+
+
+/*  Procedure
+ *    batch_seconds
+ *
+ *  Purpose
+ *    Read a monotonic clock, in seconds
+ */
+static double
+batch_seconds (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+} // batch_seconds
+
+
+////////////////////////////////////////////////////////////////////////////////
+environment_batch *
+environment_batch_try_create (const environment * p_env, unsigned int size,
+                              uint64_t seed)
+{
+  environment_batch * p_batch;
+
+  if (0 == size)
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  p_batch = malloc (sizeof(environment_batch));
+
+  if (NULL == p_batch)
+    return NULL;
+
+  p_batch->p_env = p_env;
+  p_batch->size = size;
+  p_batch->state = malloc (sizeof(unsigned int) * size);
+  p_batch->reward = malloc (sizeof(double) * size);
+  p_batch->action = malloc (sizeof(unsigned int) * size);
+  p_batch->length = malloc (sizeof(unsigned int) * size);
+  p_batch->uniform = malloc (sizeof(double) * size);
+
+  if (NULL == p_batch->state || NULL == p_batch->reward ||
+      NULL == p_batch->action || NULL == p_batch->length ||
+      NULL == p_batch->uniform)
+  {
+    int error = errno; // Keep the failure's cause past free
+
+    environment_batch_free (p_batch);
+    errno = error;
+    return NULL;
+  }
+
+  p_batch->steps = 0;
+  p_batch->episodes = 0;
+  p_batch->truncated = 0;
+  rng_seed (&p_batch->rng, seed);
+
+  environment_batch_reset (p_batch);
+
+  return p_batch;
+} // environment_batch_try_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+environment_batch *
+environment_batch_create (const environment * p_env, unsigned int size,
+                          uint64_t seed)
+{
+  environment_batch * p_batch;
+
+  if (0 == size)
+  {
+    fprintf (stderr,"environment_batch_create failed: Batch size must be "
+             "positive\n");
+    exit (EXIT_FAILURE);
+  }
+
+  p_batch = environment_batch_try_create (p_env, size, seed);
+
+  if (NULL == p_batch)
+  {
+    fprintf (stderr,"environment_batch_create failed: Could not allocate "
+             "%u lanes (%s)\n", size, strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  return p_batch;
+} // environment_batch_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+environment_batch_free (environment_batch * p_batch)
+{
+  free (p_batch->state);
+  free (p_batch->reward);
+  free (p_batch->action);
+  free (p_batch->length);
+  free (p_batch->uniform);
+  free (p_batch);
+} // environment_batch_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+environment_batch_reset (environment_batch * p_batch)
+{
+  const mdp * p_mdp = p_batch->p_env->p_mdp;
+  unsigned int start = p_mdp->start;
+  double startReward = p_mdp->rewards[start];
+  unsigned int i;
+
+  for (i=0 ; i < p_batch->size ; i++)
+  {
+    p_batch->state[i] = start;
+    p_batch->reward[i] = startReward;
+    p_batch->action[i] = 0;
+    p_batch->length[i] = 0;
+  }
+} // environment_batch_reset
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+environment_batch_step (environment_batch * p_batch)
+{
+  const mdp * p_mdp = p_batch->p_env->p_mdp;
+  const alias_table * p_table = p_batch->p_env->p_alias;
+  const double * rewards = p_mdp->rewards;
+  unsigned int start = p_mdp->start;
+  unsigned int limit = (0 == p_batch->p_env->limits.maxSteps) ?
+    UINT_MAX : p_batch->p_env->limits.maxSteps;
+  unsigned int n = p_batch->size;
+  unsigned int * restrict state = p_batch->state;
+  double * restrict reward = p_batch->reward;
+  const unsigned int * restrict action = p_batch->action;
+  unsigned int * restrict length = p_batch->length;
+  const double * restrict uniform = p_batch->uniform;
+  unsigned long long finished = 0, cut = 0;
+  unsigned int i;
+
+  // One uniform per lane, drawn in bulk
+  rng_fill_uniform (&p_batch->rng, p_batch->uniform, n);
+
+  for (i=0 ; i < n ; i++)
+  {
+    unsigned int s = state[i];
+
+    if (MDP_IS_TERMINAL(p_mdp, s)) // Episode over: restart the lane
+    {
+      INSTRUMENT_EPISODE (length[i], true);
+      s = start;
+      length[i] = 0;
+      finished++;
+    }
+    else if (length[i] >= limit) // Step limit reached: truncate the lane
+    {
+      INSTRUMENT_EPISODE (length[i], false);
+      s = start;
+      length[i] = 0;
+      cut++;
+    }
+    else
+    {
+      s = alias_sample (p_table, s, action[i], uniform[i]);
+      length[i]++;
+    }
+
+    state[i] = s;
+    reward[i] = rewards[s];
+  }
+
+  p_batch->steps += n;
+  p_batch->episodes += finished;
+  p_batch->truncated += cut;
+
+  INSTRUMENT_STEPS (n);
+} // environment_batch_step
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+environment_batch_run (environment_batch * p_batch, rl_batch_agent agent,
+                       void * context, unsigned long long episodes)
+{
+  // Truncated episodes count, so a policy that never terminates still
+  // ends the run under a step limit
+  unsigned long long target = p_batch->episodes + p_batch->truncated +
+    episodes;
+  double maxSeconds = p_batch->p_env->limits.maxSeconds;
+  double deadline = (maxSeconds > 0) ? batch_seconds () + maxSeconds : 0;
+
+  INSTRUMENT_PHASE_BEGIN (start);
+
+  while (p_batch->episodes + p_batch->truncated < target)
+  {
+    agent (context, p_batch->size, p_batch->state, p_batch->reward,
+           p_batch->length, p_batch->action);
+
+    environment_batch_step (p_batch);
+
+    if (deadline > 0 && batch_seconds () >= deadline)
+      break;
+  }
+
+  INSTRUMENT_PHASE_END (INSTRUMENT_BATCH, start);
+} // environment_batch_run
@@ -0,0 +1,236 @@
+/*
+ * File
+ *   envbatch.h
+ *
+ * Summary
+ *   A batched environment that simulates many episodes of an environment's
+ *   MDP in lockstep. Episode data is kept in structure-of-arrays form (one
+ *   array per field, one entry per lane), and a single call advances every
+ *   lane, restarting those whose episode has ended. Agents see a whole batch
+ *   of states at once instead of one callback per step.
+ *
+ */
+#ifndef __ENVBATCH_H__
+#define __ENVBATCH_H__
+
+#include <stdint.h>
+
+#include "rng.h"
+#include "environment.h"
+
+typedef struct {
+  const environment * p_env; /* Environment whose MDP is simulated */
+  unsigned int size;       /* Number of concurrent episodes (lanes) */
+  unsigned int *state;     /* Current state of each lane */
+  double *reward;          /* Reward of each lane's current state */
+  unsigned int *action;    /* Action chosen by the agent for each lane */
+  unsigned int *length;    /* Steps taken so far in each lane's episode */
+  double *uniform;         /* Random numbers for one step of every lane */
+  unsigned long long steps;    /* Agent decisions made over all lanes */
+  unsigned long long episodes; /* Episodes completed over all lanes */
+  unsigned long long truncated; /* Episodes cut off at the step limit */
+  rng_state rng;           /* Random number stream of the batch */
+} environment_batch;
+
+
+/*  Procedure
+ *    rl_batch_agent
+ *
+ *  Purpose
+ *    Update an agent and produce actions for a batch of states
+ *
+ *  Parameters
+ *    context
+ *    count
+ *    states
+ *    rewards
+ *    lengths
+ *    actions
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    states, rewards and lengths are count length arrays of the lanes'
+ *    current states, their rewards and the steps taken so far in their
+ *    episodes; actions is a count length array
+ *    Lane i continues the episode it was in at the previous call when
+ *    lengths[i] > 0; otherwise lane i has started a new episode, either
+ *    because its previous one reached a terminal state or because it was
+ *    truncated at the environment's step limit
+ *
+ *  Postconditions
+ *    actions[i] is a valid action for states[i]. (Actions for terminal
+ *    states are ignored.)
+ */
+typedef void (*rl_batch_agent) (void * context, unsigned int count,
+                                const unsigned int * states,
+                                const double * rewards,
+                                const unsigned int * lengths,
+                                unsigned int * actions);
+
+
+/*  Procedure
+ *    environment_batch_create
+ *
+ *  Purpose
+ *    Allocate a batch of episodes of an environment
+ *
+ *  Parameters
+ *    p_env
+ *    size
+ *    seed
+ *
+ *  Produces
+ *    p_batch, an environment_batch*
+ *
+ *  Preconditions
+ *    p_env was produced by env_create and outlives p_batch
+ *    size > 0
+ *
+ *  Postconditions
+ *    Every lane of p_batch is at the start state of a new episode.
+ *    The batch's random number stream is seeded with seed; it is
+ *    independent of the environment's own stream, and p_env is not
+ *    modified by the batch.
+ *    p_batch must be released with environment_batch_free.
+ *    Any failure causes program exit.
+ */
+environment_batch *
+environment_batch_create (const environment * p_env, unsigned int size,
+                          uint64_t seed);
+
+
+/*  Procedure
+ *    environment_batch_try_create
+ *
+ *  Purpose
+ *    Allocate a batch of episodes of an environment, reporting failure
+ *
+ *  Parameters
+ *    p_env
+ *    size
+ *    seed
+ *
+ *  Produces
+ *    p_batch, an environment_batch*
+ *
+ *  Preconditions
+ *    p_env was produced by env_create and outlives p_batch
+ *
+ *  Postconditions
+ *    Upon success, p_batch is as for environment_batch_create.
+ *    Upon failure (size = 0, or memory could not be allocated), p_batch is
+ *    NULL, errno describes the failure, and nothing is printed, so
+ *    long-running callers (such as envserver) may refuse the one request.
+ */
+environment_batch *
+environment_batch_try_create (const environment * p_env, unsigned int size,
+                              uint64_t seed);
+
+
+/*  Procedure
+ *    environment_batch_free
+ *
+ *  Purpose
+ *    Release a batch of episodes
+ *
+ *  Parameters
+ *    p_batch
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_batch was produced by environment_batch_create or
+ *    environment_batch_try_create
+ *
+ *  Postconditions
+ *    All memory for p_batch is freed
+ */
+void
+environment_batch_free (environment_batch * p_batch);
+
+
+/*  Procedure
+ *    environment_batch_reset
+ *
+ *  Purpose
+ *    Abandon the episodes in progress and restart every lane
+ *
+ *  Parameters
+ *    p_batch
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_batch was produced by environment_batch_create
+ *
+ *  Postconditions
+ *    Every lane is at the start state with a step count of zero.
+ *    The steps and episodes totals are unchanged.
+ */
+void
+environment_batch_reset (environment_batch * p_batch);
+
+
+/*  Procedure
+ *    environment_batch_step
+ *
+ *  Purpose
+ *    Advance every lane by one step using the actions in p_batch->action
+ *
+ *  Parameters
+ *    p_batch
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_batch was produced by environment_batch_create
+ *    p_batch->action[i] is a valid action for p_batch->state[i]
+ *
+ *  Postconditions
+ *    Lanes in a terminal state have completed their episode and restarted
+ *    at the start state, as have lanes that have taken the step limit of
+ *    p_batch->p_env (counted in p_batch->truncated, not as episodes); every
+ *    other lane has moved to a successor drawn from P(.|state,action).
+ *    p_batch->reward holds the new states' rewards.
+ */
+void
+environment_batch_step (environment_batch * p_batch);
+
+
+/*  Procedure
+ *    environment_batch_run
+ *
+ *  Purpose
+ *    Run an agent on every lane of a batch until enough episodes complete
+ *
+ *  Parameters
+ *    p_batch
+ *    agent
+ *    context
+ *    episodes
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_batch was produced by environment_batch_create
+ *    agent satisfies the rl_batch_agent contract; context is passed to it
+ *
+ *  Postconditions
+ *    At least episodes more episodes have ended, unless the time limit of
+ *    p_batch->p_env (checked once per round) elapsed first; episodes
+ *    truncated by the step limit count toward the number requested, as
+ *    do those completed. Each round calls agent once with every lane and
+ *    then steps the batch. Lanes still in progress are continued by the
+ *    next call.
+ */
+void
+environment_batch_run (environment_batch * p_batch, rl_batch_agent agent,
+                       void * context, unsigned long long episodes);
+
+#endif // __ENVBATCH_H__
@@ -2,109 +2,414 @@
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
 
 #include "mdp.h"
+#include "alias.h"
+#include "rng.h"
+#include "mdpshm.h"
 #include "environment.h"
+#include "instrument.h"
+
+// The link-time agent is optional: programs that only use env_run may omit it
+#pragma weak rl_agent_action
 
 // Persistent (external) variables
 
- mdp *         p_mdp_env; /* MDP to operate on/in */
+ environment * p_env_default = NULL; /* Environment of the environment_*
+                                        procedures */
+
+/*  Procedure
+ *    monotonic_seconds
+ *
+ *  Purpose
+ *    Read a monotonic clock, in seconds
+ */
+static double monotonic_seconds()
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/*  Procedure
+ *    read_limits
+ *
+ *  Purpose
+ *    Determine default limits from the process environment, exiting with
+ *    a message when a variable is malformed
+ */
+static environment_limits read_limits()
+{
+  environment_limits limits = { 0, 0.0 };
+  const char * value;
+  char * endptr;
+
+  value = getenv (ENVIRONMENT_MAX_STEPS_VAR);
+  if (NULL != value && '\0' != value[0])
+  {
+    unsigned long steps = strtoul (value, &endptr, 10);
+
+    if ('\0' != *endptr || steps > UINT_MAX || '-' == value[0])
+    {
+      fprintf(stderr,"env_create: Illegal value %s=%s\n",
+              ENVIRONMENT_MAX_STEPS_VAR, value);
+      exit(EXIT_FAILURE);
+    }
+    limits.maxSteps = (unsigned int)steps;
+  }
+
+  value = getenv (ENVIRONMENT_MAX_SECONDS_VAR);
+  if (NULL != value && '\0' != value[0])
+  {
+    limits.maxSeconds = strtod (value, &endptr);
+
+    if ('\0' != *endptr || !(limits.maxSeconds >= 0))
+    {
+      fprintf(stderr,"env_create: Illegal value %s=%s\n",
+              ENVIRONMENT_MAX_SECONDS_VAR, value);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  return limits;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
-void environment_setup( char * mdpfile)
+environment * env_create(const char * mdpfile)
+{
+  INSTRUMENT_PHASE_BEGIN (start);
+
+  environment * p_env = malloc (sizeof(environment));
+
+  if (NULL == p_env)
+  {
+    fprintf(stderr,"env_create: Unable to allocate environment (%s)\n",
+            strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 == strncmp (mdpfile, MDPSHM_PREFIX, strlen (MDPSHM_PREFIX)))
+  {
+    // Attach a published model: no parsing, no copies
+    p_env->p_shm = mdpshm_attach (mdpfile + strlen (MDPSHM_PREFIX));
+
+    if (NULL == p_env->p_shm)
+    {
+      fprintf(stderr,"env_create: Failed to attach MDP %s\n",mdpfile);
+      exit(EXIT_FAILURE);
+    }
+
+    p_env->p_mdp = &p_env->p_shm->model;
+    p_env->p_alias = &p_env->p_shm->table;
+  }
+  else
+  {
+    p_env->p_shm = NULL;
+    p_env->p_mdp = mdp_read (mdpfile);
+
+    if (NULL == p_env->p_mdp)
+    {
+      fprintf(stderr,"env_create: Failed to read MDP file %s\n",mdpfile);
+      exit(EXIT_FAILURE);
+    }
+
+    // Precompute constant-time samplers for every state-action pair
+    p_env->p_alias = alias_build (p_env->p_mdp);
+  }
+
+  p_env->ownsModel = true;
+  p_env->limits = read_limits ();
+  memset (&p_env->stats, 0, sizeof(environment_stats));
+  p_env->deadline = 0;
+
+  env_seed (p_env, ENVIRONMENT_DEFAULT_SEED);
+
+  INSTRUMENT_PHASE_END (INSTRUMENT_SETUP, start);
+
+  return p_env;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+environment * env_share(const environment * p_env)
 {
-  p_mdp_env = mdp_read (mdpfile);
+  environment * p_shared = malloc (sizeof(environment));
 
-  if (NULL == p_mdp_env)
+  if (NULL == p_shared)
   {
-    fprintf(stderr,"environment_setup: Failed to read MDP file %s\n",mdpfile);
+    fprintf(stderr,"env_share: Unable to allocate environment (%s)\n",
+            strerror(errno));
     exit(EXIT_FAILURE);
   }
+
+  p_shared->p_mdp = p_env->p_mdp;
+  p_shared->p_alias = p_env->p_alias;
+  p_shared->p_shm = p_env->p_shm;
+  p_shared->ownsModel = false;
+  p_shared->limits = p_env->limits;
+  memset (&p_shared->stats, 0, sizeof(environment_stats));
+  p_shared->deadline = 0;
+
+  env_seed (p_shared, ENVIRONMENT_DEFAULT_SEED);
+
+  return p_shared;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void env_free(environment * p_env)
+{
+  if (p_env->ownsModel && NULL != p_env->p_shm)
+    mdpshm_detach (p_env->p_shm);
+  else if (p_env->ownsModel)
+  {
+    alias_free (p_env->p_alias);
+    mdp_free (p_env->p_mdp);
+  }
+  free (p_env);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void env_seed(environment * p_env, uint64_t seed)
+{
+  rng_seed (&p_env->rng, seed);
+  p_env->uniformNext = ENVIRONMENT_UNIFORM_BUFFER; // Discard buffered values
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-mdp* environment_get_mdp()
+void env_seed_stream(environment * p_env, uint64_t seed, unsigned int index)
 {
-  mdp * p_mdp_out =mdp_duplicate(p_mdp_env); // Create a copy
+  rng_stream (&p_env->rng, seed, index);
+  p_env->uniformNext = ENVIRONMENT_UNIFORM_BUFFER; // Discard buffered values
+}
 
-  unsigned int s,t,a; // Loop variables
+////////////////////////////////////////////////////////////////////////////////
+uint64_t env_agent_seed(const environment * p_env)
+{
+  rng_state copy = p_env->rng;
 
-  // Zero-out transition probabilities
-  for ( s=0 ; s < p_mdp_env->numStates ; s++)
-    for ( t=0 ; t < p_mdp_env->numStates ; t++)
-      for ( a=0 ; a < p_mdp_env->numActions ; a++)
-	p_mdp_out->transitionProb[s][t][a] = 0.0;
+  return rng_next (&copy);
+}
 
-  // Zero-out rewards
-  for ( s=0 ; s < p_mdp_env->numStates ; s++)
-    p_mdp_out->rewards[s] = 0;
+////////////////////////////////////////////////////////////////////////////////
+mdp* env_get_mdp(const environment * p_env)
+{
+  // Copy only what the agent may know; the model may lack transitions
+  return mdp_duplicate_structure (p_env->p_mdp);
+}
 
-  return p_mdp_out;
+////////////////////////////////////////////////////////////////////////////////
+mdp* env_get_structure(const environment * p_env)
+{
+  return mdp_structure (p_env->p_mdp);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-unsigned int environment_get_num_states() { return p_mdp_env->numStates; }
-unsigned int environment_get_num_actions() { return p_mdp_env->numActions; }
+unsigned int env_run(environment * p_env, const rl_agent * p_agent,
+                     const unsigned int trials)
+{
+  return env_run_totals(p_env, p_agent, trials, NULL);
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
-void environment_run(const unsigned int trials)
+unsigned int env_run_totals(environment * p_env, const rl_agent * p_agent,
+                            const unsigned int trials, double * totals)
 {
-  unsigned int iter;  
+  return env_run_monitored(p_env, p_agent, trials, totals, NULL);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int env_run_monitored(environment * p_env, const rl_agent * p_agent,
+                               const unsigned int trials, double * totals,
+                               const env_monitor * p_monitor)
+{
+  unsigned int iter;
+  double total;
+
+  INSTRUMENT_PHASE_BEGIN (start);
+
+  p_env->deadline = (p_env->limits.maxSeconds > 0) ?
+    monotonic_seconds() + p_env->limits.maxSeconds : 0;
 
   for (iter=0 ; iter<trials ; iter++)
-    environment_run_trial();
+  {
+    unsigned long long truncated = p_env->stats.truncated;
+
+    total = env_run_trial(p_env, p_agent);
 
+    if (NULL != totals)
+      totals[iter] = total;
+
+    // Stop once the budget is spent, if any work was cut short
+    if (p_env->deadline > 0 && monotonic_seconds() >= p_env->deadline)
+    {
+      iter++;
+      if (iter < trials || p_env->stats.truncated > truncated)
+        p_env->stats.timeouts++;
+      break;
+    }
+
+    // Stop once the monitor is satisfied (as when the agent converged)
+    if (NULL != p_monitor && p_monitor->done(p_monitor->context))
+    {
+      iter++;
+      break;
+    }
+  }
+
+  p_env->deadline = 0;
+
+  INSTRUMENT_PHASE_END (INSTRUMENT_RUN, start);
+
+  return iter;
 }
 
 
 ////////////////////////////////////////////////////////////////////////////////
-void environment_run_trial()
+double env_run_trial(environment * p_env, const rl_agent * p_agent)
 {
   unsigned int iter = 0;
+  double total = 0.0; // Sum of rewards given to the agent
+  bool truncated = false; // Whether the trial was cut short
+
+  const mdp * p_mdp = p_env->p_mdp;
 
   unsigned int state; // Current state (initial or arising from agent action)
   unsigned int action; // Last action taken by the agent
   double reward; // Reward for the current state
 
-  double randNum; // Random number in [0,1]
-  double cumProb; // Cumulative of P(t|s,a) for t=0..
+  double randNum; // Random number in [0,1)
 
-  unsigned int nextState; // Subsequent state for transition due to action
+  // Transitions allowed, and the transition count of the next check of the
+  // limits (the step limit itself, or the next look at the clock)
+  unsigned int limit = (0 == p_env->limits.maxSteps) ?
+    UINT_MAX : p_env->limits.maxSteps;
+  unsigned int check = (p_env->deadline > 0 &&
+                        ENVIRONMENT_CLOCK_INTERVAL < limit) ?
+    ENVIRONMENT_CLOCK_INTERVAL : limit;
 
-  state = p_mdp_env->start; // Initialize the start state
+  state = p_mdp->start; // Initialize the start state
 
   do
   {
-    reward = p_mdp_env->rewards[state]; // Determine reward of the current state
+    reward = p_mdp->rewards[state]; // Determine reward of the current state
+    total += reward;
 
-    action = rl_agent_action(state,reward); // Get an action from the agent
+    // Get an action from the agent
+    action = p_agent->action(p_agent->context,state,reward);
 
-    if (p_mdp_env->terminal[state]) // Finish if state was terminal
+    if (MDP_IS_TERMINAL(p_mdp, state)) // Finish if state was terminal
       break;
 
+    if (iter >= check) // Finish if out of steps or time
+    {
+      if (iter >= limit || monotonic_seconds() >= p_env->deadline)
+      {
+        truncated = true;
+        break;
+      }
+      check = (limit - iter > ENVIRONMENT_CLOCK_INTERVAL) ?
+        iter + ENVIRONMENT_CLOCK_INTERVAL : limit;
+    }
+
     // Next, we have to choose the subsequent state randomly by
     // sampling from the MDP's conditional transition probability P(t|s,a)
-    
-    // Get a random number in [0,1]
-    randNum = ((double)random()) / RAND_MAX;
-    
-    // Find the nexState for which the cumulative meets the random value
-    cumProb = 0.0;
-    nextState = 0; 
-
-    do
-    { // Add to the cumulative
-      cumProb += p_mdp_env->transitionProb[nextState][state][action];
-
-      if ( cumProb > randNum) // If CDF has passed our random point,
-	break;                // then we're at the right state, so exit
-      nextState++;            // otherwise go to the last state,
-    }  // but if we're now at the last state, exit the loop 
-    while (nextState < p_mdp_env->numStates-1);
-    
-    state = nextState; // Update state <-- nextState for next iteration
+
+    // Get a random number in [0,1), refilling the buffer when exhausted
+    if (p_env->uniformNext == ENVIRONMENT_UNIFORM_BUFFER)
+    {
+      rng_fill_uniform (&p_env->rng, p_env->uniform,
+                        ENVIRONMENT_UNIFORM_BUFFER);
+      p_env->uniformNext = 0;
+    }
+    randNum = p_env->uniform[p_env->uniformNext++];
+
+    // Update state <-- nextState, drawn from the alias table in O(1)
+    state = alias_sample (p_env->p_alias, state, action, randNum);
 
     iter++;
-  } 
+  }
   while(1); // terminal state test is within do loop
+
+  p_env->stats.trials++;
+  p_env->stats.steps += iter + 1; // One agent call per transition, plus last
+
+  if (truncated)
+  {
+    p_env->stats.truncated++;
+
+    if (NULL != p_agent->truncate)
+      p_agent->truncate(p_agent->context);
+  }
+
+  INSTRUMENT_STEPS (iter + 1);
+  INSTRUMENT_EPISODE (iter, !truncated);
+
+  return total;
+}
+
+
+/*  Procedure
+ *    link_agent_action
+ *
+ *  Purpose
+ *    Adapt the link-time rl_agent_action to the rl_agent interface
+ */
+static unsigned int link_agent_action(void * context, unsigned int state,
+                                      double reward)
+{
+  (void) context; // The link-time agent keeps its own state
+
+  return rl_agent_action(state,reward);
+}
+
+/* Agent of the environment_* procedures */
+static const rl_agent link_agent = { NULL, link_agent_action, NULL };
+
+////////////////////////////////////////////////////////////////////////////////
+void environment_setup( char * mdpfile)
+{
+  p_env_default = env_create (mdpfile);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+environment * environment_default() { return p_env_default; }
+
+////////////////////////////////////////////////////////////////////////////////
+void environment_seed(uint64_t seed) { env_seed (p_env_default, seed); }
+
+////////////////////////////////////////////////////////////////////////////////
+mdp* environment_get_mdp() { return env_get_mdp (p_env_default); }
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int environment_get_num_states()
+{
+  return p_env_default->p_mdp->numStates;
+}
+
+unsigned int environment_get_num_actions()
+{
+  return p_env_default->p_mdp->numActions;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void environment_run(const unsigned int trials)
+{
+  if (NULL == rl_agent_action)
+  {
+    fprintf(stderr,"environment_run: No rl_agent_action is linked\n");
+    exit(EXIT_FAILURE);
+  }
+
+  env_run (p_env_default, &link_agent, trials);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+void environment_run_trial()
+{
+  environment_run (1);
 }
@@ -1,3 +1,410 @@
+/*
+ * File
+ *   environment.h
+ *
+ * Summary
+ *   A reinforcement learning environment simulating an MDP. Environments
+ *   are handles (environment*) and agents are interface structs (rl_agent),
+ *   so any number of each may coexist in one process. The environment_*
+ *   procedures operate on a single default environment created by
+ *   environment_setup and drive an agent bound at link time through
+ *   rl_agent_action.
+ *
+ */
+#ifndef __ENVIRONMENT_H__
+#define __ENVIRONMENT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mdp.h"
+#include "alias.h"
+#include "rng.h"
+#include "mdpshm.h"
+
+/* Seed of the environment's random number stream after setup */
+#define ENVIRONMENT_DEFAULT_SEED 42
+
+/* Number of uniform random values generated at a time */
+#define ENVIRONMENT_UNIFORM_BUFFER 256
+
+/* Steps between checks of the wall clock while running */
+#define ENVIRONMENT_CLOCK_INTERVAL 4096
+
+/* Environment variables giving the default limits of new environments */
+#define ENVIRONMENT_MAX_STEPS_VAR   "MDP_MAX_EPISODE_STEPS"
+#define ENVIRONMENT_MAX_SECONDS_VAR "MDP_RUN_SECONDS"
+
+typedef struct {
+  unsigned int maxSteps;   /* Transitions allowed per trial (0 = unbounded) */
+  double       maxSeconds; /* Wall-clock budget of each env_run call
+                              (0 = unbounded) */
+} environment_limits;
+
+typedef struct {
+  unsigned long long trials;      /* Trials run, truncated or not */
+  unsigned long long steps;       /* Agent steps over all trials */
+  unsigned long long truncated;   /* Trials stopped before a terminal state */
+  unsigned long long timeouts;    /* env_run calls stopped by maxSeconds */
+} environment_stats;
+
+typedef struct {
+  mdp *         p_mdp;    /* MDP to operate on/in */
+  alias_table * p_alias;  /* Successor samplers for p_mdp */
+  rng_state     rng;      /* Random number stream of the environment */
+  double        uniform[ENVIRONMENT_UNIFORM_BUFFER]; /* Pending uniforms */
+  unsigned int  uniformNext; /* Next unused entry of uniform */
+  bool          ownsModel; /* Whether p_mdp and p_alias are freed with the
+                              environment (false when shared) */
+  mdpshm *      p_shm;    /* Shared memory segment p_mdp and p_alias point
+                             into, or NULL when they were read from a file */
+  environment_limits limits; /* Bounds on trials and runs; may be assigned
+                                at any time between runs */
+  environment_stats  stats;  /* Totals since creation */
+  double        deadline; /* Monotonic time at which the current run must
+                             stop (0 = none) */
+} environment;
+
+typedef struct {
+  void * context; /* Agent state, passed to every procedure */
+  unsigned int (*action) (void * context, unsigned int state, double reward);
+                  /* Update the agent and produce an action for the given
+                     state, as described for rl_agent_action */
+  void (*truncate) (void * context);
+                  /* Optional (may be NULL): told that the trial ended
+                     without reaching a terminal state, so the last state
+                     given has no successor */
+} rl_agent;
+
+typedef struct {
+  void * context; /* Monitor state, passed to every procedure */
+  bool (*done) (void * context);
+                  /* Told after each trial; true ends the run (as when an
+                     agent has converged) */
+} env_monitor;
+
+
+/*  Procedure
+ *    env_create
+ *
+ *  Purpose
+ *    Create an environment simulating the MDP described in a file
+ *
+ *  Parameters
+ *   mdpfile
+ *
+ *  Produces
+ *   p_env, an environment*
+ *
+ *  Preconditions
+ *    mdpfile is a null-terminated string (character array) that refers to a
+ *    readable file containing a valid MDP description, or is MDPSHM_PREFIX
+ *    followed by the name of a model published with mdpshm_publish
+ *
+ *  Postconditions
+ *    Alias tables for sampling successor states in constant time have
+ *    been built for every state-action pair. A published model is instead
+ *    attached read-only, without parsing or copying (p_env->p_shm is not
+ *    NULL and p_env->p_mdp->transitionProb is NULL).
+ *    The random number stream is seeded with ENVIRONMENT_DEFAULT_SEED.
+ *    p_env->limits are read from the variables named by
+ *    ENVIRONMENT_MAX_STEPS_VAR and ENVIRONMENT_MAX_SECONDS_VAR, and are
+ *    unbounded when those are unset; p_env->stats are zero.
+ *    p_env must be released with env_free.
+ *    Any failure (including a malformed limit) causes program exit.
+ */
+environment * env_create(const char * mdpfile);
+
+
+/*  Procedure
+ *    env_free
+ *
+ *  Purpose
+ *    Release an environment
+ *
+ *  Parameters
+ *   p_env
+ *
+ *  Produces
+ *   [Nothing.]
+ *
+ *  Preconditions
+ *    p_env was produced by env_create
+ *
+ *  Postconditions
+ *    All memory for p_env, including its MDP, is freed
+ */
+void env_free(environment * p_env);
+
+
+/*  Procedure
+ *    env_share
+ *
+ *  Purpose
+ *    Create an environment simulating the same model as another
+ *
+ *  Parameters
+ *   p_env
+ *
+ *  Produces
+ *   p_shared, an environment*
+ *
+ *  Preconditions
+ *    p_env was produced by env_create and outlives p_shared
+ *
+ *  Postconditions
+ *    p_shared reads the MDP and alias tables of p_env without copying them;
+ *    neither environment modifies them, so both may run concurrently in
+ *    different threads.
+ *    p_shared has its own random number stream, seeded with
+ *    ENVIRONMENT_DEFAULT_SEED, the limits of p_env and zero stats.
+ *    p_shared must be released with env_free, which leaves the model intact.
+ *    Any failure causes program exit.
+ */
+environment * env_share(const environment * p_env);
+
+
+/*  Procedure
+ *    env_seed
+ *
+ *  Purpose
+ *    Restart an environment's random number stream from a seed
+ *
+ *  Parameters
+ *   p_env
+ *   seed
+ *
+ *  Produces
+ *   [Nothing.]
+ *
+ *  Preconditions
+ *    p_env was produced by env_create
+ *
+ *  Postconditions
+ *    Subsequent trials in p_env are reproducible given seed and the
+ *    agent's actions
+ */
+void env_seed(environment * p_env, uint64_t seed);
+
+
+/*  Procedure
+ *    env_seed_stream
+ *
+ *  Purpose
+ *    Restart an environment's random number stream from a numbered stream
+ *    of a seed
+ *
+ *  Parameters
+ *   p_env
+ *   seed
+ *   index
+ *
+ *  Produces
+ *   [Nothing.]
+ *
+ *  Preconditions
+ *    p_env was produced by env_create or env_share
+ *
+ *  Postconditions
+ *    The stream is rng_stream(seed,index), which does not overlap the
+ *    stream of any other index; index 0 is the same as env_seed(p_env,seed)
+ */
+void env_seed_stream(environment * p_env, uint64_t seed, unsigned int index);
+
+
+/*  Procedure
+ *    env_agent_seed
+ *
+ *  Purpose
+ *    Derive a seed for an agent's own random number stream
+ *
+ *  Parameters
+ *   p_env
+ *
+ *  Produces
+ *   seed, a uint64_t
+ *
+ *  Preconditions
+ *    p_env was produced by env_create or env_share
+ *
+ *  Postconditions
+ *    seed is determined by the current state of p_env's stream, which is
+ *    not advanced, so agents of environments seeded differently (as by
+ *    env_seed_stream) get different seeds without changing the trials
+ */
+uint64_t env_agent_seed(const environment * p_env);
+
+
+/*  Procedure
+ *    env_get_mdp
+ *
+ *  Purpose
+ *    Retrieve an incomplete copy of an environment's MDP (sans rewards and
+ *    transitions data)
+ *
+ *  Parameters
+ *   p_env
+ *
+ *  Produces
+ *   p_mdp
+ *
+ *  Preconditions
+ *    p_env was produced by env_create
+ *
+ *  Postconditions
+ *    As for environment_get_mdp
+ */
+mdp* env_get_mdp(const environment * p_env);
+
+
+/*  Procedure
+ *    env_get_structure
+ *
+ *  Purpose
+ *    Retrieve only the dimensions, start state, available actions and
+ *    terminal states of an environment's MDP
+ *
+ *  Parameters
+ *   p_env
+ *
+ *  Produces
+ *   p_mdp
+ *
+ *  Preconditions
+ *    p_env was produced by env_create
+ *
+ *  Postconditions
+ *    As for env_get_mdp, except p_mdp->transitionProb is NULL (see
+ *    mdp_structure), so retrieving it takes O(numStates*numActions) rather
+ *    than O(numStates^2*numActions) time and memory. Learners keep what
+ *    they observe of the transitions themselves (as in model.h).
+ */
+mdp* env_get_structure(const environment * p_env);
+
+
+/*  Procedure
+ *    env_run
+ *
+ *  Purpose
+ *    Run an agent in an environment for a specified number of trials
+ *
+ *  Parameters
+ *    p_env
+ *    p_agent
+ *    trials
+ *
+ *  Produces
+ *    completed, an unsigned int
+ *
+ *  Preconditions
+ *    p_env was produced by env_create
+ *    p_agent->action satisfies the contract of rl_agent_action for the
+ *    MDP of p_env
+ *
+ *  Postconditions
+ *    As for env_run_totals (p_env, p_agent, trials, NULL)
+ */
+unsigned int env_run(environment * p_env, const rl_agent * p_agent,
+                     const unsigned int trials);
+
+
+/*  Procedure
+ *    env_run_totals
+ *
+ *  Purpose
+ *    Run an agent for a specified number of trials, recording the total
+ *    reward of each
+ *
+ *  Parameters
+ *    p_env
+ *    p_agent
+ *    trials
+ *    totals
+ *
+ *  Produces
+ *    completed, an unsigned int
+ *
+ *  Preconditions
+ *    p_env was produced by env_create
+ *    p_agent->action satisfies the contract of rl_agent_action for the
+ *    MDP of p_env
+ *    totals is NULL or a trials length array
+ *
+ *  Postconditions
+ *    env_run_trial(p_env,p_agent) has been called completed times, where
+ *    completed = trials unless p_env->limits.maxSeconds elapsed first (in
+ *    which case the trial in progress was truncated and counted, and
+ *    p_env->stats.timeouts was incremented)
+ *    When totals is not NULL, totals[i] is the result of trial i for
+ *    0 <= i < completed
+ */
+unsigned int env_run_totals(environment * p_env, const rl_agent * p_agent,
+                            const unsigned int trials, double * totals);
+
+
+/*  Procedure
+ *    env_run_monitored
+ *
+ *  Purpose
+ *    Run an agent for at most a specified number of trials, recording the
+ *    total reward of each, until a monitor ends the run
+ *
+ *  Parameters
+ *    p_env
+ *    p_agent
+ *    trials
+ *    totals
+ *    p_monitor
+ *
+ *  Produces
+ *    completed, an unsigned int
+ *
+ *  Preconditions
+ *    As for env_run_totals
+ *    p_monitor is NULL or p_monitor->done is a valid procedure
+ *
+ *  Postconditions
+ *    As for env_run_totals, except that completed is also less than
+ *    trials when p_monitor->done(p_monitor->context) returned true after
+ *    trial completed; it is called after each trial not ended by the time
+ *    limit.
+ *    env_run_totals(p_env,p_agent,trials,totals) is
+ *    env_run_monitored(p_env,p_agent,trials,totals,NULL).
+ */
+unsigned int env_run_monitored(environment * p_env, const rl_agent * p_agent,
+                               const unsigned int trials, double * totals,
+                               const env_monitor * p_monitor);
+
+
+/*  Procedure
+ *    env_run_trial
+ *
+ *  Purpose
+ *    Run an agent in an environment until a terminal state is reached
+ *
+ *  Parameters
+ *    p_env
+ *    p_agent
+ *
+ *  Produces
+ *    total, a double
+ *
+ *  Preconditions
+ *    p_env was produced by env_create
+ *    p_agent->action satisfies the contract of rl_agent_action for the
+ *    MDP of p_env
+ *
+ *  Postconditions
+ *    p_agent->action(p_agent->context,state,reward) is called until given
+ *    an argument that is a terminal state, or until the trial is truncated
+ *    after p_env->limits.maxSteps transitions (or at the deadline of the
+ *    enclosing env_run). A truncated trial is counted in
+ *    p_env->stats.truncated and reported to p_agent->truncate.
+ *    total is the sum of the rewards given to the agent during the trial
+ */
+double env_run_trial(environment * p_env, const rl_agent * p_agent);
+
+
 /*  Procedure
  *    setup
  *
@@ -17,9 +424,52 @@
  *  Postconditions
  *    Other methods, assuming their other preconditions have been
  *    meet, should succeed.
+ *    The default environment is env_create(mdpfile).
  */
 void environment_setup(char * mdpfile);
 
+
+/*  Procedure
+ *    environment_default
+ *
+ *  Purpose
+ *    Retrieve the default environment
+ *
+ *  Parameters
+ *   [None.]
+ *
+ *  Produces
+ *   p_env
+ *
+ *  Preconditions
+ *    setup has been run successfully.
+ *
+ *  Postconditions
+ *    p_env is the environment created by setup
+ */
+environment * environment_default();
+
+
+/*  Procedure
+ *    environment_seed
+ *
+ *  Purpose
+ *    Restart the environment's random number stream from a seed
+ *
+ *  Parameters
+ *   seed
+ *
+ *  Produces
+ *   [Nothing.]
+ *
+ *  Preconditions
+ *    setup has been run successfully.
+ *
+ *  Postconditions
+ *    Subsequent trials are reproducible given seed and the agent's actions
+ */
+void environment_seed(uint64_t seed);
+
 /*  Procedure
  *    get_mdp
  *
@@ -104,6 +554,8 @@ unsigned int environment_get_num_actions();
  *
  *  Postconditions
  *    action is a valid reward index for the  given state
+ *
+ *  Programs that only run agents through env_run need not define it.
  */
 unsigned int rl_agent_action(unsigned int state, double reward);
 
@@ -127,6 +579,8 @@ unsigned int rl_agent_action(unsigned int state, double reward);
  *  Postconditions
  *    environment_run_trial() has been called trials times in a
  *    simulation of the current environment
+ *    Any failure (such as rl_agent_action being undefined) causes
+ *    program exit.
  */
 void environment_run(const unsigned int trials);
 
@@ -155,3 +609,4 @@ void environment_run(const unsigned int trials);
  */
 void environment_run_trial();
 
+#endif // __ENVIRONMENT_H__
@@ -0,0 +1,517 @@
+/*
+ * File
+ *   envserver.c
+ *
+ * Summary
+ *   Unix domain socket server stepping batched environments for agents in
+ *   other processes.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "mdp.h"
+#include "environment.h"
+#include "envbatch.h"
+#include "envserver.h"
+
+// Initial size of each connection's input and output buffers
+#define ENVSERVER_BUFFER 65536
+
+typedef struct {
+  int    fd;        /* Connected socket */
+  char * in;        /* Received bytes not yet parsed are in[inStart,inEnd) */
+  size_t inSize;    /* Capacity of in */
+  size_t inStart;   /* First unparsed byte */
+  size_t inEnd;     /* End of received bytes */
+  char * out;       /* Replies not yet sent are out[0,outLength) */
+  size_t outSize;   /* Capacity of out */
+  size_t outLength; /* Bytes of replies pending */
+} envserver_conn;
+
+typedef struct {
+  const environment * p_env; /* Environment served */
+  int fd;                    /* Connection to serve */
+} envserver_job;
+
+
+/*  Procedure
+ *    conn_flush
+ *
+ *  Purpose
+ *    Send every pending reply, returning false on failure
+ */
+static bool
+conn_flush (envserver_conn * p_conn)
+{
+  size_t sent = 0;
+
+  while (sent < p_conn->outLength)
+  {
+    // MSG_NOSIGNAL: a vanished client is an error, not a SIGPIPE
+    ssize_t n = send (p_conn->fd, p_conn->out + sent,
+                      p_conn->outLength - sent, MSG_NOSIGNAL);
+
+    if (n < 0 && EINTR == errno)
+      continue;
+    if (n < 0)
+      return false;
+    sent += n;
+  }
+
+  p_conn->outLength = 0;
+  return true;
+} // conn_flush
+
+
+/*  Procedure
+ *    conn_need
+ *
+ *  Purpose
+ *    Receive until at least bytes unparsed bytes are buffered, returning
+ *    false at end of stream or on failure. Pending replies are sent only
+ *    before the server would wait, so pipelined requests are answered in
+ *    as few writes as possible.
+ */
+static bool
+conn_need (envserver_conn * p_conn, size_t bytes)
+{
+  while (p_conn->inEnd - p_conn->inStart < bytes)
+  {
+    // Make room: move the unparsed bytes to the front, growing if needed
+    if (p_conn->inStart > 0)
+    {
+      memmove (p_conn->in, p_conn->in + p_conn->inStart,
+               p_conn->inEnd - p_conn->inStart);
+      p_conn->inEnd -= p_conn->inStart;
+      p_conn->inStart = 0;
+    }
+
+    if (bytes > p_conn->inSize)
+    {
+      char * in = realloc (p_conn->in, bytes);
+
+      if (NULL == in)
+        return false;
+      p_conn->in = in;
+      p_conn->inSize = bytes;
+    }
+
+    // Take what has arrived; send replies only if we must wait for more
+    ssize_t n = recv (p_conn->fd, p_conn->in + p_conn->inEnd,
+                      p_conn->inSize - p_conn->inEnd, MSG_DONTWAIT);
+
+    if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+    {
+      if (!conn_flush (p_conn))
+        return false;
+      n = recv (p_conn->fd, p_conn->in + p_conn->inEnd,
+                p_conn->inSize - p_conn->inEnd, 0);
+    }
+
+    if (n < 0 && EINTR == errno)
+      continue;
+    if (n <= 0)
+      return false;
+
+    p_conn->inEnd += n;
+  }
+
+  return true;
+} // conn_need
+
+
+/*  Procedure
+ *    conn_take
+ *
+ *  Purpose
+ *    Consume bytes buffered by conn_need, returning their address
+ */
+static const void *
+conn_take (envserver_conn * p_conn, size_t bytes)
+{
+  const void * data = p_conn->in + p_conn->inStart;
+
+  p_conn->inStart += bytes;
+  return data;
+} // conn_take
+
+
+/*  Procedure
+ *    conn_reserve
+ *
+ *  Purpose
+ *    Append bytes of reply space, returning its address or NULL on failure
+ */
+static void *
+conn_reserve (envserver_conn * p_conn, size_t bytes)
+{
+  if (p_conn->outLength + bytes > p_conn->outSize)
+  {
+    if (!conn_flush (p_conn))
+      return NULL;
+
+    if (bytes > p_conn->outSize)
+    {
+      char * out = realloc (p_conn->out, bytes);
+
+      if (NULL == out)
+        return NULL;
+      p_conn->out = out;
+      p_conn->outSize = bytes;
+    }
+  }
+
+  void * space = p_conn->out + p_conn->outLength;
+
+  p_conn->outLength += bytes;
+  return space;
+} // conn_reserve
+
+
+/*  Procedure
+ *    reply_header
+ *
+ *  Purpose
+ *    Append a reply header, returning false on failure
+ */
+static bool
+reply_header (envserver_conn * p_conn, envserver_status status,
+              unsigned int count)
+{
+  envserver_reply reply = { status, count };
+  void * space = conn_reserve (p_conn, sizeof(reply));
+
+  if (NULL == space)
+    return false;
+  memcpy (space, &reply, sizeof(reply));
+  return true;
+} // reply_header
+
+
+/*  Procedure
+ *    append_lanes
+ *
+ *  Purpose
+ *    Append a record of every lane of a batch
+ */
+static bool
+append_lanes (envserver_conn * p_conn, const environment_batch * p_batch)
+{
+  unsigned int i;
+  envserver_lane * lanes = conn_reserve (p_conn, sizeof(envserver_lane) *
+                                         p_batch->size);
+
+  if (NULL == lanes)
+    return false;
+
+  for (i=0 ; i < p_batch->size ; i++)
+  {
+    lanes[i].state = p_batch->state[i];
+    lanes[i].length = p_batch->length[i];
+    lanes[i].reward = p_batch->reward[i];
+  }
+
+  return true;
+} // append_lanes
+
+
+/*  Procedure
+ *    reply_lanes
+ *
+ *  Purpose
+ *    Append a successful reply holding every lane of a batch
+ */
+static bool
+reply_lanes (envserver_conn * p_conn, const environment_batch * p_batch)
+{
+  return (reply_header (p_conn, ENVSERVER_OK, p_batch->size) &&
+          append_lanes (p_conn, p_batch));
+} // reply_lanes
+
+
+/*  Procedure
+ *    valid_actions
+ *
+ *  Purpose
+ *    Determine whether every non-terminal lane has an available action
+ */
+static bool
+valid_actions (const environment_batch * p_batch)
+{
+  const mdp * p_mdp = p_batch->p_env->p_mdp;
+  unsigned int i;
+
+  for (i=0 ; i < p_batch->size ; i++)
+  {
+    unsigned int s = p_batch->state[i];
+    unsigned int a = p_batch->action[i];
+
+    if (!MDP_IS_TERMINAL(p_mdp, s) &&
+        (a >= p_mdp->numActions ||
+         0 == ((p_mdp->actionMask[s] >> a) & 1)))
+      return false;
+  }
+
+  return true;
+} // valid_actions
+
+
+////////////////////////////////////////////////////////////////////////////////
+int
+envserver_listen (const char * path)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  if (strlen (path) >= sizeof(addr.sun_path))
+  {
+    fprintf (stderr,"envserver_listen: Socket path %s is too long\n", path);
+    return -1;
+  }
+
+  memset (&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, path);
+
+  fd = socket (AF_UNIX, SOCK_STREAM, 0);
+
+  if (fd < 0)
+  {
+    fprintf (stderr,"envserver_listen: Unable to create socket (%s)\n",
+             strerror (errno));
+    return -1;
+  }
+
+  if (0 != bind (fd, (struct sockaddr*)&addr, sizeof(addr)) ||
+      0 != listen (fd, ENVSERVER_BACKLOG))
+  {
+    fprintf (stderr,"envserver_listen: Unable to listen at %s (%s)\n", path,
+             strerror (errno));
+    close (fd);
+    return -1;
+  }
+
+  return fd;
+} // envserver_listen
+
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+envserver_session (const environment * p_env, int fd)
+{
+  const mdp * p_mdp = p_env->p_mdp;
+  environment_batch * p_batch = NULL;
+  envserver_conn conn = { fd, malloc (ENVSERVER_BUFFER), ENVSERVER_BUFFER,
+                          0, 0, malloc (ENVSERVER_BUFFER), ENVSERVER_BUFFER,
+                          0 };
+  envserver_request request;
+  bool valid = true, sent = true;
+  unsigned int s;
+
+  if (NULL == conn.in || NULL == conn.out)
+  {
+    fprintf (stderr,"envserver_session: Unable to allocate buffers (%s)\n",
+             strerror (errno));
+    free (conn.in);
+    free (conn.out);
+    close (fd);
+    return false;
+  }
+
+  while (valid && sent && conn_need (&conn, sizeof(request)))
+  {
+    memcpy (&request, conn_take (&conn, sizeof(request)), sizeof(request));
+
+    switch (request.op)
+    {
+    case ENVSERVER_OPEN:
+    {
+      uint64_t seed;
+
+      valid = (request.count > 0 && request.count <= ENVSERVER_MAX_LANES &&
+               conn_need (&conn, sizeof(seed)));
+      if (!valid)
+        break;
+
+      memcpy (&seed, conn_take (&conn, sizeof(seed)), sizeof(seed));
+
+      if (NULL != p_batch)
+        environment_batch_free (p_batch);
+      p_batch = environment_batch_try_create (p_env, request.count, seed);
+
+      if (NULL == p_batch) // Refuse this open alone; the server carries on
+      {
+        fprintf (stderr,"envserver_session: Unable to open %u lanes (%s)\n",
+                 request.count, strerror (errno));
+        sent = reply_header (&conn, ENVSERVER_ENOMEM, 0);
+        break;
+      }
+
+      envserver_info info = { p_mdp->numStates, p_mdp->numActions,
+                              p_mdp->start, p_env->limits.maxSteps };
+      envserver_info * p_info;
+
+      sent = (reply_header (&conn, ENVSERVER_OK, p_batch->size) &&
+              NULL != (p_info = conn_reserve (&conn, sizeof(info))));
+      if (sent)
+      {
+        memcpy (p_info, &info, sizeof(info));
+        sent = append_lanes (&conn, p_batch);
+      }
+      break;
+    }
+
+    case ENVSERVER_DESCRIBE:
+    {
+      valid = (0 == request.count);
+      if (!valid)
+        break;
+
+      envserver_state * states = NULL;
+
+      sent = (reply_header (&conn, ENVSERVER_OK, p_mdp->numStates) &&
+              NULL != (states = conn_reserve (&conn, sizeof(envserver_state) *
+                                              p_mdp->numStates)));
+      if (sent)
+        for (s=0 ; s < p_mdp->numStates ; s++)
+        {
+          states[s].actionMask = p_mdp->actionMask[s];
+          states[s].terminal = MDP_IS_TERMINAL(p_mdp, s);
+          states[s].padding = 0;
+        }
+      break;
+    }
+
+    case ENVSERVER_STEP:
+      valid = (NULL != p_batch && request.count == p_batch->size &&
+               conn_need (&conn, sizeof(uint32_t) * request.count));
+      if (!valid)
+        break;
+
+      memcpy (p_batch->action,
+              conn_take (&conn, sizeof(uint32_t) * request.count),
+              sizeof(uint32_t) * request.count);
+
+      valid = valid_actions (p_batch);
+      if (!valid)
+        break;
+
+      environment_batch_step (p_batch);
+      sent = reply_lanes (&conn, p_batch);
+      break;
+
+    case ENVSERVER_RESET:
+      valid = (NULL != p_batch && 0 == request.count);
+      if (!valid)
+        break;
+
+      environment_batch_reset (p_batch);
+      sent = reply_lanes (&conn, p_batch);
+      break;
+
+    default:
+      valid = false;
+    }
+  }
+
+  bool success = false;
+
+  if (!valid)
+  {
+    fprintf (stderr,"envserver_session: Malformed request (op %u, count %u)\n",
+             request.op, request.count);
+    if (reply_header (&conn, ENVSERVER_EINVAL, 0))
+      conn_flush (&conn);
+  }
+  else if (!sent)
+    fprintf (stderr,"envserver_session: Unable to send reply (%s)\n",
+             strerror (errno));
+  else if (conn.inStart != conn.inEnd)
+    fprintf (stderr,"envserver_session: Connection closed within a "
+             "request\n");
+  else
+    success = true; // The client has every reply it asked for
+
+  if (NULL != p_batch)
+    environment_batch_free (p_batch);
+  free (conn.in);
+  free (conn.out);
+  close (fd);
+
+  return success;
+} // envserver_session
+
+
+/*  Procedure
+ *    session_main
+ *
+ *  Purpose
+ *    Serve one connection on its own thread
+ */
+static void *
+session_main (void * arg)
+{
+  envserver_job job = *(envserver_job*)arg;
+
+  free (arg);
+  envserver_session (job.p_env, job.fd);
+
+  return NULL;
+} // session_main
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+envserver_serve (const environment * p_env, int listenFd)
+{
+  pthread_attr_t attr;
+
+  pthread_attr_init (&attr);
+  pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+  while (1)
+  {
+    int fd = accept (listenFd, NULL, NULL);
+
+    if (fd < 0)
+    {
+      // The client may give up before we get to it
+      if (EINTR == errno || ECONNABORTED == errno)
+        continue;
+
+      fprintf (stderr,"envserver_serve: Unable to accept connection (%s)\n",
+               strerror (errno));
+      break;
+    }
+
+    envserver_job * p_job = malloc (sizeof(envserver_job));
+    pthread_t thread;
+
+    if (NULL == p_job)
+    {
+      fprintf (stderr,"envserver_serve: Unable to allocate session (%s)\n",
+               strerror (errno));
+      close (fd);
+      continue;
+    }
+
+    p_job->p_env = p_env;
+    p_job->fd = fd;
+
+    if (0 != pthread_create (&thread, &attr, session_main, p_job))
+    {
+      fprintf (stderr,"envserver_serve: Unable to start session thread\n");
+      free (p_job);
+      close (fd);
+    }
+  }
+
+  pthread_attr_destroy (&attr);
+} // envserver_serve
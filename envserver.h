@@ -0,0 +1,175 @@
+/*
+ * File
+ *   envserver.h
+ *
+ * Summary
+ *   A local (Unix domain socket) server through which agents in other
+ *   processes, written in any language, drive batches of simulated
+ *   episodes. Each connection owns an environment_batch; one request
+ *   steps every lane of it, so per-step overhead is amortized over the
+ *   batch, and requests may be pipelined (sent before earlier replies are
+ *   read), since replies are written only when the server would block.
+ *
+ *   Protocol. Every request is an envserver_request, possibly followed by
+ *   a payload; every reply is an envserver_reply followed by its payload.
+ *   Replies come in request order. All fields are in host byte order.
+ *
+ *     ENVSERVER_OPEN     count = lanes, payload one uint64_t seed.
+ *                        Creates the connection's batch (replacing any
+ *                        previous one) and replies with count = lanes:
+ *                        an envserver_info, then the lanes' initial
+ *                        envserver_lane records. If the lanes cannot be
+ *                        allocated, it replies with status
+ *                        ENVSERVER_ENOMEM and count 0 instead, and the
+ *                        connection stays open with no batch.
+ *     ENVSERVER_DESCRIBE count = 0. Replies with count = numStates
+ *                        envserver_state records (what an agent may know
+ *                        of the MDP: available actions and terminals).
+ *     ENVSERVER_STEP     count = lanes, payload count uint32_t actions.
+ *                        Steps every lane (actions of lanes in terminal
+ *                        states are ignored) and replies with count
+ *                        envserver_lane records.
+ *     ENVSERVER_RESET    count = 0. Restarts every lane and replies with
+ *                        count = lanes envserver_lane records.
+ *
+ *   Lanes follow environment_batch_step: a lane whose length is zero has
+ *   just started an episode, because its previous one reached a terminal
+ *   state or hit the environment's step limit. Any malformed request
+ *   (unknown operation, wrong count, unavailable action, or a step before
+ *   an open) gets a reply with status ENVSERVER_EINVAL and count 0, and
+ *   the connection is closed.
+ *
+ */
+#ifndef __ENVSERVER_H__
+#define __ENVSERVER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "environment.h"
+
+/* Largest batch one connection may open */
+#define ENVSERVER_MAX_LANES 65536
+
+/* Connections waiting to be accepted */
+#define ENVSERVER_BACKLOG 16
+
+typedef enum {
+  ENVSERVER_OPEN = 1,
+  ENVSERVER_DESCRIBE = 2,
+  ENVSERVER_STEP = 3,
+  ENVSERVER_RESET = 4
+} envserver_op;
+
+typedef enum {
+  ENVSERVER_OK = 0,
+  ENVSERVER_EINVAL = 1,
+  ENVSERVER_ENOMEM = 2
+} envserver_status;
+
+typedef struct {
+  uint32_t op;          /* An envserver_op */
+  uint32_t count;       /* Operation-specific count (see above) */
+} envserver_request;
+
+typedef struct {
+  uint32_t status;      /* An envserver_status */
+  uint32_t count;       /* Number of records in the payload */
+} envserver_reply;
+
+typedef struct {
+  uint32_t numStates;   /* Number of states of the MDP */
+  uint32_t numActions;  /* Number of actions of the MDP */
+  uint32_t start;       /* Starting state of the MDP */
+  uint32_t maxSteps;    /* Transitions allowed per episode (0 = unbounded) */
+} envserver_info;
+
+typedef struct {
+  uint64_t actionMask;  /* Bit a is set iff action a is available */
+  uint32_t terminal;    /* Nonzero iff the state is terminal */
+  uint32_t padding;
+} envserver_state;
+
+typedef struct {
+  uint32_t state;       /* Current state of the lane */
+  uint32_t length;      /* Steps taken so far in the lane's episode */
+  double   reward;      /* Reward of the current state */
+} envserver_lane;
+
+
+/*  Procedure
+ *    envserver_listen
+ *
+ *  Purpose
+ *    Create a listening Unix domain socket
+ *
+ *  Parameters
+ *    path
+ *
+ *  Produces
+ *    fd, an int
+ *
+ *  Preconditions
+ *    path does not name an existing file
+ *
+ *  Postconditions
+ *    Upon success, fd is a socket listening at path; the caller should
+ *    unlink path when done.
+ *    Upon failure, a message is printed and fd is -1.
+ */
+int
+envserver_listen (const char * path);
+
+
+/*  Procedure
+ *    envserver_session
+ *
+ *  Purpose
+ *    Serve one connection until the client closes it
+ *
+ *  Parameters
+ *    p_env
+ *    fd
+ *
+ *  Produces
+ *    success, a bool
+ *
+ *  Preconditions
+ *    p_env was produced by env_create and outlives the session
+ *    fd is a connected stream socket
+ *
+ *  Postconditions
+ *    Every request read from fd has been answered, and fd is closed.
+ *    p_env is not modified, so sessions may run concurrently.
+ *    success is false (with a message printed) when the session ended on
+ *    a malformed request or an I/O error.
+ */
+bool
+envserver_session (const environment * p_env, int fd);
+
+
+/*  Procedure
+ *    envserver_serve
+ *
+ *  Purpose
+ *    Accept connections forever, serving each on its own thread
+ *
+ *  Parameters
+ *    p_env
+ *    listenFd
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_env was produced by env_create
+ *    listenFd was produced by envserver_listen
+ *
+ *  Postconditions
+ *    Does not return, except on an unrecoverable error accepting
+ *    connections (after printing a message).
+ */
+void
+envserver_serve (const environment * p_env, int listenFd);
+
+#endif // __ENVSERVER_H__
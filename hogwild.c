@@ -0,0 +1,335 @@
+/*
+ * File
+ *   hogwild.c
+ *
+ * Summary
+ *   Worker threads running Q-learning agents on one shared table, and
+ *   the convergence checks timing them.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "mdp.h"
+#include "max.h"
+#include "environment.h"
+#include "qtable.h"
+#include "qlearn_agent.h"
+#include "hogwild.h"
+
+typedef struct {
+  const hogwild_options * p_opts;    /* Run configuration */
+  hogwild_result *        p_result;  /* Shared table and statistics */
+  const mdp *             p_mdp;     /* Structure for the checks */
+  environment **          envs;      /* Environment of each worker */
+  qlearn_agent **         agents;    /* Agent of each worker */
+  double                  start;     /* Monotonic time of the start */
+  unsigned int            next;      /* Next unclaimed worker (atomic) */
+  unsigned int            completed; /* Trials completed (atomic) */
+  bool                    converged; /* Whether recorded (atomic) */
+} hogwild_job;
+
+
+/*  Procedure
+ *    hogwild_malloc
+ *
+ *  Purpose
+ *    Allocate memory or exit with a message naming what was requested
+ */
+static void *
+hogwild_malloc (size_t bytes, const char * what)
+{
+  void * ptr = malloc (bytes);
+
+  if (NULL == ptr)
+  {
+    fprintf (stderr,"hogwild_run failed: Could not allocate %s (%s)\n",
+             what, strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+  return ptr;
+} // hogwild_malloc
+
+
+/*  Procedure
+ *    monotonic_seconds
+ *
+ *  Purpose
+ *    Read a monotonic clock, in seconds
+ */
+static double
+monotonic_seconds (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+} // monotonic_seconds
+
+
+/*  Procedure
+ *    check_convergence
+ *
+ *  Purpose
+ *    Record the time and trials at which the greedy policy first agrees
+ *    with the reference
+ */
+static void
+check_convergence (hogwild_job * p_job, unsigned int completed)
+{
+  bool expected = false;
+
+  if (__atomic_load_n (&p_job->converged, __ATOMIC_RELAXED) ||
+      hogwild_mismatches (p_job->p_mdp, p_job->p_result->p_table,
+                          p_job->p_opts->policy) > p_job->p_opts->tolerance)
+    return;
+
+  // Only the first worker to see agreement records it
+  if (__atomic_compare_exchange_n (&p_job->converged, &expected, true, false,
+                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+    p_job->p_result->convergedSeconds = monotonic_seconds () - p_job->start;
+    p_job->p_result->convergedTrials = completed;
+  }
+} // check_convergence
+
+
+/*  Procedure
+ *    run_worker
+ *
+ *  Purpose
+ *    Run one worker's trials, checking convergence as they complete
+ *
+ *  Practica
+ *    Trials are run one env_run at a time so they can be counted; the
+ *    remaining time budget is carried from one to the next, so together
+ *    they are limited like a single run.
+ */
+static void
+run_worker (hogwild_job * p_job, unsigned int worker)
+{
+  const hogwild_options * p_opts = p_job->p_opts;
+  environment * p_env = p_job->envs[worker];
+  rl_agent agent = qlearn_agent_interface (p_job->agents[worker]);
+  double budget = p_env->limits.maxSeconds;
+  double begin = monotonic_seconds ();
+  unsigned int trials = p_opts->trials / p_opts->workers +
+    (worker < p_opts->trials % p_opts->workers);
+  unsigned int trial;
+
+  for (trial=0 ; trial < trials ; trial++)
+  {
+    if (budget > 0)
+    {
+      double remaining = budget - (monotonic_seconds () - begin);
+
+      if (remaining <= 0)
+      {
+        p_env->stats.timeouts++;
+        break;
+      }
+      p_env->limits.maxSeconds = remaining;
+    }
+
+    env_run (p_env, &agent, 1);
+
+    unsigned int completed = __atomic_add_fetch (&p_job->completed, 1,
+                                                 __ATOMIC_RELAXED);
+
+    if (NULL != p_opts->policy && 0 == completed % p_opts->checkEvery)
+      check_convergence (p_job, completed);
+
+    if (p_env->stats.timeouts > 0)
+      break;
+  }
+} // run_worker
+
+
+/*  Procedure
+ *    worker_main
+ *
+ *  Purpose
+ *    Claim and run workers until none remain
+ */
+static void *
+worker_main (void * arg)
+{
+  hogwild_job * p_job = arg;
+  unsigned int worker;
+
+  while ((worker = __atomic_fetch_add (&p_job->next, 1, __ATOMIC_RELAXED))
+         < p_job->p_opts->workers)
+    run_worker (p_job, worker);
+
+  return NULL;
+} // worker_main
+
+
+////////////////////////////////////////////////////////////////////////////////
+hogwild_options
+hogwild_default_options (void)
+{
+  hogwild_options opts;
+  long online = sysconf (_SC_NPROCESSORS_ONLN);
+
+  opts.workers = (online > 0) ? (unsigned int)online : 1;
+  opts.shards = 0;
+  opts.trials = 0;
+  opts.seed = ENVIRONMENT_DEFAULT_SEED;
+  opts.policy = NULL;
+  opts.checkEvery = 1;
+  opts.tolerance = 0;
+
+  return opts;
+} // hogwild_default_options
+
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int
+hogwild_mismatches (const mdp * p_mdp, const qtable * p_table,
+                    const unsigned int * policy)
+{
+  double * values = hogwild_malloc (sizeof(double) * p_mdp->numActions,
+                                    "row");
+  uint32_t * counts = hogwild_malloc (sizeof(uint32_t) * p_mdp->numActions,
+                                      "row");
+  unsigned int state, count = 0;
+
+  for (state=0 ; state < p_mdp->numStates ; state++)
+  {
+    uint64_t mask = p_mdp->stateInfo[state].actionMask;
+
+    if (0 == mask || MDP_IS_TERMINAL(p_mdp, state))
+      continue;
+
+    qtable_snapshot (p_table, state, values, counts);
+
+    if (arg_max_value_mask (mask, values) != policy[state])
+      count++;
+  }
+
+  free (values);
+  free (counts);
+
+  return count;
+} // hogwild_mismatches
+
+
+////////////////////////////////////////////////////////////////////////////////
+hogwild_result *
+hogwild_run (const environment * p_env, const qlearn_agent_config * p_config,
+             const hogwild_options * p_opts)
+{
+  unsigned int numLaunched = 0;
+  unsigned int i;
+
+  if (0 == p_opts->workers)
+  {
+    fprintf (stderr,"hogwild_run failed: At least one worker is required\n");
+    exit (EXIT_FAILURE);
+  }
+
+  hogwild_result * p_result = hogwild_malloc (sizeof(hogwild_result),
+                                              "hogwild_result");
+  const mdp * p_mdp = p_env->p_mdp;
+
+  p_result->p_table = (p_opts->shards > 0) ?
+    qtable_create_sharded (p_mdp->numStates, p_mdp->numActions,
+                           p_opts->shards) :
+    qtable_create (p_mdp->numStates, p_mdp->numActions);
+  p_result->convergedSeconds = -1;
+  p_result->convergedTrials = 0;
+  p_result->mismatches = 0;
+  p_result->truncated = 0;
+  p_result->timeouts = 0;
+
+  hogwild_job job = { p_opts, p_result, p_mdp, NULL, NULL, 0, 0, 0, false };
+
+  //----------------------------------------
+  // Create every worker's environment and agent before timing starts
+
+  job.envs = hogwild_malloc (sizeof(environment*) * p_opts->workers,
+                             "environments");
+  job.agents = hogwild_malloc (sizeof(qlearn_agent*) * p_opts->workers,
+                               "agents");
+
+  for (i=0 ; i < p_opts->workers ; i++)
+  {
+    job.envs[i] = env_share (p_env);
+    env_seed_stream (job.envs[i], p_opts->seed, i);
+    job.agents[i] = qlearn_agent_create_shared (env_get_structure (p_env),
+                                                p_config->gamma,
+                                                p_config->reward,
+                                                p_config->attempts,
+                                                p_result->p_table);
+    if (p_config->replays > 0)
+      qlearn_agent_enable_replay (job.agents[i], p_config->replays,
+                                  p_config->replayCapacity,
+                                  env_agent_seed (job.envs[i]));
+    if (p_config->lambda > 0)
+      qlearn_agent_enable_traces (job.agents[i], p_config->lambda);
+    if (p_config->backups > 0)
+      qlearn_agent_enable_planning (job.agents[i], p_config->backups,
+                                    p_config->threshold,
+                                    env_agent_seed (job.envs[i]));
+  }
+
+  //----------------------------------------
+  // Run workers: the caller works alongside workers-1 threads
+
+  job.start = monotonic_seconds ();
+
+  pthread_t * threads = NULL;
+
+  if (p_opts->workers > 1)
+  {
+    threads = hogwild_malloc (sizeof(pthread_t) * (p_opts->workers-1),
+                              "threads");
+
+    // Workers whose threads cannot be started are run by the others
+    for (i=0 ; i < p_opts->workers-1 ; i++)
+      if (0 == pthread_create (&threads[numLaunched], NULL, worker_main, &job))
+        numLaunched++;
+  }
+
+  worker_main (&job);
+
+  for (i=0 ; i < numLaunched ; i++)
+    pthread_join (threads[i], NULL);
+
+  free (threads);
+
+  p_result->seconds = monotonic_seconds () - job.start;
+
+  for (i=0 ; i < p_opts->workers ; i++)
+  {
+    p_result->truncated += job.envs[i]->stats.truncated;
+    p_result->timeouts += job.envs[i]->stats.timeouts;
+    qlearn_agent_free (job.agents[i]);
+    env_free (job.envs[i]);
+  }
+
+  free (job.envs);
+  free (job.agents);
+
+  if (NULL != p_opts->policy)
+    p_result->mismatches = hogwild_mismatches (p_mdp, p_result->p_table,
+                                               p_opts->policy);
+
+  return p_result;
+} // hogwild_run
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+hogwild_result_free (hogwild_result * p_result)
+{
+  qtable_free (p_result->p_table);
+  free (p_result);
+} // hogwild_result_free
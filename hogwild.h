@@ -0,0 +1,166 @@
+/*
+ * File
+ *   hogwild.h
+ *
+ * Summary
+ *   Parallel Q-learning: worker threads each run their own episodes, with
+ *   their own random number streams, while learning one shared Q table
+ *   (Hogwild!, Niu et al. 2011, when its updates are lock-free; see
+ *   qtable.h). Unlike runner_run, whose replicas learn separately and are
+ *   averaged afterward, every worker benefits at once from the others'
+ *   experience, so a fixed number of trials is spread over the workers.
+ *
+ *   Runs may be timed to convergence: the greedy policy of the shared
+ *   table is compared with a reference (e.g., from policy iteration) at
+ *   regular intervals, and the first time they agree is recorded. Since
+ *   states off the paths the agents favor are tried only a few times,
+ *   agreement may allow some states to differ.
+ *
+ */
+#ifndef __HOGWILD_H__
+#define __HOGWILD_H__
+
+#include <stdint.h>
+
+#include "environment.h"
+#include "qtable.h"
+#include "qlearn_agent.h"
+
+typedef struct {
+  unsigned int workers;    /* Threads sharing the table */
+  unsigned int shards;     /* Row locks of the table; 0 for lock-free
+                              (Hogwild!) updates */
+  unsigned int trials;     /* Trials over all workers */
+  uint64_t seed;           /* Worker w uses env_seed_stream(seed,w) */
+  const unsigned int * policy; /* Reference policy, or NULL */
+  unsigned int checkEvery; /* Trials between comparisons with policy */
+  unsigned int tolerance;  /* States that may differ from policy in
+                              agreement */
+} hogwild_options;
+
+typedef struct {
+  qtable * p_table;        /* The learned table */
+  double seconds;          /* Wall time of the run */
+  double convergedSeconds; /* Wall time at which the greedy policy first
+                              agreed with the reference (negative if
+                              never) */
+  unsigned int convergedTrials; /* Trials completed by then */
+  unsigned int mismatches; /* States whose greedy action differs from the
+                              reference at the end (0 without one) */
+  unsigned long long truncated; /* Trials cut off by the environment's
+                                   limits */
+  unsigned long long timeouts;  /* Workers stopped by the time limit */
+} hogwild_result;
+
+
+/*  Procedure
+ *    hogwild_default_options
+ *
+ *  Purpose
+ *    Produce options for one lock-free worker per processor
+ *
+ *  Parameters
+ *    [None.]
+ *
+ *  Produces
+ *    opts, a hogwild_options
+ *
+ *  Postconditions
+ *    opts.workers is the number of online processors, opts.shards = 0,
+ *    opts.trials = 0, opts.seed = ENVIRONMENT_DEFAULT_SEED,
+ *    opts.policy = NULL, opts.checkEvery = 1, opts.tolerance = 0
+ */
+hogwild_options
+hogwild_default_options (void);
+
+
+/*  Procedure
+ *    hogwild_mismatches
+ *
+ *  Purpose
+ *    Count the states whose greedy action in a table differs from a
+ *    policy
+ *
+ *  Parameters
+ *    p_mdp
+ *    p_table
+ *    policy
+ *
+ *  Produces
+ *    count, an unsigned int
+ *
+ *  Preconditions
+ *    p_table has p_mdp's dimensions; it may be being updated concurrently
+ *    policy has an action for every non-terminal state with actions
+ *
+ *  Postconditions
+ *    count is the number of non-terminal states s having actions for
+ *    which the first available action maximizing Q[s,.] is not policy[s]
+ */
+unsigned int
+hogwild_mismatches (const mdp * p_mdp, const qtable * p_table,
+                    const unsigned int * policy);
+
+
+/*  Procedure
+ *    hogwild_run
+ *
+ *  Purpose
+ *    Learn one Q table with concurrent Q-learning agents
+ *
+ *  Parameters
+ *    p_env
+ *    p_config
+ *    p_opts
+ *
+ *  Produces
+ *    p_result, a hogwild_result*
+ *
+ *  Preconditions
+ *    p_env was produced by env_create
+ *    p_opts->workers > 0
+ *    p_opts->checkEvery > 0 when p_opts->policy is not NULL
+ *
+ *  Postconditions
+ *    Worker w ran about p_opts->trials / p_opts->workers trials (the first
+ *    trials % workers one more) on env_share(p_env) seeded with
+ *    env_seed_stream(p_opts->seed,w), with an agent from
+ *    qlearn_agent_create_shared learning p_result->p_table (replaying from
+ *    its own buffer, following its own traces, and planning with its own
+ *    model, as for qlearn_agent_factory). Each worker's
+ *    trials form one run under p_env->limits.
+ *    With one worker and no shards, p_result->p_table holds the values
+ *    runner_run gives for one replica of qlearn_agent_factory.
+ *    When p_opts->policy is not NULL, the greedy policy was compared with
+ *    it after every p_opts->checkEvery trials (over all workers), agreeing
+ *    when at most p_opts->tolerance states differ.
+ *    p_result must be released with hogwild_result_free.
+ *    Any failure causes program exit.
+ */
+hogwild_result *
+hogwild_run (const environment * p_env, const qlearn_agent_config * p_config,
+             const hogwild_options * p_opts);
+
+
+/*  Procedure
+ *    hogwild_result_free
+ *
+ *  Purpose
+ *    Release the results of hogwild_run
+ *
+ *  Parameters
+ *    p_result
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_result was produced by hogwild_run
+ *
+ *  Postconditions
+ *    All memory for p_result, including its table, is freed
+ */
+void
+hogwild_result_free (hogwild_result * p_result);
+
+#endif // __HOGWILD_H__
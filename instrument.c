@@ -0,0 +1,151 @@
+/*
+ * File
+ *   instrument.c
+ *
+ * Summary
+ *   Process-wide simulation counters and their dump at exit. Compiles to
+ *   nothing unless MDP_INSTRUMENT is defined.
+ *
+ */
+#include "instrument.h"
+
+#ifdef MDP_INSTRUMENT
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+// Names of the phases in the dump
+static const char * phaseName[INSTRUMENT_PHASES] =
+  { "setup", "run", "batch", "replay" };
+
+// Counters (updated with relaxed atomic additions)
+
+static unsigned long long steps;         /* Agent steps */
+static unsigned long long episodes;      /* Finished episodes */
+static unsigned long long terminalHits;  /* Episodes ending in a terminal */
+static unsigned long long histogram[INSTRUMENT_BUCKETS]; /* Episode lengths */
+static unsigned long long phaseNs[INSTRUMENT_PHASES];    /* Time per phase */
+static unsigned long long phaseCalls[INSTRUMENT_PHASES]; /* Uses of a phase */
+
+static pthread_once_t registered = PTHREAD_ONCE_INIT; /* Dump registration */
+
+
+/*  Procedure
+ *    instrument_dump
+ *
+ *  Purpose
+ *    Write the counters as JSON to MDP_INSTRUMENT_FILE or standard error
+ */
+static void
+instrument_dump (void)
+{
+  const char * path = getenv ("MDP_INSTRUMENT_FILE");
+  FILE * out = stderr;
+  unsigned int i, last;
+
+  if (NULL != path && '\0' != path[0])
+  {
+    out = fopen (path, "w");
+
+    if (NULL == out)
+    {
+      fprintf (stderr,"instrument: Unable to open %s (%s)\n", path,
+               strerror (errno));
+      return;
+    }
+  }
+
+  // Omit the empty tail of the histogram
+  for (last=INSTRUMENT_BUCKETS ; last > 1 && 0 == histogram[last-1] ; last--)
+    ;
+
+  // Throughput per thread while simulating
+  double simulating =
+    (phaseNs[INSTRUMENT_RUN] + phaseNs[INSTRUMENT_BATCH]) * 1e-9;
+
+  fprintf (out, "{\"steps\": %llu, \"episodes\": %llu, "
+           "\"terminal_hits\": %llu,\n", steps, episodes, terminalHits);
+
+  fprintf (out, " \"steps_per_second\": %.1f,\n",
+           (simulating > 0) ? steps / simulating : 0.0);
+
+  fprintf (out, " \"episode_length_log2_histogram\": [");
+  for (i=0 ; i < last ; i++)
+    fprintf (out, "%s%llu", (i ? ", " : ""), histogram[i]);
+  fprintf (out, "],\n");
+
+  fprintf (out, " \"phases\": {");
+  for (i=0 ; i < INSTRUMENT_PHASES ; i++)
+    fprintf (out, "%s\"%s\": {\"seconds\": %.6f, \"calls\": %llu}",
+             (i ? ", " : ""), phaseName[i], phaseNs[i] * 1e-9, phaseCalls[i]);
+  fprintf (out, "}}\n");
+
+  if (stderr != out)
+    fclose (out);
+} // instrument_dump
+
+
+/*  Procedure
+ *    instrument_register
+ *
+ *  Purpose
+ *    Arrange for the counters to be dumped at exit
+ */
+static void
+instrument_register (void)
+{
+  atexit (instrument_dump);
+} // instrument_register
+
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t
+instrument_now (void)
+{
+  struct timespec ts;
+
+  pthread_once (&registered, instrument_register);
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+} // instrument_now
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+instrument_phase_add (instrument_phase phase, uint64_t start)
+{
+  __atomic_fetch_add (&phaseNs[phase], instrument_now () - start,
+                      __ATOMIC_RELAXED);
+  __atomic_fetch_add (&phaseCalls[phase], 1, __ATOMIC_RELAXED);
+} // instrument_phase_add
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+instrument_steps (unsigned long long count)
+{
+  pthread_once (&registered, instrument_register);
+  __atomic_fetch_add (&steps, count, __ATOMIC_RELAXED);
+} // instrument_steps
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+instrument_episode (unsigned int length, bool terminal)
+{
+  unsigned int bucket = (0 == length) ? 0 : 32 - __builtin_clz (length);
+
+  pthread_once (&registered, instrument_register);
+  __atomic_fetch_add (&episodes, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add (&histogram[bucket], 1, __ATOMIC_RELAXED);
+
+  if (terminal)
+    __atomic_fetch_add (&terminalHits, 1, __ATOMIC_RELAXED);
+} // instrument_episode
+
+#endif // MDP_INSTRUMENT
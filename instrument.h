@@ -0,0 +1,113 @@
+/*
+ * File
+ *   instrument.h
+ *
+ * Summary
+ *   Optional counters for simulation: agent steps, episodes, episodes
+ *   ending in a terminal state, a histogram of episode lengths and the
+ *   wall time of each phase of a run. Counters are process-wide and safe
+ *   to update from many threads.
+ *
+ *   Instrumentation is compiled in only when MDP_INSTRUMENT is defined
+ *   (add -DMDP_INSTRUMENT to CFLAGS); otherwise every INSTRUMENT_ macro
+ *   expands to nothing. When compiled in, the counters are written as a
+ *   JSON object at program exit, to the file named by the environment
+ *   variable MDP_INSTRUMENT_FILE or else to standard error. Its
+ *   steps_per_second is steps over the time spent in the run and batch
+ *   phases, summed over threads (so it is throughput per thread).
+ *
+ */
+#ifndef __INSTRUMENT_H__
+#define __INSTRUMENT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Buckets of the episode-length histogram: bucket 0 counts episodes of
+   length zero and bucket k > 0 those of length in [2^(k-1), 2^k) */
+#define INSTRUMENT_BUCKETS 33
+
+typedef enum {
+  INSTRUMENT_SETUP,   /* Reading models and building samplers */
+  INSTRUMENT_RUN,     /* Running agents trial by trial */
+  INSTRUMENT_BATCH,   /* Running batched agents */
+  INSTRUMENT_REPLAY,  /* Replaying trajectory logs */
+  INSTRUMENT_PHASES   /* Number of phases */
+} instrument_phase;
+
+#ifdef MDP_INSTRUMENT
+
+/*  Procedure
+ *    instrument_now
+ *
+ *  Purpose
+ *    Read a monotonic clock, in nanoseconds
+ */
+uint64_t
+instrument_now (void);
+
+
+/*  Procedure
+ *    instrument_phase_add
+ *
+ *  Purpose
+ *    Charge the time since start to a phase
+ *
+ *  Parameters
+ *    phase
+ *    start
+ *
+ *  Preconditions
+ *    start was produced by instrument_now
+ */
+void
+instrument_phase_add (instrument_phase phase, uint64_t start);
+
+
+/*  Procedure
+ *    instrument_steps
+ *
+ *  Purpose
+ *    Count agent steps
+ *
+ *  Parameters
+ *    steps
+ */
+void
+instrument_steps (unsigned long long steps);
+
+
+/*  Procedure
+ *    instrument_episode
+ *
+ *  Purpose
+ *    Count a finished episode
+ *
+ *  Parameters
+ *    length
+ *    terminal
+ *
+ *  Postconditions
+ *    The episode of length transitions is counted, and counted as a
+ *    terminal hit when terminal is true
+ */
+void
+instrument_episode (unsigned int length, bool terminal);
+
+
+#define INSTRUMENT_PHASE_BEGIN(start) uint64_t start = instrument_now ()
+#define INSTRUMENT_PHASE_END(phase,start) instrument_phase_add (phase, start)
+#define INSTRUMENT_STEPS(steps) instrument_steps (steps)
+#define INSTRUMENT_EPISODE(length,terminal) \
+  instrument_episode (length, terminal)
+
+#else // MDP_INSTRUMENT
+
+#define INSTRUMENT_PHASE_BEGIN(start)
+#define INSTRUMENT_PHASE_END(phase,start)
+#define INSTRUMENT_STEPS(steps)
+#define INSTRUMENT_EPISODE(length,terminal)
+
+#endif // MDP_INSTRUMENT
+
+#endif // __INSTRUMENT_H__
@@ -13,6 +13,17 @@
 
 #include "max.h"
 #include <assert.h>
+#include <stdbool.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MAX_X86 // Vectorized mask procedures are available
+#endif
+
+/* Shortest rows for which MAX_ISA_BEST vectorizes the mask procedures;
+ * below it the horizontal reductions cost more than the scalar loops */
+#define MAX_VECTOR_MIN_LEN 32
 
 /*  Procedure
  *    max_value
@@ -95,3 +106,522 @@ unsigned int arg_max_value(unsigned int len, const unsigned int* indices,
     }
   return arg;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*  Procedure
+ *    max_value_mask
+ *
+ *  Purpose
+ *    Find the largest value in an array, using the indices set in a mask
+ *
+ *  Parameters
+ *   mask
+ *   values
+ *
+ *  Produces,
+ *   largest
+ *
+ *  Preconditions
+ *    mask != 0
+ *    values refers to a valid double array with an entry for every bit
+ *      position set in mask
+ *
+ *  Postconditions
+ *    There exists a j with bit j of mask set such that largest = values[j]
+ *    There does not exist a k with bit k of mask set such that 
+ *      values[k] > largest
+ */
+double max_value_mask(uint64_t mask, const double * values)
+{
+  // Return the value of the argmax
+  return values[arg_max_value_mask(mask, values)];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*  Procedure
+ *    arg_max_value_mask
+ *
+ *  Purpose
+ *    Find the index of a largest value in an array, using the indices set
+ *    in a mask
+ *
+ *  Parameters
+ *   mask
+ *   values
+ *
+ *  Produces,
+ *   index
+ *
+ *  Preconditions
+ *    mask != 0
+ *    values refers to a valid double array with an entry for every bit
+ *      position set in mask
+ *
+ *  Postconditions
+ *    Bit index of mask is set
+ *    There does not exist a k with bit k of mask set such that 
+ *      values[k] > values[index], and no k < index with bit k set
+ *      has values[k] = values[index]
+ */
+unsigned int arg_max_value_mask(uint64_t mask, const double * values)
+{
+  double max;
+  unsigned int arg, i;
+
+  assert (mask != 0);
+
+  arg = __builtin_ctzll (mask); // Start with lowest index as max
+  max = values[arg];
+  mask &= mask - 1;             // Clear lowest set bit
+
+  while (mask)                  // Check the rest
+  {
+    i = __builtin_ctzll (mask);
+    if (max < values[i])        // if value less than current max
+    {
+      max = values[i];          // re-assign max to value
+      arg = i;
+    }
+    mask &= mask - 1;
+  }
+  return arg;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*  Procedure
+ *    arg_max_explore_mask
+ *
+ *  Purpose
+ *    In one pass over the indices set in a mask, find the largest value
+ *    and the index maximizing an optimistic exploration function
+ *
+ *  Parameters
+ *   mask
+ *   values
+ *   counts
+ *   minCount
+ *   bonus
+ *   p_max
+ *
+ *  Produces,
+ *   index
+ *
+ *  Preconditions
+ *    mask != 0
+ *    values and counts refer to valid arrays with an entry for every bit
+ *      position set in mask
+ *    p_max points to a double
+ *
+ *  Postconditions
+ *    With f(k) = bonus when counts[k] < minCount and values[k] otherwise,
+ *      index = arg_max_value_mask over f (the first largest f(k) with bit
+ *      k of mask set)
+ *    *p_max = max_value_mask(mask, values)
+ */
+unsigned int arg_max_explore_mask(uint64_t mask, const double * values,
+                                  const uint32_t * counts, double minCount,
+                                  double bonus, double * p_max)
+{
+  double max, best, f;
+  unsigned int arg, i;
+
+  assert (mask != 0);
+
+  arg = __builtin_ctzll (mask); // Start with lowest index as max
+  max = values[arg];
+  best = (counts[arg] < minCount) ? bonus : values[arg];
+  mask &= mask - 1;             // Clear lowest set bit
+
+  while (mask)                  // Check the rest
+  {
+    i = __builtin_ctzll (mask);
+    if (max < values[i])
+      max = values[i];
+
+    f = (counts[i] < minCount) ? bonus : values[i];
+    if (best < f)               // if f less than current best
+    {
+      best = f;                 // re-assign best to f
+      arg = i;
+    }
+    mask &= mask - 1;
+  }
+
+  *p_max = max;
+  return arg;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MAX_X86
+
+/*  Procedure
+ *    reduce_mask_avx2
+ *
+ *  Purpose
+ *    Find the first index maximizing values (or, when explore, the
+ *    exploration function of arg_max_explore_mask) over the indices set
+ *    in a mask, four at a time
+ *
+ *  Practica
+ *    Always inlined with a constant explore. Entries outside the mask are
+ *    never loaded (masked loads) and count as -infinity. Each lane keeps
+ *    its best candidate, replacing it only when strictly larger, so it
+ *    holds its earliest largest; the lanes are then reduced with ties going
+ *    to the lower index. Masks whose candidates are all -infinity or NaN
+ *    are left to the scalar procedures.
+ */
+__attribute__((target("avx2"), always_inline))
+static inline unsigned int
+reduce_mask_avx2 (uint64_t mask, const double * values,
+                  const uint32_t * counts, double minCount, double bonus,
+                  double * p_max, const bool explore)
+{
+  const __m256i bit64 = _mm256_set_epi64x (8, 4, 2, 1);
+  const __m128i bit32 = _mm_set_epi32 (8, 4, 2, 1);
+  const __m256d ninf = _mm256_set1_pd (-INFINITY);
+  __m256d vmax = ninf, fbest = ninf;
+  __m256d index = _mm256_set_pd (3, 2, 1, 0), ibest = index;
+  unsigned int end = 64 - __builtin_clzll (mask);
+  unsigned int i;
+
+  for (i=0 ; i < end ; i+=4)
+  {
+    unsigned int bits = (mask >> i) & 15;
+    __m256i lanes = _mm256_cmpeq_epi64 (_mm256_and_si256 (
+                      _mm256_set1_epi64x (bits), bit64), bit64);
+    __m256d v = _mm256_blendv_pd (ninf, _mm256_maskload_pd (values+i, lanes),
+                                  _mm256_castsi256_pd (lanes));
+    __m256d f = v;
+
+    if (explore)
+    {
+      __m128i lanes32 = _mm_cmpeq_epi32 (_mm_and_si128 (
+                          _mm_set1_epi32 (bits), bit32), bit32);
+      __m128i n = _mm_maskload_epi32 ((const int*)(counts+i), lanes32);
+
+      // Unsigned to double: flip the sign bit, convert, add 2^31 back
+      __m256d count = _mm256_add_pd (_mm256_cvtepi32_pd (
+                        _mm_xor_si128 (n, _mm_set1_epi32 (INT32_MIN))),
+                        _mm256_set1_pd (2147483648.0));
+      __m256d few = _mm256_and_pd (_mm256_castsi256_pd (lanes),
+                      _mm256_cmp_pd (count, _mm256_set1_pd (minCount),
+                                     _CMP_LT_OQ));
+
+      vmax = _mm256_max_pd (vmax, v);
+      f = _mm256_blendv_pd (v, _mm256_set1_pd (bonus), few);
+    }
+
+    __m256d better = _mm256_cmp_pd (f, fbest, _CMP_GT_OQ);
+
+    fbest = _mm256_blendv_pd (fbest, f, better);
+    ibest = _mm256_blendv_pd (ibest, index, better);
+    index = _mm256_add_pd (index, _mm256_set1_pd (4));
+  }
+
+  // Broadcast the largest candidate to every lane
+  __m256d top = _mm256_max_pd (fbest, _mm256_permute2f128_pd (fbest, fbest, 1));
+  top = _mm256_max_pd (top, _mm256_permute_pd (top, 5));
+
+  double best = _mm256_cvtsd_f64 (top);
+
+  if (!(best > -INFINITY))
+    return explore ?
+      arg_max_explore_mask (mask, values, counts, minCount, bonus, p_max) :
+      arg_max_value_mask (mask, values);
+
+  if (explore)
+  {
+    __m256d m = _mm256_max_pd (vmax, _mm256_permute2f128_pd (vmax, vmax, 1));
+    *p_max = _mm256_cvtsd_f64 (_mm256_max_pd (m, _mm256_permute_pd (m, 5)));
+  }
+
+  unsigned int tied = _mm256_movemask_pd (_mm256_cmp_pd (fbest, top,
+                                                         _CMP_EQ_OQ));
+
+  if (end <= 4) // One vector: lane k holds index k
+    return __builtin_ctz (tied);
+
+  double candidate[4];
+  unsigned int arg = UINT32_MAX;
+
+  _mm256_storeu_pd (candidate, ibest);
+  for ( ; tied ; tied &= tied - 1)
+    if ((unsigned int)candidate[__builtin_ctz (tied)] < arg)
+      arg = (unsigned int)candidate[__builtin_ctz (tied)];
+
+  return arg;
+}
+
+/* Mask procedures vectorized with AVX2 */
+
+__attribute__((target("avx2")))
+static double
+max_value_mask_avx2 (uint64_t mask, const double * values)
+{
+  return values[reduce_mask_avx2 (mask, values, NULL, 0, 0, NULL, false)];
+}
+
+__attribute__((target("avx2")))
+static unsigned int
+arg_max_value_mask_avx2 (uint64_t mask, const double * values)
+{
+  return reduce_mask_avx2 (mask, values, NULL, 0, 0, NULL, false);
+}
+
+__attribute__((target("avx2")))
+static unsigned int
+arg_max_explore_mask_avx2 (uint64_t mask, const double * values,
+                           const uint32_t * counts, double minCount,
+                           double bonus, double * p_max)
+{
+  return reduce_mask_avx2 (mask, values, counts, minCount, bonus, p_max,
+                           true);
+}
+
+
+/*  Procedure
+ *    reduce_mask_sse2
+ *
+ *  Purpose
+ *    As reduce_mask_avx2, two at a time with SSE2
+ *
+ *  Practica
+ *    SSE2 has neither masked loads nor blends: an odd final entry is
+ *    loaded alone, and blends are and/andnot/or.
+ */
+__attribute__((target("sse2"), always_inline))
+static inline unsigned int
+reduce_mask_sse2 (uint64_t mask, const double * values,
+                  const uint32_t * counts, double minCount, double bonus,
+                  double * p_max, const bool explore)
+{
+  // Lane masks of each two-bit slice of mask
+  const __m128d laneTable[4] = {
+    _mm_castsi128_pd (_mm_set_epi64x (0, 0)),
+    _mm_castsi128_pd (_mm_set_epi64x (0, -1)),
+    _mm_castsi128_pd (_mm_set_epi64x (-1, 0)),
+    _mm_castsi128_pd (_mm_set_epi64x (-1, -1)) };
+  const __m128d ninf = _mm_set1_pd (-INFINITY);
+  __m128d vmax = ninf, fbest = ninf;
+  __m128d index = _mm_set_pd (1, 0), ibest = index;
+  unsigned int end = 64 - __builtin_clzll (mask);
+  unsigned int i;
+
+#define MAX_BLEND_SSE2(a,b,m) \
+  _mm_or_pd (_mm_and_pd ((m), (b)), _mm_andnot_pd ((m), (a)))
+
+  for (i=0 ; i < end ; i+=2)
+  {
+    __m128d lanes = laneTable[(mask >> i) & 3];
+    bool pair = (i + 1 < end);
+    __m128d v = MAX_BLEND_SSE2 (ninf, pair ? _mm_loadu_pd (values+i) :
+                                _mm_load_sd (values+i), lanes);
+    __m128d f = v;
+
+    if (explore)
+    {
+      __m128i n = pair ? _mm_loadl_epi64 ((const __m128i*)(counts+i)) :
+                         _mm_cvtsi32_si128 (counts[i]);
+      __m128d count = _mm_add_pd (_mm_cvtepi32_pd (
+                        _mm_xor_si128 (n, _mm_set1_epi32 (INT32_MIN))),
+                        _mm_set1_pd (2147483648.0));
+      __m128d few = _mm_and_pd (lanes, _mm_cmplt_pd (count,
+                                                     _mm_set1_pd (minCount)));
+
+      vmax = _mm_max_pd (vmax, v);
+      f = MAX_BLEND_SSE2 (v, _mm_set1_pd (bonus), few);
+    }
+
+    __m128d better = _mm_cmpgt_pd (f, fbest);
+
+    fbest = MAX_BLEND_SSE2 (fbest, f, better);
+    ibest = MAX_BLEND_SSE2 (ibest, index, better);
+    index = _mm_add_pd (index, _mm_set1_pd (2));
+  }
+
+#undef MAX_BLEND_SSE2
+
+  __m128d top = _mm_max_pd (fbest, _mm_shuffle_pd (fbest, fbest, 1));
+  double best = _mm_cvtsd_f64 (top);
+
+  if (!(best > -INFINITY))
+    return explore ?
+      arg_max_explore_mask (mask, values, counts, minCount, bonus, p_max) :
+      arg_max_value_mask (mask, values);
+
+  if (explore)
+    *p_max = _mm_cvtsd_f64 (_mm_max_pd (vmax, _mm_shuffle_pd (vmax, vmax, 1)));
+
+  unsigned int tied = _mm_movemask_pd (_mm_cmpeq_pd (fbest, top));
+  double candidate[2];
+
+  _mm_storeu_pd (candidate, ibest);
+
+  if (3 == tied) // Both lanes: the lower index wins
+    return (unsigned int)(candidate[0] < candidate[1] ?
+                          candidate[0] : candidate[1]);
+  return (unsigned int)candidate[__builtin_ctz (tied)];
+}
+
+/* Mask procedures vectorized with SSE2 */
+
+__attribute__((target("sse2")))
+static double
+max_value_mask_sse2 (uint64_t mask, const double * values)
+{
+  return values[reduce_mask_sse2 (mask, values, NULL, 0, 0, NULL, false)];
+}
+
+__attribute__((target("sse2")))
+static unsigned int
+arg_max_value_mask_sse2 (uint64_t mask, const double * values)
+{
+  return reduce_mask_sse2 (mask, values, NULL, 0, 0, NULL, false);
+}
+
+__attribute__((target("sse2")))
+static unsigned int
+arg_max_explore_mask_sse2 (uint64_t mask, const double * values,
+                           const uint32_t * counts, double minCount,
+                           double bonus, double * p_max)
+{
+  return reduce_mask_sse2 (mask, values, counts, minCount, bonus, p_max,
+                           true);
+}
+
+#endif // MAX_X86
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*  Procedure
+ *    arg_max_fixed
+ *
+ *  Purpose
+ *    Find index of a largest value over a restricted index set of a length
+ *    known at compile time
+ *
+ *  Practica
+ *    Always inlined with a constant len, so the loops unroll completely.
+ *    Candidates are reduced pairwise with the lower position on the left,
+ *    choosing the right only when strictly larger; this keeps the first
+ *    largest value (as arg_max_value does) and compiles to conditional
+ *    moves rather than branches.
+ */
+static inline __attribute__((always_inline)) unsigned int
+arg_max_fixed (const unsigned int len, const unsigned int* indices,
+               const double * values)
+{
+  double v[MAX_KERNEL_MAX_LEN];
+  unsigned int arg[MAX_KERNEL_MAX_LEN];
+  unsigned int i, width;
+
+#pragma GCC unroll 8
+  for ( i=0 ; i<len ; i++ )
+  {
+    arg[i] = indices[i];
+    v[i] = values[arg[i]];
+  }
+
+#pragma GCC unroll 4
+  for ( width=len/2 ; width>0 ; width/=2 )
+#pragma GCC unroll 4
+    for ( i=0 ; i<width ; i++ )
+    {
+      bool right = v[2*i+1] > v[2*i];
+
+      v[i] = right ? v[2*i+1] : v[2*i];
+      arg[i] = right ? arg[2*i+1] : arg[2*i];
+    }
+
+  return arg[0];
+}
+
+/* Stamp out the max and argmax specializations for one length */
+#define MAX_SPECIALIZE(N)                                                  \
+  static unsigned int                                                      \
+  arg_max_value_##N (unsigned int len, const unsigned int* indices,        \
+                     const double * values)                                \
+  {                                                                        \
+    assert (len == N);                                                     \
+    return arg_max_fixed (N, indices, values);                             \
+  }                                                                        \
+                                                                           \
+  static double                                                            \
+  max_value_##N (unsigned int len, const unsigned int* indices,            \
+                 const double * values)                                    \
+  {                                                                        \
+    assert (len == N);                                                     \
+    return values[arg_max_fixed (N, indices, values)];                     \
+  }
+
+MAX_SPECIALIZE(2)
+MAX_SPECIALIZE(4)
+MAX_SPECIALIZE(8)
+
+////////////////////////////////////////////////////////////////////////////////
+max_kernel max_select_kernel(unsigned int len)
+{
+  return max_select_kernel_isa (len, MAX_ISA_BEST);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+max_kernel max_select_kernel_isa(unsigned int len, max_isa isa)
+{
+  max_kernel kernel;
+
+  switch (len)
+  {
+  case 2:
+    kernel.max_value = max_value_2;
+    kernel.arg_max_value = arg_max_value_2;
+    break;
+  case 4:
+    kernel.max_value = max_value_4;
+    kernel.arg_max_value = arg_max_value_4;
+    break;
+  case 8:
+    kernel.max_value = max_value_8;
+    kernel.arg_max_value = arg_max_value_8;
+    break;
+  default: // Generic fallback
+    kernel.max_value = max_value;
+    kernel.arg_max_value = arg_max_value;
+  }
+
+  // Mask procedures: the best supported instruction set up to isa
+#ifdef MAX_X86
+  __builtin_cpu_init ();
+
+  if (MAX_ISA_BEST == isa && len < MAX_VECTOR_MIN_LEN)
+    isa = MAX_ISA_SCALAR;
+
+  if (isa >= MAX_ISA_AVX2 && __builtin_cpu_supports ("avx2"))
+  {
+    kernel.max_value_mask = max_value_mask_avx2;
+    kernel.arg_max_value_mask = arg_max_value_mask_avx2;
+    kernel.arg_max_explore_mask = arg_max_explore_mask_avx2;
+    kernel.isa = MAX_ISA_AVX2;
+    return kernel;
+  }
+
+  if (isa >= MAX_ISA_SSE2 && __builtin_cpu_supports ("sse2"))
+  {
+    kernel.max_value_mask = max_value_mask_sse2;
+    kernel.arg_max_value_mask = arg_max_value_mask_sse2;
+    kernel.arg_max_explore_mask = arg_max_explore_mask_sse2;
+    kernel.isa = MAX_ISA_SSE2;
+    return kernel;
+  }
+#endif // MAX_X86
+
+  kernel.max_value_mask = max_value_mask;
+  kernel.arg_max_value_mask = arg_max_value_mask;
+  kernel.arg_max_explore_mask = arg_max_explore_mask;
+  kernel.isa = MAX_ISA_SCALAR;
+
+  return kernel;
+}
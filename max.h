@@ -13,6 +13,8 @@
 #ifndef __MAX_H__
 #define __MAX_H__
 
+#include <stdint.h>
+
 /*  Procedure
  *    max_value
  *
@@ -72,4 +74,192 @@ double max_value(unsigned int len, const unsigned int* indices,
 unsigned int arg_max_value(unsigned int len, const unsigned int* indices, 
 			   const double * values);
 
+
+/*  Procedure
+ *    max_value_mask
+ *
+ *  Purpose
+ *    Find the largest value in an array, using the indices set in a mask
+ *
+ *  Parameters
+ *   mask
+ *   values
+ *
+ *  Produces,
+ *   largest
+ *
+ *  Preconditions
+ *    mask != 0
+ *    values refers to a valid double array with an entry for every bit
+ *      position set in mask
+ *
+ *  Postconditions
+ *    There exists a j with bit j of mask set such that largest = values[j]
+ *    There does not exist a k with bit k of mask set such that 
+ *      values[k] > largest
+ */
+double max_value_mask(uint64_t mask, const double * values);
+
+
+/*  Procedure
+ *    arg_max_value_mask
+ *
+ *  Purpose
+ *    Find the index of a largest value in an array, using the indices set
+ *    in a mask
+ *
+ *  Parameters
+ *   mask
+ *   values
+ *
+ *  Produces,
+ *   index
+ *
+ *  Preconditions
+ *    mask != 0
+ *    values refers to a valid double array with an entry for every bit
+ *      position set in mask
+ *
+ *  Postconditions
+ *    Bit index of mask is set
+ *    There does not exist a k with bit k of mask set such that 
+ *      values[k] > values[index], and no k < index with bit k set
+ *      has values[k] = values[index]
+ */
+unsigned int arg_max_value_mask(uint64_t mask, const double * values);
+
+/* Signatures of max_value and arg_max_value, shared by their specializations */
+typedef double (*max_value_fn) (unsigned int len, const unsigned int* indices,
+                                const double * values);
+typedef unsigned int (*arg_max_value_fn) (unsigned int len,
+                                          const unsigned int* indices,
+                                          const double * values);
+
+
+
+/*  Procedure
+ *    arg_max_explore_mask
+ *
+ *  Purpose
+ *    In one pass over the indices set in a mask, find the largest value
+ *    and the index maximizing an optimistic exploration function
+ *
+ *  Parameters
+ *   mask
+ *   values
+ *   counts
+ *   minCount
+ *   bonus
+ *   p_max
+ *
+ *  Produces,
+ *   index
+ *
+ *  Preconditions
+ *    mask != 0
+ *    values and counts refer to valid arrays with an entry for every bit
+ *      position set in mask
+ *    p_max points to a double
+ *
+ *  Postconditions
+ *    With f(k) = bonus when counts[k] < minCount and values[k] otherwise,
+ *      index = arg_max_value_mask over f (the first largest f(k) with bit
+ *      k of mask set)
+ *    *p_max = max_value_mask(mask, values)
+ */
+unsigned int arg_max_explore_mask(uint64_t mask, const double * values,
+                                  const uint32_t * counts, double minCount,
+                                  double bonus, double * p_max);
+
+/* Signatures of the mask procedures, shared by their vectorized versions */
+typedef double (*max_value_mask_fn) (uint64_t mask, const double * values);
+typedef unsigned int (*arg_max_value_mask_fn) (uint64_t mask,
+                                               const double * values);
+typedef unsigned int (*arg_max_explore_mask_fn) (uint64_t mask,
+                                                 const double * values,
+                                                 const uint32_t * counts,
+                                                 double minCount,
+                                                 double bonus,
+                                                 double * p_max);
+
+/* Largest index-set length having a specialized kernel */
+#define MAX_KERNEL_MAX_LEN 8
+
+/* Instruction sets the mask procedures may be vectorized with */
+typedef enum {
+  MAX_ISA_SCALAR, /* Portable C */
+  MAX_ISA_SSE2,   /* Two doubles at a time (x86) */
+  MAX_ISA_AVX2,   /* Four doubles at a time, with masked loads (x86) */
+  MAX_ISA_BEST    /* The fastest for the length on the running processor */
+} max_isa;
+
+/* Max and argmax procedures chosen for one index-set length and processor */
+typedef struct {
+  max_value_fn max_value;
+  arg_max_value_fn arg_max_value;
+  max_value_mask_fn max_value_mask;
+  arg_max_value_mask_fn arg_max_value_mask;
+  arg_max_explore_mask_fn arg_max_explore_mask;
+  max_isa isa;            /* Instruction set of the mask procedures */
+} max_kernel;
+
+
+/*  Procedure
+ *    max_select_kernel
+ *
+ *  Purpose
+ *    Choose max and argmax procedures specialized for an index-set length
+ *
+ *  Parameters
+ *   len
+ *
+ *  Produces,
+ *   kernel, a max_kernel
+ *
+ *  Preconditions
+ *    len > 0
+ *
+ *  Postconditions
+ *    When len is 2, 4 or 8, kernel holds fully unrolled, branch-free
+ *      procedures that must only be called with that len; otherwise
+ *      kernel holds max_value and arg_max_value.
+ *    Either way, kernel.max_value and kernel.arg_max_value satisfy the
+ *      postconditions of max_value and arg_max_value, including returning
+ *      the first of several equal largest values.
+ *    The mask procedures of kernel, for any mask, are those of
+ *      max_select_kernel_isa(len, MAX_ISA_BEST).
+ *    Intended to be called once, when an MDP is loaded, rather than per use.
+ */
+max_kernel max_select_kernel(unsigned int len);
+
+
+/*  Procedure
+ *    max_select_kernel_isa
+ *
+ *  Purpose
+ *    Choose max and argmax procedures, with the mask procedures vectorized
+ *    for a given instruction set
+ *
+ *  Parameters
+ *   len
+ *   isa
+ *
+ *  Produces,
+ *   kernel, a max_kernel
+ *
+ *  Preconditions
+ *    len > 0
+ *
+ *  Postconditions
+ *    kernel is as for max_select_kernel(len), except that its mask
+ *      procedures use isa, or the best instruction set below it that the
+ *      processor supports; kernel.isa records which. MAX_ISA_BEST is the
+ *      best supported one for rows of 32 or more entries and
+ *      MAX_ISA_SCALAR for shorter rows, where vectorizing measured slower. The vectorized
+ *      procedures never read an entry beyond the highest set bit of mask
+ *      and give the same results as max_value_mask, arg_max_value_mask
+ *      and arg_max_explore_mask.
+ */
+max_kernel max_select_kernel_isa(unsigned int len, max_isa isa);
+
 #endif // __MAX_H__
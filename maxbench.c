@@ -0,0 +1,227 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "max.h"
+
+/*
+ * Usage: maxbench [actions [available [rows]]]
+ *
+ * Microbenchmark of the max/argmax procedures on random rows of actions
+ * values (default 4) of which available (default all) are set in each
+ * row's mask, as a Q-learning agent sees them. Times, per row:
+ *
+ *   - the index-set procedures (generic and specialized for the length);
+ *   - the mask procedures for each instruction set;
+ *   - one exploration step done the old way (max over the row, a loop
+ *     evaluating the exploration function, then argmax over it) against
+ *     the fused arg_max_explore_mask for each instruction set.
+ *
+ * Every vectorized result is first checked against the scalar one.
+ */
+
+#define MAXBENCH_REPEATS 200 /* Passes over the rows per timing */
+
+static const char * isaName[] = { "scalar", "sse2", "avx2" };
+
+/* Data shared by the timed loops */
+static unsigned int A, R;           /* Actions per row, rows */
+static double * values;             /* R rows of A values */
+static uint32_t * counts;           /* R rows of A visit counts */
+static uint64_t * masks;            /* Availability mask of each row */
+static unsigned int * indices;      /* Available actions of each row */
+static unsigned int * numIndices;   /* Number of available actions */
+static const double minCount = 5;   /* Visits before values are trusted */
+static const double bonus = 2;      /* Optimistic value of untried pairs */
+
+/* Read a monotonic clock, in seconds */
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+} // now
+
+/* Report the time per row of a loop over every row */
+#define MAXBENCH_TIME(label, body)                                         \
+  do {                                                                     \
+    unsigned long long sink = 0;                                           \
+    unsigned int rep, r;                                                   \
+    double start = now ();                                                 \
+    for (rep=0 ; rep < MAXBENCH_REPEATS ; rep++)                           \
+      for (r=0 ; r < R ; r++)                                              \
+      {                                                                    \
+        body;                                                              \
+      }                                                                    \
+    double ns = (now () - start) * 1e9 / ((double)R * MAXBENCH_REPEATS);   \
+    printf ("  %-36s %7.2f ns  (%llu)\n", label, ns, sink);                \
+  } while (0)
+
+int
+main (int argc, char* argv[])
+{
+  unsigned int available, r, a, isa, mismatches = 0;
+
+  A = (argc > 1) ? (unsigned int)strtoul (argv[1], NULL, 10) : 4;
+  available = (argc > 2) ? (unsigned int)strtoul (argv[2], NULL, 10) : A;
+  R = (argc > 3) ? (unsigned int)strtoul (argv[3], NULL, 10) : 4096;
+
+  if (argc > 4 || A < 1 || A > 64 || available < 1 || available > A ||
+      R < 1)
+  {
+    fprintf (stderr,"Usage: %s [actions [available [rows]]]\n"
+             "  1 <= available <= actions <= 64\n", argv[0]);
+    exit (EXIT_FAILURE);
+  }
+
+  values = malloc (sizeof(double) * R * A);
+  counts = malloc (sizeof(uint32_t) * R * A);
+  masks = malloc (sizeof(uint64_t) * R);
+  indices = malloc (sizeof(unsigned int) * R * A);
+  numIndices = malloc (sizeof(unsigned int) * R);
+  double * explore = malloc (sizeof(double) * A);
+
+  if (!values || !counts || !masks || !indices || !numIndices || !explore)
+  {
+    fprintf (stderr,"%s: Unable to allocate rows\n", argv[0]);
+    exit (EXIT_FAILURE);
+  }
+
+  //----------------------------------------
+  // Random rows: coarse values so ties occur, and random availability
+
+  srand (1);
+  for (r=0 ; r < R ; r++)
+  {
+    uint64_t mask = 0;
+    unsigned int chosen = 0;
+
+    for (a=0 ; a < A ; a++)
+    {
+      values[r*A + a] = (rand () % 16) / 8.0 - 1.0;
+      counts[r*A + a] = rand () % 10;
+    }
+
+    while (chosen < available)
+    {
+      a = rand () % A;
+      if (0 == ((mask >> a) & 1))
+      {
+        mask |= (uint64_t)1 << a;
+        chosen++;
+      }
+    }
+
+    masks[r] = mask;
+    numIndices[r] = 0;
+    for (a=0 ; a < A ; a++)
+      if ((mask >> a) & 1)
+        indices[r*A + numIndices[r]++] = a;
+  }
+
+  //----------------------------------------
+  // Check every instruction set against the scalar procedures
+
+  for (isa=MAX_ISA_SSE2 ; isa <= MAX_ISA_AVX2 ; isa++)
+  {
+    max_kernel k = max_select_kernel_isa (A, isa);
+
+    if (k.isa != isa)
+      continue;
+
+    for (r=0 ; r < R ; r++)
+    {
+      const double * row = values + (size_t)r*A;
+      const uint32_t * n = counts + (size_t)r*A;
+      double maxScalar, maxVector;
+
+      if (k.arg_max_value_mask (masks[r], row) !=
+          arg_max_value_mask (masks[r], row) ||
+          k.max_value_mask (masks[r], row) !=
+          max_value_mask (masks[r], row) ||
+          k.arg_max_explore_mask (masks[r], row, n, minCount, bonus,
+                                  &maxVector) !=
+          arg_max_explore_mask (masks[r], row, n, minCount, bonus,
+                                &maxScalar) ||
+          maxVector != maxScalar)
+        mismatches++;
+    }
+  }
+
+  printf ("%u actions, %u available, %u rows: %u mismatches\n",
+          A, available, R, mismatches);
+
+  //----------------------------------------
+  // Time the procedures
+
+  max_kernel fixed = max_select_kernel_isa (A, MAX_ISA_SCALAR);
+
+  printf ("argmax of values\n");
+
+  MAXBENCH_TIME ("arg_max_value (index set)",
+                 sink += arg_max_value (numIndices[r], indices + r*A,
+                                        values + (size_t)r*A));
+  if (available == A)
+    MAXBENCH_TIME ("specialized arg_max_value (index set)",
+                   sink += fixed.arg_max_value (A, indices + r*A,
+                                                values + (size_t)r*A));
+
+  for (isa=MAX_ISA_SCALAR ; isa <= MAX_ISA_AVX2 ; isa++)
+  {
+    max_kernel k = max_select_kernel_isa (A, isa);
+    char label[64];
+
+    if (k.isa != isa)
+      continue;
+
+    snprintf (label, sizeof(label), "arg_max_value_mask (%s)", isaName[isa]);
+    MAXBENCH_TIME (label, sink += k.arg_max_value_mask (masks[r],
+                                                        values + (size_t)r*A));
+  }
+
+  printf ("exploration step (max value and argmax of exploration)\n");
+
+  MAXBENCH_TIME ("max, explore loop, argmax (mask)",
+    {
+      const double * row = values + (size_t)r*A;
+      const uint32_t * n = counts + (size_t)r*A;
+      double max = max_value_mask (masks[r], row);
+
+      for (a=0 ; a < A ; a++)
+        if ((masks[r] >> a) & 1)
+          explore[a] = (n[a] < minCount) ? bonus : row[a];
+      sink += arg_max_value_mask (masks[r], explore) + (max > 0);
+    });
+
+  for (isa=MAX_ISA_SCALAR ; isa <= MAX_ISA_AVX2 ; isa++)
+  {
+    max_kernel k = max_select_kernel_isa (A, isa);
+    char label[64];
+
+    if (k.isa != isa)
+      continue;
+
+    snprintf (label, sizeof(label), "arg_max_explore_mask (%s)",
+              isaName[isa]);
+    MAXBENCH_TIME (label,
+      {
+        double max;
+        sink += k.arg_max_explore_mask (masks[r], values + (size_t)r*A,
+                                        counts + (size_t)r*A, minCount,
+                                        bonus, &max) + (max > 0);
+      });
+  }
+
+  free (values);
+  free (counts);
+  free (masks);
+  free (indices);
+  free (numIndices);
+  free (explore);
+
+  return (0 == mismatches) ? EXIT_SUCCESS : EXIT_FAILURE;
+} // main
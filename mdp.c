@@ -36,7 +36,7 @@
  *    *p_numStates contains the first unsigned integer, representing
  *    the number of MDP states. 
  *    *p_numActions contains the second unsigned integer, representing 
- *    the number of MDP actions. 
+ *    the number of MDP actions, which is at most MDP_MAX_ACTIONS. 
  *    stream has advanced only to just past these two values.
  *    Any failure causes program exit.
  */
@@ -94,6 +94,15 @@ mdp_read_dimensions (FILE * stream, unsigned int * p_numStates,
              "Unable to match unsigned int for numActions");
     exit (EXIT_FAILURE);
   }
+
+  // Validate number of actions (must fit in an action mask)
+  if (*p_numActions > MDP_MAX_ACTIONS)
+  {
+    fprintf (stderr,
+             "mdp_read_dimensions failed: %s\n",
+             "Number of actions exceeds MDP_MAX_ACTIONS");
+    exit (EXIT_FAILURE);
+  }
     
 } // mdp_read_dimensions
 
@@ -154,6 +163,18 @@ mdp_read_start (FILE * stream, mdp * p_mdp)
 ////////////////////////////////////////////////////////////////////////////////
 mdp *
 mdp_malloc (const unsigned int numStates, const unsigned int numActions)
+{
+  mdp * p_mdp = mdp_malloc_structure (numStates);
+
+  p_mdp->transitionProb = mdp_malloc_transitions (numStates, numActions);
+
+  return p_mdp;
+} // mdp_malloc
+
+
+////////////////////////////////////////////////////////////////////////////////
+mdp *
+mdp_malloc_structure (const unsigned int numStates)
 {
 
   //----------------------------------------
@@ -170,9 +191,9 @@ mdp_malloc (const unsigned int numStates, const unsigned int numActions)
   }
   
   //----------------------------------------
-  // Transition probability
+  // Transition probability (allocated only by mdp_malloc)
 
-  p_mdp->transitionProb = mdp_malloc_transitions (numStates, numActions);
+  p_mdp->transitionProb = NULL;
 
 
   //----------------------------------------
@@ -201,6 +222,22 @@ mdp_malloc (const unsigned int numStates, const unsigned int numActions)
     exit (EXIT_FAILURE);
   }
 
+  //----------------------------------------
+  // Action masks and offsets
+  p_mdp->actionMask = calloc (numStates, sizeof(uint64_t));
+  p_mdp->actionOffset = malloc (sizeof(unsigned int) * (numStates+1));
+
+  if  ( NULL == p_mdp->actionMask || NULL == p_mdp->actionOffset )
+  {
+    fprintf (stderr,"mdp_malloc failed: %s (%s)\n",
+             "Could not allocate actionMask or actionOffset",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  // FLAT LIST CANNOT BE ALLOCATED UNTIL numAvailableActions is known
+  p_mdp->actionList = NULL;
+
   //----------------------------------------
   // Rewards
 
@@ -215,8 +252,8 @@ mdp_malloc (const unsigned int numStates, const unsigned int numActions)
   }
 
   //----------------------------------------
-  // Terminal states
-  p_mdp->terminal = malloc (sizeof(unsigned int) * numStates);
+  // Terminal states (zeroed by calloc)
+  p_mdp->terminal = calloc (numStates, sizeof(bool));
 
   if  ( NULL == p_mdp->terminal )
   {
@@ -226,12 +263,53 @@ mdp_malloc (const unsigned int numStates, const unsigned int numActions)
     exit (EXIT_FAILURE);
   }
 
-  // Initialize to zero
-  memset ( p_mdp->terminal, 0, sizeof(unsigned int) * numStates );
+  p_mdp->terminalBits = calloc ((numStates + 63) / 64, sizeof(uint64_t));
+
+  if  ( NULL == p_mdp->terminalBits )
+  {
+    fprintf (stderr,"mdp_malloc failed: %s (%s)\n",
+             "Could not allocate terminalBits",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  //----------------------------------------
+  // Packed state metadata, aligned so no entry straddles a cache line
+  if ( 0 != posix_memalign ((void**)&p_mdp->stateInfo, 64,
+                            sizeof(mdp_state_info) * numStates) )
+  {
+    fprintf (stderr,"mdp_malloc failed: %s\n",
+             "Could not allocate stateInfo");
+    exit (EXIT_FAILURE);
+  }
+
+  memset ( p_mdp->stateInfo, 0, sizeof(mdp_state_info) * numStates );
 
   
   return p_mdp;
-} // mdp_read_start
+} // mdp_malloc_structure
+
+////////////////////////////////////////////////////////////////////////////////
+void
+mdp_pack_state_info (mdp * p_mdp)
+{
+  unsigned int s;
+
+  memset ( p_mdp->terminalBits, 0,
+           sizeof(uint64_t) * ((p_mdp->numStates + 63) / 64) );
+
+  for ( s=0 ; s < p_mdp->numStates ; s++ )
+  {
+    p_mdp->stateInfo[s].reward = p_mdp->rewards[s];
+    p_mdp->stateInfo[s].actionMask = p_mdp->actionMask[s];
+    p_mdp->stateInfo[s].numAvailableActions = p_mdp->numAvailableActions[s];
+    p_mdp->stateInfo[s].terminal = p_mdp->terminal[s];
+
+    if (p_mdp->terminal[s])
+      p_mdp->terminalBits[s >> 6] |= (uint64_t)1 << (s & 63);
+  }
+} // mdp_pack_state_info
+
 
 ////////////////////////////////////////////////////////////////////////////////
 double ***
@@ -350,52 +428,53 @@ mdp_free_state_action ( unsigned int numStates, double ** count )
 } // mdp_free_state_action
 
 
-/*  Procedure
- *    mdp_malloc_actions
- *
- *  Purpose
- *    Allocate arrays for the available number of actions
- *
- *  Parameters
- *    p_mdp
- *
- *  Produces,
- *   [Nothing.]
- *
- *  Preconditions
- *    p_mdp points to a valid mdp struct
- *    p_mdp->numAvailableActions is a valid pointer to an array of
- *    length p_mdp->numStates with non-negative entries strictly less
- *    than p_mdp->numActions.
- *    p_mdp->actions is a valid pointer to an array of length p_mdp->numStates
- *
- *  Postconditions
- *    For 0 <= i < p_mdp->numStates, p_mdp->actions[i] is a valid
- *    pointer to an unsigned int array of length
- *    p_mdp->numAvailableActions[i],
- *    Any failure causes program exit.
- */
+////////////////////////////////////////////////////////////////////////////////
 void
 mdp_malloc_actions (mdp * p_mdp)
 {
   unsigned int i;
 
+  // Offsets of each state's actions in the flat list
+  p_mdp->actionOffset[0] = 0;
   for ( i=0 ; i < p_mdp->numStates ; i++)
+    p_mdp->actionOffset[i+1] = p_mdp->actionOffset[i] + 
+                               p_mdp->numAvailableActions[i];
+
+  // Allocate at least one entry so an MDP without actions still has a list
+  p_mdp->actionList = malloc ( sizeof(unsigned int) * 
+                               (p_mdp->actionOffset[p_mdp->numStates] + 1) );
+
+  if ( NULL == p_mdp->actionList )
   {
-    p_mdp->actions[i] = malloc ( sizeof(unsigned int) * 
-                                 p_mdp->numAvailableActions[i] );
+    fprintf (stderr,"mdp_malloc_actions failed: %s (%s)\n",
+             "Could not allocate actionList",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
 
-    if ( NULL == p_mdp->actions[i] )
-    {
-      fprintf (stderr,"mdp_malloc_actions failed: %s (%s)\n",
-               "Could not allocate actions[i]",
-               strerror (errno));
-      exit (EXIT_FAILURE);
-    }
+  for ( i=0 ; i < p_mdp->numStates ; i++)
+  {
+    p_mdp->actions[i] = p_mdp->actionList + p_mdp->actionOffset[i];
+    p_mdp->actionMask[i] = 0;
   }
 } // mdp_malloc_actions
 
 
+////////////////////////////////////////////////////////////////////////////////
+void
+mdp_set_action_masks (mdp * p_mdp)
+{
+  unsigned int i,j;
+
+  for ( i=0 ; i < p_mdp->numStates ; i++)
+  {
+    p_mdp->actionMask[i] = 0;
+    for ( j=0 ; j < p_mdp->numAvailableActions[i] ; j++)
+      p_mdp->actionMask[i] |= (uint64_t)1 << p_mdp->actions[i][j];
+  }
+} // mdp_set_action_masks
+
+
 /*  Procedure
  *    mdp_read_transitions
  *
@@ -557,16 +636,18 @@ mdp_duplicate ( mdp * p_mdp )
     for ( t=0 ; t < p_mdp->numStates ; t++)
       memcpy ( p_mdp_out->transitionProb[s][t],
                p_mdp->transitionProb[s][t],
-               sizeof(unsigned int) *  p_mdp->numActions);
+               sizeof(double) *  p_mdp->numActions);
 
   // Allocate actions
   mdp_malloc_actions ( p_mdp_out );
 
-  // Copy available actions to output struct
-  for ( s=0 ; s < p_mdp->numStates ; s++)
-    memcpy ( p_mdp_out->actions[s], 
-             p_mdp->actions[s], 
-             sizeof(unsigned int) * p_mdp->numAvailableActions[s] );
+  // Copy available actions and their masks to output struct
+  memcpy ( p_mdp_out->actionList,
+           p_mdp->actionList,
+           sizeof(unsigned int) * p_mdp->actionOffset[p_mdp->numStates] );
+  memcpy ( p_mdp_out->actionMask,
+           p_mdp->actionMask,
+           sizeof(uint64_t) * p_mdp->numStates );
   
   // Copy rewards to output
   memcpy ( p_mdp_out->rewards,
@@ -576,12 +657,76 @@ mdp_duplicate ( mdp * p_mdp )
   // Copy terminals to output
   memcpy ( p_mdp_out->terminal,
            p_mdp->terminal,
-           sizeof(unsigned int) * p_mdp->numStates );
+           sizeof(bool) * p_mdp->numStates );
+
+  // Copy packed metadata to output
+  memcpy ( p_mdp_out->stateInfo,
+           p_mdp->stateInfo,
+           sizeof(mdp_state_info) * p_mdp->numStates );
+  memcpy ( p_mdp_out->terminalBits,
+           p_mdp->terminalBits,
+           sizeof(uint64_t) * ((p_mdp->numStates + 63) / 64) );
   
   return p_mdp_out;
 } // mdp_duplicate
 
 
+////////////////////////////////////////////////////////////////////////////////
+mdp *
+mdp_duplicate_structure ( const mdp * p_mdp )
+{
+  mdp * p_mdp_out = mdp_structure ( p_mdp );
+
+  // Allocate zeroed transitions for the learner to fill in
+  p_mdp_out->transitionProb = mdp_malloc_transitions ( p_mdp->numStates,
+                                                       p_mdp->numActions );
+
+  return p_mdp_out;
+} // mdp_duplicate_structure
+
+
+////////////////////////////////////////////////////////////////////////////////
+mdp *
+mdp_structure ( const mdp * p_mdp )
+{
+  // Allocate a new struct, without transitions
+  mdp * p_mdp_out = mdp_malloc_structure ( p_mdp->numStates );
+
+  // Copy simple data to output struct
+  p_mdp_out->numStates = p_mdp->numStates;
+  p_mdp_out->numActions = p_mdp->numActions;
+  p_mdp_out->start = p_mdp->start;
+
+  // Copy number of available actions to output struct
+  memcpy ( p_mdp_out->numAvailableActions,
+           p_mdp->numAvailableActions,
+           sizeof(unsigned int) * p_mdp->numStates );
+
+  // Allocate actions
+  mdp_malloc_actions ( p_mdp_out );
+
+  // Copy available actions and their masks to output struct
+  memcpy ( p_mdp_out->actionList,
+           p_mdp->actionList,
+           sizeof(unsigned int) * p_mdp->actionOffset[p_mdp->numStates] );
+  memcpy ( p_mdp_out->actionMask,
+           p_mdp->actionMask,
+           sizeof(uint64_t) * p_mdp->numStates );
+
+  // Zero rewards
+  memset ( p_mdp_out->rewards, 0, sizeof(double) * p_mdp->numStates );
+
+  // Copy terminals to output
+  memcpy ( p_mdp_out->terminal,
+           p_mdp->terminal,
+           sizeof(bool) * p_mdp->numStates );
+
+  mdp_pack_state_info ( p_mdp_out );
+
+  return p_mdp_out;
+} // mdp_structure
+
+
 /*  Procedure
  *    mdp_read_actions
  *
@@ -602,6 +747,7 @@ mdp_duplicate ( mdp * p_mdp )
  *
  *  Postconditions
  *    All values in p_mdp->actions are assigned as read from stream
+ *    p_mdp->actionMask[s] has a bit set for each action of state s
  *    Any failure causes program exit.
  */
 void
@@ -646,6 +792,16 @@ mdp_read_actions ( FILE * stream, mdp * p_mdp)
                  "Action index exceeds bound");
 	exit (EXIT_FAILURE);
       }      
+
+      if (p_mdp->actionMask[i] & ((uint64_t)1 << p_mdp->actions[i][j]))
+      {
+	fprintf (stderr,
+                 "mdp_read_actions failed: %s\n",
+                 "Action listed twice for a state");
+	exit (EXIT_FAILURE);
+      }
+
+      p_mdp->actionMask[i] |= (uint64_t)1 << p_mdp->actions[i][j];
     }
 } // mdp_read_actions
 
@@ -807,6 +963,7 @@ mdp_read (const char * fileName)
   mdp_read_actions (stream, p_mdp);  // Read actions
   mdp_read_rewards (stream, p_mdp);  // Read rewards
   mdp_read_terminal (stream, p_mdp); // Read terminal states
+  mdp_pack_state_info (p_mdp);       // Pack per-state metadata
 
   ret = fclose(stream);
 
@@ -860,21 +1017,21 @@ mdp_read_policy (FILE* stream, const mdp * p_mdp, unsigned int * policy)
 void
 mdp_free (mdp * p_mdp)
 {
-  unsigned int i;
-
   //----------------------------------------
-  // Transition probability
-  mdp_free_transitions (p_mdp->numStates, p_mdp->transitionProb);
+  // Transition probability (absent from a structure-only MDP)
+  if (NULL != p_mdp->transitionProb)
+    mdp_free_transitions (p_mdp->numStates, p_mdp->transitionProb);
 
   //----------------------------------------
   // Number of available actions
   free (p_mdp->numAvailableActions);
   
   //----------------------------------------
-  // Available actions
-  for ( i=0 ; i < p_mdp->numStates ; i++)
-    free (p_mdp->actions[i]);
+  // Available actions (each actions[i] points into actionList)
   free (p_mdp->actions);
+  free (p_mdp->actionList);
+  free (p_mdp->actionMask);
+  free (p_mdp->actionOffset);
 
   //----------------------------------------
   // Rewards
@@ -883,6 +1040,11 @@ mdp_free (mdp * p_mdp)
   //----------------------------------------
   // Terminal states
   free(p_mdp->terminal);
+  free(p_mdp->terminalBits);
+
+  //----------------------------------------
+  // Packed state metadata
+  free(p_mdp->stateInfo);
   
   //----------------------------------------
   // Root structure
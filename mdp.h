@@ -13,6 +13,33 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdint.h>
+
+/* Largest number of actions an MDP may have, so that the available actions
+   of a state fit in the bits of an action mask */
+#define MDP_MAX_ACTIONS 64
+
+/* Visit each action a available in a state, given its action mask:
+     MDP_FOR_EACH_ACTION (a, mask) { ... }
+   Actions are visited in increasing order. The mask argument is copied. */
+#define MDP_FOR_EACH_ACTION(a, mask)                                       \
+  for (uint64_t _bits = (mask);                                            \
+       _bits && ((a) = (unsigned int)__builtin_ctzll (_bits), 1);          \
+       _bits &= _bits - 1)
+
+/* The per-state data every backup reads together, packed so that one state
+   occupies half of a 64-byte cache line. Derived from the separate arrays
+   of the mdp struct by mdp_pack_state_info. */
+typedef struct {
+  double reward;           /* Reward for the state */
+  uint64_t actionMask;     /* Bit set of available actions */
+  unsigned int numAvailableActions; /* Number of bits set in actionMask */
+  unsigned int terminal;   /* Nonzero iff the state is terminal */
+} __attribute__((aligned(32))) mdp_state_info;
+
+/* Test the terminal bit of a state */
+#define MDP_IS_TERMINAL(p_mdp, s) \
+  (((p_mdp)->terminalBits[(s) >> 6] >> ((s) & 63)) & 1)
 
 typedef struct {
   unsigned int numStates;  /* Total number of possible states */
@@ -25,11 +52,25 @@ typedef struct {
                                         entry indicates the number of
                                         actions available in the given state */
   unsigned int **actions;  /* A numStates x numAvailableActions[state] length
-                              array of the actions available in a given state */
+                              array of the actions available in a given state;
+                              actions[s] points into actionList */
+  uint64_t *actionMask;    /* A numStates length array of bit sets; bit a of
+                              actionMask[s] is set iff action a is available
+                              in state s */
+  unsigned int *actionOffset; /* A numStates+1 length array; the actions of
+                                 state s are actionList[actionOffset[s]] to
+                                 actionList[actionOffset[s+1]-1] */
+  unsigned int *actionList;/* The available actions of every state, stored
+                              contiguously */
   double *rewards;         /* A numStates length array of the reward
                               for a given state */
   bool *terminal;          /* A numStates length array, each entry indicating
                               whether a given state is terminal */
+  mdp_state_info *stateInfo; /* A numStates length, cache-line aligned array
+                                packing rewards, action masks and terminal
+                                status of each state */
+  uint64_t *terminalBits;  /* A (numStates+63)/64 length bit set; bit s is
+                              set iff state s is terminal */
 } mdp; 
 
 
@@ -70,7 +111,8 @@ mdp_read (const char * fileName);
  *   [Nothing.]
  *
  *  Preconditions
- *    p_mdp points to a valid mdp struct with all fields having valid references
+ *    p_mdp points to a valid mdp struct with all fields having valid
+ *    references, except that transitionProb may be NULL
  *
  *  Postconditions
  *    Memory is freed for all fields in p_mdp
@@ -79,6 +121,139 @@ void
 mdp_free (mdp * p_mdp);
 
 
+/*  Procedure
+ *    mdp_malloc
+ *
+ *  Purpose
+ *    Allocate an MDP struct and its per-state arrays
+ *
+ *  Parameters
+ *    numStates
+ *    numActions
+ *
+ *  Produces,
+ *    p_mdp, an mdp*
+ *
+ *  Preconditions
+ *    numStates > 0
+ *    numActions > 0
+ *
+ *  Postconditions
+ *    p_mdp->transitionProb is allocated and zeroed; numAvailableActions,
+ *    actions (primary array only), rewards, terminal, stateInfo and
+ *    terminalBits are allocated, with terminal initialized to false.
+ *    p_mdp->numStates and p_mdp->numActions are NOT assigned.
+ *    The secondary actions arrays must be allocated with mdp_malloc_actions
+ *    once numAvailableActions is known.
+ *    Any failure causes program exit.
+ */
+mdp *
+mdp_malloc (const unsigned int numStates, const unsigned int numActions);
+
+
+/*  Procedure
+ *    mdp_malloc_structure
+ *
+ *  Purpose
+ *    Allocate an MDP struct and its per-state arrays, without transitions
+ *
+ *  Parameters
+ *    numStates
+ *
+ *  Produces,
+ *    p_mdp, an mdp*
+ *
+ *  Preconditions
+ *    numStates > 0
+ *
+ *  Postconditions
+ *    As for mdp_malloc, except p_mdp->transitionProb is NULL, so only
+ *    O(numStates) memory is allocated.
+ *    Any failure causes program exit.
+ */
+mdp *
+mdp_malloc_structure (const unsigned int numStates);
+
+
+/*  Procedure
+ *    mdp_malloc_actions
+ *
+ *  Purpose
+ *    Allocate arrays for the available number of actions
+ *
+ *  Parameters
+ *    p_mdp
+ *
+ *  Produces,
+ *   [Nothing.]
+ *
+ *  Preconditions
+ *    p_mdp points to a valid mdp struct
+ *    p_mdp->numAvailableActions is a valid pointer to an array of
+ *    length p_mdp->numStates with non-negative entries strictly less
+ *    than p_mdp->numActions.
+ *    p_mdp->actions is a valid pointer to an array of length p_mdp->numStates
+ *
+ *  Postconditions
+ *    p_mdp->actionOffset is a prefix sum of p_mdp->numAvailableActions,
+ *    and p_mdp->actionList has room for every available action.
+ *    For 0 <= i < p_mdp->numStates, p_mdp->actions[i] is a valid
+ *    pointer to an unsigned int array of length
+ *    p_mdp->numAvailableActions[i], within p_mdp->actionList.
+ *    p_mdp->actionMask[i] is zero; it must be filled in (for instance with 
+ *    mdp_set_action_masks) once the actions are assigned.
+ *    Any failure causes program exit.
+ */
+void
+mdp_malloc_actions (mdp * p_mdp);
+
+
+/*  Procedure
+ *    mdp_set_action_masks
+ *
+ *  Purpose
+ *    Compute the action mask of every state from its action list
+ *
+ *  Parameters
+ *    p_mdp
+ *
+ *  Produces,
+ *   [Nothing.]
+ *
+ *  Preconditions
+ *    p_mdp points to a valid mdp struct whose actions are assigned
+ *
+ *  Postconditions
+ *    Bit a of p_mdp->actionMask[s] is set iff a is in p_mdp->actions[s]
+ */
+void
+mdp_set_action_masks (mdp * p_mdp);
+
+
+/*  Procedure
+ *    mdp_pack_state_info
+ *
+ *  Purpose
+ *    Refresh the packed per-state metadata from the per-state arrays
+ *
+ *  Parameters
+ *    p_mdp
+ *
+ *  Produces,
+ *   [Nothing.]
+ *
+ *  Preconditions
+ *    p_mdp points to a valid mdp struct whose rewards, terminal,
+ *    numAvailableActions and actionMask arrays are assigned
+ *
+ *  Postconditions
+ *    p_mdp->stateInfo and p_mdp->terminalBits agree with those arrays.
+ *    Must be called again after any of them change.
+ */
+void
+mdp_pack_state_info (mdp * p_mdp);
+
+
 /*  Procedure
  *    mdp_malloc_transition
  *
@@ -211,6 +386,61 @@ mdp_free_state_action ( unsigned int numStates, double ** count );
 mdp *
 mdp_duplicate ( mdp *  p_mdp);
 
+
+/*  Procedure
+ *    mdp_duplicate_structure
+ *
+ *  Purpose
+ *    Construct a clone of an MDP's states and actions, without its
+ *    transitions and rewards
+ *
+ *  Parameters
+ *    p_mdp
+ *
+ *  Produces,
+ *    p_mdp_out
+ *
+ *  Preconditions
+ *    p_mdp points to a valid mdp struct, whose transitionProb is not read
+ *    (and may be NULL)
+ *
+ *  Postconditions
+ *    p_mdp_out points to a valid mdp struct with the dimensions, start
+ *    state, available actions and terminal states of p_mdp, and with all
+ *    transition probabilities and rewards zero
+ *    mdp_free(p_mdp_out) may be called with no ill-effects upon p_mdp
+ *    Any failure causes program exit.
+ */
+mdp *
+mdp_duplicate_structure ( const mdp * p_mdp );
+
+
+/*  Procedure
+ *    mdp_structure
+ *
+ *  Purpose
+ *    Construct a clone of an MDP's states and actions alone
+ *
+ *  Parameters
+ *    p_mdp
+ *
+ *  Produces,
+ *    p_mdp_out
+ *
+ *  Preconditions
+ *    p_mdp points to a valid mdp struct, whose transitionProb is not read
+ *    (and may be NULL)
+ *
+ *  Postconditions
+ *    As for mdp_duplicate_structure, except p_mdp_out->transitionProb is
+ *    NULL, so the clone takes O(numStates*numActions) time and memory
+ *    rather than O(numStates^2*numActions).
+ *    mdp_free(p_mdp_out) may be called with no ill-effects upon p_mdp
+ *    Any failure causes program exit.
+ */
+mdp *
+mdp_structure ( const mdp * p_mdp );
+
 /*  Procedure
  *    mdp_read_policy
  *
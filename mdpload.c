@@ -0,0 +1,47 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mdp.h"
+#include "alias.h"
+#include "mdpshm.h"
+
+/*
+ * Usage: mdpload mdpfile /name
+ *        mdpload -u /name
+ *
+ * Reads an MDP file once and publishes its simulation model as the POSIX
+ * shared memory object /name, which then persists after mdpload exits.
+ * Any number of td or qlearn processes may use it by giving shm:/name in
+ * place of the MDP file; each attaches the model read-only instead of
+ * parsing and copying it. With -u, removes the model (processes already
+ * running keep their mappings).
+ */
+int
+main (int argc, char* argv[])
+{
+  if (argc != 3)
+  {
+    fprintf (stderr,"Usage: %s mdpfile /name\n"
+             "       %s -u /name\n", argv[0], argv[0]);
+    exit (EXIT_FAILURE);
+  }
+
+  if (0 == strcmp (argv[1], "-u"))
+    exit (mdpshm_unlink (argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+  mdp * p_mdp = mdp_read (argv[1]);
+
+  if (NULL == p_mdp)
+    // mdp_read prints a message upon failure
+    exit (EXIT_FAILURE);
+
+  alias_table * p_table = alias_build (p_mdp);
+
+  bool published = mdpshm_publish (argv[2], p_mdp, p_table);
+
+  alias_free (p_table);
+  mdp_free (p_mdp);
+
+  exit (published ? EXIT_SUCCESS : EXIT_FAILURE);
+} // main
@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "environment.h"
+#include "envserver.h"
+
+/*
+ * Usage: mdpserve mdpfile socketpath
+ *
+ * Serves the MDP (a file, or shm:/name for a model published with
+ * mdpload) to agents in other processes over a Unix domain socket at
+ * socketpath, using the batched step protocol of envserver.h. Each
+ * connection runs on its own thread with its own batch of episodes.
+ * Episodes are capped at MDP_MAX_EPISODE_STEPS steps when that is set.
+ * Runs until interrupted, then removes socketpath.
+ */
+
+static const char * socketPath; /* Socket to remove on exit */
+
+/* Remove the socket and exit on SIGINT or SIGTERM */
+static void
+stop (int sig)
+{
+  (void) sig; // Either signal ends the server
+
+  unlink (socketPath);
+  _exit (EXIT_SUCCESS);
+} // stop
+
+
+int
+main (int argc, char* argv[])
+{
+  if (argc != 3)
+  {
+    fprintf (stderr,"Usage: %s mdpfile socketpath\n", argv[0]);
+    exit (EXIT_FAILURE);
+  }
+
+  environment * p_env = env_create (argv[1]);
+
+  int fd = envserver_listen (argv[2]);
+
+  if (fd < 0)
+    // envserver_listen prints a message upon failure
+    exit (EXIT_FAILURE);
+
+  socketPath = argv[2];
+  signal (SIGINT, stop);
+  signal (SIGTERM, stop);
+
+  envserver_serve (p_env, fd);
+
+  // Only an accept failure gets here
+  close (fd);
+  unlink (socketPath);
+  env_free (p_env);
+  exit (EXIT_FAILURE);
+} // main
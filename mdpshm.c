@@ -0,0 +1,307 @@
+/*
+ * File
+ *   mdpshm.c
+ *
+ * Summary
+ *   Publishing environment models to POSIX shared memory and attaching
+ *   them read-only.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mdp.h"
+#include "alias.h"
+#include "mdpshm.h"
+
+
+/*  Procedure
+ *    mdpshm_layout
+ *
+ *  Purpose
+ *    Assign the offset of every array of a segment from its dimensions
+ *
+ *  Postconditions
+ *    p_header->offset is filled in and p_header->size is the total size
+ */
+static void
+mdpshm_layout (mdpshm_header * p_header)
+{
+  size_t S = p_header->numStates;
+  size_t A = p_header->numActions;
+  size_t bytes[MDPSHM_ARRAYS];
+  size_t offset = sizeof(mdpshm_header);
+  unsigned int i;
+
+  // Lengths match what mdp_malloc and alias_build allocate
+  bytes[MDPSHM_NUM_AVAILABLE] = sizeof(unsigned int) * S;
+  bytes[MDPSHM_ACTION_MASK] = sizeof(uint64_t) * S;
+  bytes[MDPSHM_ACTION_OFFSET] = sizeof(unsigned int) * (S + 1);
+  bytes[MDPSHM_ACTION_LIST] = sizeof(unsigned int) *
+    (p_header->numListed + 1);
+  bytes[MDPSHM_REWARDS] = sizeof(double) * S;
+  bytes[MDPSHM_TERMINAL] = sizeof(bool) * S;
+  bytes[MDPSHM_STATE_INFO] = sizeof(mdp_state_info) * S;
+  bytes[MDPSHM_TERMINAL_BITS] = sizeof(uint64_t) * ((S + 63) / 64);
+  bytes[MDPSHM_ALIAS_OFFSET] = sizeof(unsigned int) * (S*A + 1);
+  bytes[MDPSHM_ALIAS_OUTCOME] = sizeof(unsigned int) * p_header->numColumns;
+  bytes[MDPSHM_ALIAS_ALIAS] = sizeof(unsigned int) * p_header->numColumns;
+  bytes[MDPSHM_ALIAS_THRESHOLD] = sizeof(double) * p_header->numColumns;
+
+  for (i=0 ; i < MDPSHM_ARRAYS ; i++)
+  {
+    offset = (offset + MDPSHM_ALIGN - 1) & ~(size_t)(MDPSHM_ALIGN - 1);
+    p_header->offset[i] = offset;
+    offset += bytes[i];
+  }
+
+  p_header->size = offset;
+} // mdpshm_layout
+
+
+/*  Procedure
+ *    mdpshm_array_at
+ *
+ *  Purpose
+ *    Locate an array of a mapped segment
+ */
+static void *
+mdpshm_array_at (void * base, mdpshm_array array)
+{
+  const mdpshm_header * p_header = base;
+
+  return (char*)base + p_header->offset[array];
+} // mdpshm_array_at
+
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+mdpshm_publish (const char * name, const mdp * p_mdp,
+                const alias_table * p_table)
+{
+  unsigned int S = p_mdp->numStates;
+  unsigned int A = p_mdp->numActions;
+  mdpshm_header header;
+  void * base;
+  int fd;
+
+  memset (&header, 0, sizeof(header));
+  header.numStates = S;
+  header.numActions = A;
+  header.start = p_mdp->start;
+  header.numListed = p_mdp->actionOffset[S];
+  header.numColumns = p_table->offset[(size_t)S*A];
+  mdpshm_layout (&header);
+
+  // Creation fails rather than overwrite a segment others may be using
+  fd = shm_open (name, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+  if (fd < 0)
+  {
+    fprintf (stderr,"mdpshm_publish: Unable to create %s (%s)\n", name,
+             strerror (errno));
+    return false;
+  }
+
+  if (0 != ftruncate (fd, header.size))
+  {
+    fprintf (stderr,"mdpshm_publish: Unable to size %s (%s)\n", name,
+             strerror (errno));
+    close (fd);
+    shm_unlink (name);
+    return false;
+  }
+
+  base = mmap (NULL, header.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+
+  if (MAP_FAILED == base)
+  {
+    fprintf (stderr,"mdpshm_publish: Unable to map %s (%s)\n", name,
+             strerror (errno));
+    shm_unlink (name);
+    return false;
+  }
+
+  // Header without its magic, so attachers reject a partial model
+  memcpy (base, &header, sizeof(header));
+
+  memcpy (mdpshm_array_at (base, MDPSHM_NUM_AVAILABLE),
+          p_mdp->numAvailableActions, sizeof(unsigned int) * S);
+  memcpy (mdpshm_array_at (base, MDPSHM_ACTION_MASK),
+          p_mdp->actionMask, sizeof(uint64_t) * S);
+  memcpy (mdpshm_array_at (base, MDPSHM_ACTION_OFFSET),
+          p_mdp->actionOffset, sizeof(unsigned int) * (S + 1));
+  memcpy (mdpshm_array_at (base, MDPSHM_ACTION_LIST),
+          p_mdp->actionList, sizeof(unsigned int) * header.numListed);
+  memcpy (mdpshm_array_at (base, MDPSHM_REWARDS),
+          p_mdp->rewards, sizeof(double) * S);
+  memcpy (mdpshm_array_at (base, MDPSHM_TERMINAL),
+          p_mdp->terminal, sizeof(bool) * S);
+  memcpy (mdpshm_array_at (base, MDPSHM_STATE_INFO),
+          p_mdp->stateInfo, sizeof(mdp_state_info) * S);
+  memcpy (mdpshm_array_at (base, MDPSHM_TERMINAL_BITS),
+          p_mdp->terminalBits, sizeof(uint64_t) * ((S + 63) / 64));
+  memcpy (mdpshm_array_at (base, MDPSHM_ALIAS_OFFSET),
+          p_table->offset, sizeof(unsigned int) * ((size_t)S*A + 1));
+  memcpy (mdpshm_array_at (base, MDPSHM_ALIAS_OUTCOME),
+          p_table->outcome, sizeof(unsigned int) * header.numColumns);
+  memcpy (mdpshm_array_at (base, MDPSHM_ALIAS_ALIAS),
+          p_table->alias, sizeof(unsigned int) * header.numColumns);
+  memcpy (mdpshm_array_at (base, MDPSHM_ALIAS_THRESHOLD),
+          p_table->threshold, sizeof(double) * header.numColumns);
+
+  // Publish: the magic becomes visible only after every array
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+  memcpy (((mdpshm_header*)base)->magic, MDPSHM_MAGIC, sizeof(header.magic));
+
+  munmap (base, header.size);
+
+  return true;
+} // mdpshm_publish
+
+
+////////////////////////////////////////////////////////////////////////////////
+mdpshm *
+mdpshm_attach (const char * name)
+{
+  mdpshm_header expected;
+  const mdpshm_header * p_header;
+  struct stat info;
+  unsigned int s;
+  void * base;
+  int fd;
+
+  fd = shm_open (name, O_RDONLY, 0);
+
+  if (fd < 0)
+  {
+    fprintf (stderr,"mdpshm_attach: Unable to open %s (%s)\n", name,
+             strerror (errno));
+    return NULL;
+  }
+
+  if (0 != fstat (fd, &info) || info.st_size < (off_t)sizeof(mdpshm_header))
+  {
+    fprintf (stderr,"mdpshm_attach: %s is not a published model\n", name);
+    close (fd);
+    return NULL;
+  }
+
+  base = mmap (NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+
+  if (MAP_FAILED == base)
+  {
+    fprintf (stderr,"mdpshm_attach: Unable to map %s (%s)\n", name,
+             strerror (errno));
+    return NULL;
+  }
+
+  p_header = base;
+
+  // Check the magic before anything it guards
+  if (0 != memcmp (p_header->magic, MDPSHM_MAGIC, sizeof(p_header->magic)))
+  {
+    fprintf (stderr,"mdpshm_attach: %s is not a complete published model\n",
+             name);
+    munmap (base, info.st_size);
+    return NULL;
+  }
+  __atomic_thread_fence (__ATOMIC_ACQUIRE);
+
+  // The layout must be the one this build would produce
+  memcpy (&expected, p_header, sizeof(expected));
+  mdpshm_layout (&expected);
+
+  if (0 != memcmp (&expected, p_header, sizeof(expected)) ||
+      (uint64_t)info.st_size < expected.size)
+  {
+    fprintf (stderr,"mdpshm_attach: %s has an incompatible layout\n", name);
+    munmap (base, info.st_size);
+    return NULL;
+  }
+
+  mdpshm * p_shm = malloc (sizeof(mdpshm));
+  unsigned int ** actions = malloc (sizeof(unsigned int*) *
+                                    (p_header->numStates + 1));
+
+  if (NULL == p_shm || NULL == actions)
+  {
+    fprintf (stderr,"mdpshm_attach: Unable to allocate model for %s (%s)\n",
+             name, strerror (errno));
+    free (p_shm);
+    free (actions);
+    munmap (base, info.st_size);
+    return NULL;
+  }
+
+  p_shm->base = base;
+  p_shm->size = info.st_size;
+
+  //----------------------------------------
+  // MDP views (the mapping is read only, so the casts drop nothing usable)
+
+  mdp * p_mdp = &p_shm->model;
+
+  p_mdp->numStates = p_header->numStates;
+  p_mdp->numActions = p_header->numActions;
+  p_mdp->start = p_header->start;
+  p_mdp->transitionProb = NULL;
+  p_mdp->numAvailableActions = mdpshm_array_at (base, MDPSHM_NUM_AVAILABLE);
+  p_mdp->actionMask = mdpshm_array_at (base, MDPSHM_ACTION_MASK);
+  p_mdp->actionOffset = mdpshm_array_at (base, MDPSHM_ACTION_OFFSET);
+  p_mdp->actionList = mdpshm_array_at (base, MDPSHM_ACTION_LIST);
+  p_mdp->rewards = mdpshm_array_at (base, MDPSHM_REWARDS);
+  p_mdp->terminal = mdpshm_array_at (base, MDPSHM_TERMINAL);
+  p_mdp->stateInfo = mdpshm_array_at (base, MDPSHM_STATE_INFO);
+  p_mdp->terminalBits = mdpshm_array_at (base, MDPSHM_TERMINAL_BITS);
+
+  // Per-state action pointers cannot be shared between address spaces
+  p_mdp->actions = actions;
+  for (s=0 ; s < p_mdp->numStates ; s++)
+    actions[s] = p_mdp->actionList + p_mdp->actionOffset[s];
+
+  //----------------------------------------
+  // Alias table views
+
+  p_shm->table.numStates = p_header->numStates;
+  p_shm->table.numActions = p_header->numActions;
+  p_shm->table.offset = mdpshm_array_at (base, MDPSHM_ALIAS_OFFSET);
+  p_shm->table.outcome = mdpshm_array_at (base, MDPSHM_ALIAS_OUTCOME);
+  p_shm->table.alias = mdpshm_array_at (base, MDPSHM_ALIAS_ALIAS);
+  p_shm->table.threshold = mdpshm_array_at (base, MDPSHM_ALIAS_THRESHOLD);
+
+  return p_shm;
+} // mdpshm_attach
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+mdpshm_detach (mdpshm * p_shm)
+{
+  free (p_shm->model.actions);
+  munmap (p_shm->base, p_shm->size);
+  free (p_shm);
+} // mdpshm_detach
+
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+mdpshm_unlink (const char * name)
+{
+  if (0 != shm_unlink (name))
+  {
+    fprintf (stderr,"mdpshm_unlink: Unable to remove %s (%s)\n", name,
+             strerror (errno));
+    return false;
+  }
+
+  return true;
+} // mdpshm_unlink
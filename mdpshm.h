@@ -0,0 +1,170 @@
+/*
+ * File
+ *   mdpshm.h
+ *
+ * Summary
+ *   Immutable environment models in POSIX shared memory. A loader
+ *   publishes an MDP's simulation data (action lists, rewards, terminal
+ *   states and alias tables) once as a flat segment; any number of
+ *   processes then attach it read-only, with no parsing or copying. The
+ *   dense transition probabilities are not published, since simulation
+ *   only needs the alias tables.
+ *
+ *   A segment starts with an mdpshm_header giving the byte offset of each
+ *   array, every one aligned to MDPSHM_ALIGN. Segments are only portable
+ *   between programs built with the same compiler and flags.
+ *
+ */
+#ifndef __MDPSHM_H__
+#define __MDPSHM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "mdp.h"
+#include "alias.h"
+
+/* Identifies published models; the final byte is the layout version */
+#define MDPSHM_MAGIC "MDPSHM\0\001"
+
+/* Prefix of an MDP file name that names a segment (as in "shm:/maze") */
+#define MDPSHM_PREFIX "shm:"
+
+/* Alignment of every array in a segment (a cache line) */
+#define MDPSHM_ALIGN 64
+
+typedef enum {
+  MDPSHM_NUM_AVAILABLE, /* numAvailableActions */
+  MDPSHM_ACTION_MASK,   /* actionMask */
+  MDPSHM_ACTION_OFFSET, /* actionOffset */
+  MDPSHM_ACTION_LIST,   /* actionList */
+  MDPSHM_REWARDS,       /* rewards */
+  MDPSHM_TERMINAL,      /* terminal */
+  MDPSHM_STATE_INFO,    /* stateInfo */
+  MDPSHM_TERMINAL_BITS, /* terminalBits */
+  MDPSHM_ALIAS_OFFSET,  /* offset of the alias table */
+  MDPSHM_ALIAS_OUTCOME, /* outcome of the alias table */
+  MDPSHM_ALIAS_ALIAS,   /* alias of the alias table */
+  MDPSHM_ALIAS_THRESHOLD, /* threshold of the alias table */
+  MDPSHM_ARRAYS         /* Number of arrays */
+} mdpshm_array;
+
+typedef struct {
+  char     magic[8];    /* MDPSHM_MAGIC, written last by the publisher */
+  uint64_t size;        /* Bytes in the segment */
+  uint32_t numStates;   /* Number of states of the MDP */
+  uint32_t numActions;  /* Number of actions of the MDP */
+  uint32_t start;       /* Starting state of the MDP */
+  uint32_t numListed;   /* Entries of actionList */
+  uint32_t numColumns;  /* Columns of the alias table */
+  uint64_t offset[MDPSHM_ARRAYS]; /* Byte offset of each array */
+} mdpshm_header;
+
+typedef struct {
+  mdp           model;  /* The MDP, pointing into the segment (read only;
+                           transitionProb is NULL) */
+  alias_table   table;  /* Its alias table, pointing into the segment */
+  void *        base;   /* Address of the mapping */
+  size_t        size;   /* Length of the mapping */
+} mdpshm;
+
+
+/*  Procedure
+ *    mdpshm_publish
+ *
+ *  Purpose
+ *    Place the simulation data of an MDP in a new shared memory segment
+ *
+ *  Parameters
+ *    name
+ *    p_mdp
+ *    p_table
+ *
+ *  Produces
+ *    success, a bool
+ *
+ *  Preconditions
+ *    name is a POSIX shared memory object name (such as "/maze")
+ *    p_table was produced by alias_build(p_mdp)
+ *
+ *  Postconditions
+ *    Upon success, segment name holds p_mdp and p_table and persists until
+ *    mdpshm_unlink(name), even after the caller exits.
+ *    Upon failure (including when name already exists), a message is
+ *    printed and no segment is left behind.
+ */
+bool
+mdpshm_publish (const char * name, const mdp * p_mdp,
+                const alias_table * p_table);
+
+
+/*  Procedure
+ *    mdpshm_attach
+ *
+ *  Purpose
+ *    Map a published model read-only
+ *
+ *  Parameters
+ *    name
+ *
+ *  Produces
+ *    p_shm, an mdpshm*
+ *
+ *  Preconditions
+ *    [None.]
+ *
+ *  Postconditions
+ *    Upon success, p_shm->model and p_shm->table describe the published
+ *    model and may be used wherever a read-only mdp and alias table are
+ *    expected; only p_shm->model.actions is allocated privately. p_shm
+ *    must be released with mdpshm_detach.
+ *    Upon failure, a message is printed and p_shm is NULL.
+ */
+mdpshm *
+mdpshm_attach (const char * name);
+
+
+/*  Procedure
+ *    mdpshm_detach
+ *
+ *  Purpose
+ *    Unmap a model
+ *
+ *  Parameters
+ *    p_shm
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_shm was produced by mdpshm_attach
+ *
+ *  Postconditions
+ *    All memory for p_shm is released; the segment itself remains
+ */
+void
+mdpshm_detach (mdpshm * p_shm);
+
+
+/*  Procedure
+ *    mdpshm_unlink
+ *
+ *  Purpose
+ *    Remove a published model
+ *
+ *  Parameters
+ *    name
+ *
+ *  Produces
+ *    success, a bool
+ *
+ *  Postconditions
+ *    name no longer names a segment; processes already attached keep
+ *    their mappings. success is false (with a message printed) if name
+ *    could not be removed.
+ */
+bool
+mdpshm_unlink (const char * name);
+
+#endif // __MDPSHM_H__
@@ -0,0 +1,623 @@
+/*
+ * File
+ *   mdpsolve.c
+ *
+ * Summary
+ *   Implementation of the re-entrant planning library (libmdpsolve).
+ *
+ *   Every Bellman sweep is a Jacobi update from the current utilities
+ *   into a second buffer, after which the two buffers swap roles, so the
+ *   states of a sweep may be divided among threads. Worker threads are
+ *   created with the context and wait on a barrier between phases.
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "mdp.h"
+#include "max.h"
+#include "mdpsolve.h"
+
+#define MDPSOLVE_CACHE_LINE 64
+
+/* Per-thread slots are padded to a cache line to avoid false sharing */
+#define MDPSOLVE_SLOT (MDPSOLVE_CACHE_LINE / sizeof(double))
+
+/* Improvement must exceed the current expected utility by this much to
+   change the policy, so round-off cannot make policy iteration cycle */
+#define MDPSOLVE_IMPROVE_TOLERANCE 1e-12
+
+typedef enum {
+  PHASE_VALUE,    /* next <- Bellman update of cur */
+  PHASE_EVALUATE, /* next <- fixed-policy Bellman update of cur */
+  PHASE_IMPROVE,  /* policy <- greedy in cur where strictly better */
+  PHASE_GREEDY,   /* policy <- greedy in cur */
+  PHASE_EXIT      /* Worker threads terminate */
+} mdpsolve_phase;
+
+/* Maximum expected utility backup, specialized by action count */
+typedef double (*mdpsolve_meu_fn) (const mdpsolve_context * p_ctx,
+                                   unsigned int state,
+                                   const double * utilities,
+                                   unsigned int * p_action);
+
+typedef struct {
+  mdpsolve_context * p_ctx; /* Context the worker belongs to */
+  unsigned int index;       /* Thread index (the caller is thread 0) */
+} mdpsolve_worker;
+
+struct mdpsolve_context {
+  unsigned int maxStates;   /* Capacity of the utility workspace */
+  unsigned int maxThreads;  /* Size of the thread pool, including caller */
+  double * next;            /* Aligned utility workspace [maxStates] */
+  double * delta;           /* Aligned per-thread max change slots */
+  double * changed;         /* Aligned per-thread policy change flags */
+  pthread_t * threads;      /* Worker threads [maxThreads-1] */
+  mdpsolve_worker * workers;/* Worker arguments [maxThreads-1] */
+  pthread_barrier_t start;  /* Workers wait here for the next phase */
+  pthread_barrier_t finish; /* Caller waits here for a phase to complete */
+  pthread_mutex_t launch;   /* Held while the pool is being started */
+  bool launched;            /* Whether every worker thread started */
+
+  // State of the solve in progress, read by all threads
+  mdpsolve_phase phase;     /* Phase to run */
+  const mdp * p_mdp;        /* MDP being solved */
+  double gamma;             /* Discount factor */
+  const double * cur;       /* Utilities read by a sweep */
+  double * out;             /* Utilities written by a sweep */
+  unsigned int * policy;    /* Policy being evaluated or improved */
+  unsigned int activeThreads; /* Threads sharing the states of a sweep */
+  mdpsolve_meu_fn meu;      /* Backup selected for p_mdp->numActions */
+  max_kernel kernel;        /* Argmax selected for p_mdp->numActions */
+};
+
+
+/*  Procedure
+ *    expected_utility
+ *
+ *  Purpose
+ *    Calculate sum_{t} P(t|state,action) * utilities[t]
+ */
+static inline double
+expected_utility (const mdp * p_mdp, unsigned int state,
+                  const double * utilities, unsigned int action)
+{
+  double eu = 0.0;
+  unsigned int t;
+
+  for (t=0 ; t < p_mdp->numStates ; t++)
+    eu += p_mdp->transitionProb[t][state][action] * utilities[t];
+
+  return eu;
+} // expected_utility
+
+
+/*  Procedure
+ *    max_expected_utility
+ *
+ *  Purpose
+ *    Calculate the maximum expected utility over the available actions of
+ *    a state and an action achieving it
+ *
+ *  Preconditions
+ *    p_mdp->numAvailableActions[state] > 0
+ */
+static double
+max_expected_utility (const mdpsolve_context * p_ctx, unsigned int state,
+                      const double * utilities, unsigned int * p_action)
+{
+  const mdp * p_mdp = p_ctx->p_mdp;
+  unsigned int a;
+  unsigned int best = 0;
+  double meu = -INFINITY;
+
+  MDP_FOR_EACH_ACTION (a, p_mdp->stateInfo[state].actionMask)
+  {
+    double eu = expected_utility (p_mdp, state, utilities, a);
+
+    if (eu > meu)
+    {
+      meu = eu;
+      best = a;
+    }
+  }
+
+  *p_action = best;
+  return meu;
+} // max_expected_utility
+
+
+/*  Procedure
+ *    dense_max_expected_utility
+ *
+ *  Purpose
+ *    Calculate the maximum expected utility for a compile-time action count
+ *
+ *  Practica
+ *    Always inlined with a constant numActions, so the inner loop unrolls
+ *    and the accumulators stay in registers.
+ *    Expected utilities of all actions accumulate together in one pass
+ *    over the contiguous rows transitionProb[t][state][0..numActions-1],
+ *    rather than one strided pass per available action.
+ */
+static inline __attribute__((always_inline)) double
+dense_max_expected_utility (const unsigned int numActions,
+                            const mdpsolve_context * p_ctx,
+                            unsigned int state, const double * utilities,
+                            unsigned int * p_action)
+{
+  const mdp * p_mdp = p_ctx->p_mdp;
+  double eu[MAX_KERNEL_MAX_LEN] = { 0.0 };
+  unsigned int t, a;
+
+  for (t=0 ; t < p_mdp->numStates ; t++)
+  {
+    const double * prob = p_mdp->transitionProb[t][state];
+
+#pragma GCC unroll 8
+    for (a=0 ; a < numActions ; a++)
+      eu[a] += prob[a] * utilities[t];
+  }
+
+  // Restrict to the available actions
+  if (p_mdp->stateInfo[state].numAvailableActions == numActions)
+    *p_action = p_ctx->kernel.arg_max_value (numActions,
+                                             p_mdp->actions[state], eu);
+  else
+    *p_action = arg_max_value_mask (p_mdp->stateInfo[state].actionMask, eu);
+
+  return eu[*p_action];
+} // dense_max_expected_utility
+
+/* Stamp out the backup specialization for one action count */
+#define MDPSOLVE_SPECIALIZE(N)                                              \
+  static double                                                             \
+  max_expected_utility_##N (const mdpsolve_context * p_ctx,                 \
+                            unsigned int state, const double * utilities,   \
+                            unsigned int * p_action)                        \
+  {                                                                         \
+    return dense_max_expected_utility (N, p_ctx, state, utilities,          \
+                                       p_action);                           \
+  }
+
+MDPSOLVE_SPECIALIZE(2)
+MDPSOLVE_SPECIALIZE(4)
+MDPSOLVE_SPECIALIZE(8)
+
+
+/*  Procedure
+ *    run_range
+ *
+ *  Purpose
+ *    Run the current phase over the share of states belonging to a thread
+ */
+static void
+run_range (mdpsolve_context * p_ctx, unsigned int index)
+{
+  const mdp * p_mdp = p_ctx->p_mdp;
+  unsigned int numStates = p_mdp->numStates;
+  unsigned int chunk, first, last, s, action;
+  double delta = 0.0;
+  double changed = 0.0;
+
+  if (index >= p_ctx->activeThreads)
+    return;
+
+  chunk = (numStates + p_ctx->activeThreads - 1) / p_ctx->activeThreads;
+  first = index * chunk;
+  last = (first + chunk < numStates) ? first + chunk : numStates;
+
+  for (s=first ; s < last ; s++)
+  {
+    // Reward, terminal status and actions share one packed entry
+    const mdp_state_info * p_info = &p_mdp->stateInfo[s];
+    bool active = !p_info->terminal && p_info->numAvailableActions > 0;
+
+    switch (p_ctx->phase)
+    {
+    case PHASE_VALUE:
+      p_ctx->out[s] = p_info->reward;
+      if (active)
+        p_ctx->out[s] += p_ctx->gamma *
+          p_ctx->meu (p_ctx, s, p_ctx->cur, &action);
+      if (fabs (p_ctx->out[s] - p_ctx->cur[s]) > delta)
+        delta = fabs (p_ctx->out[s] - p_ctx->cur[s]);
+      break;
+
+    case PHASE_EVALUATE:
+      p_ctx->out[s] = p_info->reward;
+      if (active)
+        p_ctx->out[s] += p_ctx->gamma *
+          expected_utility (p_mdp, s, p_ctx->cur, p_ctx->policy[s]);
+      if (fabs (p_ctx->out[s] - p_ctx->cur[s]) > delta)
+        delta = fabs (p_ctx->out[s] - p_ctx->cur[s]);
+      break;
+
+    case PHASE_IMPROVE:
+      if (active)
+      {
+        double meu = p_ctx->meu (p_ctx, s, p_ctx->cur, &action);
+
+        if (meu > expected_utility (p_mdp, s, p_ctx->cur, p_ctx->policy[s])
+                  + MDPSOLVE_IMPROVE_TOLERANCE)
+        {
+          p_ctx->policy[s] = action;
+          changed = 1.0;
+        }
+      }
+      break;
+
+    case PHASE_GREEDY:
+      if (p_info->numAvailableActions > 0)
+      {
+        p_ctx->meu (p_ctx, s, p_ctx->cur, &action);
+        p_ctx->policy[s] = action;
+      }
+      break;
+
+    case PHASE_EXIT:
+      break;
+    }
+  }
+
+  p_ctx->delta[index * MDPSOLVE_SLOT] = delta;
+  p_ctx->changed[index * MDPSOLVE_SLOT] = changed;
+} // run_range
+
+
+/*  Procedure
+ *    worker_main
+ *
+ *  Purpose
+ *    Thread body: run each phase on this thread's states until told to exit
+ */
+static void *
+worker_main (void * arg)
+{
+  mdpsolve_worker * p_worker = arg;
+  mdpsolve_context * p_ctx = p_worker->p_ctx;
+
+  // Wait until the whole pool has been started (or failed to start)
+  pthread_mutex_lock (&p_ctx->launch);
+  bool launched = p_ctx->launched;
+  pthread_mutex_unlock (&p_ctx->launch);
+
+  if (!launched)
+    return NULL;
+
+  while (1)
+  {
+    pthread_barrier_wait (&p_ctx->start);
+
+    if (PHASE_EXIT == p_ctx->phase)
+      break;
+
+    run_range (p_ctx, p_worker->index);
+
+    pthread_barrier_wait (&p_ctx->finish);
+  }
+  return NULL;
+} // worker_main
+
+
+/*  Procedure
+ *    run_phase
+ *
+ *  Purpose
+ *    Run a phase over all states, using the thread pool when present
+ *
+ *  Postconditions
+ *    Returns the largest per-thread delta; *p_changed indicates whether any
+ *    thread changed the policy
+ */
+static double
+run_phase (mdpsolve_context * p_ctx, mdpsolve_phase phase, bool * p_changed)
+{
+  unsigned int i;
+  double delta = 0.0;
+
+  p_ctx->phase = phase;
+
+  if (p_ctx->maxThreads > 1)
+  {
+    pthread_barrier_wait (&p_ctx->start);
+    run_range (p_ctx, 0);
+    pthread_barrier_wait (&p_ctx->finish);
+  }
+  else
+    run_range (p_ctx, 0);
+
+  *p_changed = false;
+  for (i=0 ; i < p_ctx->activeThreads ; i++)
+  {
+    if (p_ctx->delta[i * MDPSOLVE_SLOT] > delta)
+      delta = p_ctx->delta[i * MDPSOLVE_SLOT];
+    if (p_ctx->changed[i * MDPSOLVE_SLOT] != 0.0)
+      *p_changed = true;
+  }
+  return delta;
+} // run_phase
+
+
+/*  Procedure
+ *    sweep
+ *
+ *  Purpose
+ *    Run one Bellman sweep and swap the utility buffers
+ */
+static double
+sweep (mdpsolve_context * p_ctx, mdpsolve_phase phase)
+{
+  bool changed;
+  double delta = run_phase (p_ctx, phase, &changed);
+
+  double * written = p_ctx->out;
+  p_ctx->out = (double *) p_ctx->cur;
+  p_ctx->cur = written;
+
+  return delta;
+} // sweep
+
+
+/*  Procedure
+ *    aligned_calloc
+ *
+ *  Purpose
+ *    Allocate zeroed, cache-line aligned memory, or NULL upon failure
+ */
+static void *
+aligned_calloc (size_t bytes)
+{
+  void * ptr;
+
+  // Round up to a whole number of cache lines
+  bytes = (bytes + MDPSOLVE_CACHE_LINE - 1) & ~(size_t)(MDPSOLVE_CACHE_LINE-1);
+
+  if (0 != posix_memalign (&ptr, MDPSOLVE_CACHE_LINE, bytes))
+    return NULL;
+
+  memset (ptr, 0, bytes);
+  return ptr;
+} // aligned_calloc
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+mdpsolve_default_options (mdpsolve_options * p_options)
+{
+  p_options->algorithm = MDPSOLVE_VALUE_ITERATION;
+  p_options->gamma = 0.9;
+  p_options->epsilon = 1e-3;
+  p_options->maxIterations = 0;
+  p_options->threads = 1;
+} // mdpsolve_default_options
+
+
+////////////////////////////////////////////////////////////////////////////////
+mdpsolve_context *
+mdpsolve_create (unsigned int maxStates, unsigned int maxThreads)
+{
+  unsigned int i;
+  mdpsolve_context * p_ctx = calloc (1, sizeof(mdpsolve_context));
+
+  if (NULL == p_ctx)
+    return NULL;
+
+  if (maxThreads < 1)
+    maxThreads = 1;
+
+  p_ctx->maxStates = maxStates;
+  p_ctx->maxThreads = 1; // Until the pool is running
+  p_ctx->next = aligned_calloc (sizeof(double) * maxStates);
+  p_ctx->delta = aligned_calloc (sizeof(double) * MDPSOLVE_SLOT * maxThreads);
+  p_ctx->changed = aligned_calloc (sizeof(double) * MDPSOLVE_SLOT *
+                                   maxThreads);
+
+  if (NULL == p_ctx->next || NULL == p_ctx->delta || NULL == p_ctx->changed)
+  {
+    mdpsolve_free (p_ctx);
+    return NULL;
+  }
+
+  if (maxThreads > 1)
+  {
+    p_ctx->threads = malloc (sizeof(pthread_t) * (maxThreads-1));
+    p_ctx->workers = malloc (sizeof(mdpsolve_worker) * (maxThreads-1));
+
+    if (NULL == p_ctx->threads || NULL == p_ctx->workers ||
+        0 != pthread_barrier_init (&p_ctx->start, NULL, maxThreads))
+    {
+      mdpsolve_free (p_ctx);
+      return NULL;
+    }
+
+    if (0 != pthread_barrier_init (&p_ctx->finish, NULL, maxThreads))
+    {
+      pthread_barrier_destroy (&p_ctx->start);
+      mdpsolve_free (p_ctx);
+      return NULL;
+    }
+
+    // Workers block on the launch mutex until every thread has started
+    pthread_mutex_init (&p_ctx->launch, NULL);
+    pthread_mutex_lock (&p_ctx->launch);
+
+    for (i=0 ; i < maxThreads-1 ; i++)
+    {
+      p_ctx->workers[i].p_ctx = p_ctx;
+      p_ctx->workers[i].index = i+1;
+
+      if (0 != pthread_create (&p_ctx->threads[i], NULL, worker_main,
+                               &p_ctx->workers[i]))
+        break;
+    }
+
+    p_ctx->launched = (i == maxThreads-1);
+    pthread_mutex_unlock (&p_ctx->launch);
+
+    if (!p_ctx->launched)
+    { // The barriers could never be satisfied, so the started workers
+      // return immediately
+      while (i-- > 0)
+        pthread_join (p_ctx->threads[i], NULL);
+
+      pthread_barrier_destroy (&p_ctx->start);
+      pthread_barrier_destroy (&p_ctx->finish);
+      pthread_mutex_destroy (&p_ctx->launch);
+      mdpsolve_free (p_ctx);
+      return NULL;
+    }
+
+    p_ctx->maxThreads = maxThreads;
+  }
+
+  return p_ctx;
+} // mdpsolve_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+mdpsolve_free (mdpsolve_context * p_ctx)
+{
+  unsigned int i;
+
+  if (NULL == p_ctx)
+    return;
+
+  if (p_ctx->maxThreads > 1)
+  { // Release workers from the start barrier with the exit phase
+    p_ctx->phase = PHASE_EXIT;
+    pthread_barrier_wait (&p_ctx->start);
+
+    for (i=0 ; i < p_ctx->maxThreads-1 ; i++)
+      pthread_join (p_ctx->threads[i], NULL);
+
+    pthread_barrier_destroy (&p_ctx->start);
+    pthread_barrier_destroy (&p_ctx->finish);
+    pthread_mutex_destroy (&p_ctx->launch);
+  }
+
+  free (p_ctx->threads);
+  free (p_ctx->workers);
+  free (p_ctx->next);
+  free (p_ctx->delta);
+  free (p_ctx->changed);
+  free (p_ctx);
+} // mdpsolve_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+mdpsolve_status
+mdpsolve_solve (mdpsolve_context * p_ctx, const mdp * p_mdp,
+                const mdpsolve_options * p_options,
+                double * utilities, unsigned int * policy,
+                mdpsolve_stats * p_stats)
+{
+  mdpsolve_status status = MDPSOLVE_SUCCESS;
+  mdpsolve_stats stats = { 0, 0, 0.0 };
+  double gamma = p_options->gamma;
+  double epsilon = p_options->epsilon;
+  bool changed;
+
+  //----------------------------------------
+  // Validate
+
+  if ( !(gamma > 0 && gamma < 1) || !(epsilon > 0) ||
+       (MDPSOLVE_POLICY_ITERATION == p_options->algorithm && NULL == policy) ||
+       (MDPSOLVE_VALUE_ITERATION != p_options->algorithm &&
+        MDPSOLVE_POLICY_ITERATION != p_options->algorithm) )
+    return MDPSOLVE_INVALID_OPTIONS;
+
+  if (p_mdp->numStates > p_ctx->maxStates)
+    return MDPSOLVE_CAPACITY;
+
+  //----------------------------------------
+  // Set up the solve
+
+  p_ctx->p_mdp = p_mdp;
+  p_ctx->gamma = gamma;
+  p_ctx->policy = policy;
+  p_ctx->activeThreads = p_options->threads;
+
+  if (p_ctx->activeThreads < 1)
+    p_ctx->activeThreads = 1;
+  if (p_ctx->activeThreads > p_ctx->maxThreads)
+    p_ctx->activeThreads = p_ctx->maxThreads;
+  if (p_ctx->activeThreads > p_mdp->numStates)
+    p_ctx->activeThreads = p_mdp->numStates;
+
+  // Dispatch the backup for this action count (generic otherwise)
+  p_ctx->kernel = max_select_kernel (p_mdp->numActions);
+  switch (p_mdp->numActions)
+  {
+  case 2:  p_ctx->meu = max_expected_utility_2; break;
+  case 4:  p_ctx->meu = max_expected_utility_4; break;
+  case 8:  p_ctx->meu = max_expected_utility_8; break;
+  default: p_ctx->meu = max_expected_utility;
+  }
+
+  // Utilities start at zero; sweeps alternate between the two buffers
+  memset (utilities, 0, sizeof(double) * p_mdp->numStates);
+  p_ctx->cur = utilities;
+  p_ctx->out = p_ctx->next;
+
+  //----------------------------------------
+  // Solve
+
+  if (MDPSOLVE_VALUE_ITERATION == p_options->algorithm)
+  {
+    double threshold = epsilon * (1 - gamma) / gamma;
+
+    do
+    {
+      stats.delta = sweep (p_ctx, PHASE_VALUE);
+      stats.iterations++;
+
+      if (p_options->maxIterations &&
+          stats.iterations >= p_options->maxIterations &&
+          stats.delta > threshold)
+      {
+        status = MDPSOLVE_MAX_ITERATIONS;
+        break;
+      }
+    } while (stats.delta > threshold);
+
+    if (NULL != policy)
+      run_phase (p_ctx, PHASE_GREEDY, &changed);
+  }
+  else
+  {
+    do
+    {
+      // Evaluate the current policy, warm-started from the last utilities
+      do
+      {
+        stats.delta = sweep (p_ctx, PHASE_EVALUATE);
+        stats.iterations++;
+
+        if (p_options->maxIterations &&
+            stats.iterations >= p_options->maxIterations &&
+            stats.delta > epsilon)
+          status = MDPSOLVE_MAX_ITERATIONS;
+      } while (stats.delta > epsilon && MDPSOLVE_SUCCESS == status);
+
+      if (MDPSOLVE_SUCCESS != status)
+        break;
+
+      // Improve the policy wherever another action is strictly better
+      run_phase (p_ctx, PHASE_IMPROVE, &changed);
+      stats.improvements++;
+    } while (changed);
+  }
+
+  // Leave the final utilities in the caller's array
+  if (p_ctx->cur != utilities)
+    memcpy (utilities, p_ctx->cur, sizeof(double) * p_mdp->numStates);
+
+  if (NULL != p_stats)
+    *p_stats = stats;
+
+  return status;
+} // mdpsolve_solve
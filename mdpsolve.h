@@ -0,0 +1,165 @@
+/*
+ * File
+ *   mdpsolve.h
+ *
+ * Summary
+ *   A re-entrant planning library (libmdpsolve) for solving MDPs by value
+ *   iteration or policy iteration. A solver context owns every workspace
+ *   a solve needs (cache-line aligned) and, optionally, a pool of worker
+ *   threads, so that repeated solves perform no allocation and no I/O.
+ *   Each context may be used by one caller at a time; independent
+ *   contexts may be used concurrently.
+ *
+ */
+#ifndef __MDPSOLVE_H__
+#define __MDPSOLVE_H__
+
+#include "mdp.h"
+
+typedef enum {
+  MDPSOLVE_VALUE_ITERATION,   /* Bellman updates until utilities converge */
+  MDPSOLVE_POLICY_ITERATION   /* Alternate evaluation and improvement */
+} mdpsolve_algorithm;
+
+typedef enum {
+  MDPSOLVE_SUCCESS = 0,       /* Converged within tolerance */
+  MDPSOLVE_MAX_ITERATIONS,    /* Stopped at maxIterations before converging */
+  MDPSOLVE_INVALID_OPTIONS,   /* gamma, epsilon or algorithm out of range */
+  MDPSOLVE_CAPACITY           /* MDP has more states than the context holds */
+} mdpsolve_status;
+
+typedef struct {
+  mdpsolve_algorithm algorithm; /* Planner to run */
+  double gamma;                 /* Discount factor, 0 < gamma < 1 */
+  double epsilon;               /* Tolerance, epsilon > 0 */
+  unsigned int maxIterations;   /* Bound on Bellman sweeps (0 = unbounded) */
+  unsigned int threads;         /* Threads to use (0 or 1 = caller only) */
+} mdpsolve_options;
+
+typedef struct {
+  unsigned int iterations;   /* Bellman sweeps performed (all evaluations) */
+  unsigned int improvements; /* Policy improvement steps (policy iteration) */
+  double delta;              /* Largest utility change in the last sweep */
+} mdpsolve_stats;
+
+typedef struct mdpsolve_context mdpsolve_context;
+
+
+/*  Procedure
+ *    mdpsolve_default_options
+ *
+ *  Purpose
+ *    Fill in default solver options
+ *
+ *  Parameters
+ *    p_options
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_options points to a valid mdpsolve_options struct
+ *
+ *  Postconditions
+ *    *p_options selects value iteration with gamma = 0.9,
+ *    epsilon = 1e-3, no iteration bound, and a single thread
+ */
+void
+mdpsolve_default_options (mdpsolve_options * p_options);
+
+
+/*  Procedure
+ *    mdpsolve_create
+ *
+ *  Purpose
+ *    Allocate a solver context and its workspaces
+ *
+ *  Parameters
+ *    maxStates
+ *    maxThreads
+ *
+ *  Produces
+ *    p_ctx, a mdpsolve_context*
+ *
+ *  Preconditions
+ *    maxStates > 0
+ *
+ *  Postconditions
+ *    p_ctx can solve any MDP with at most maxStates states using at most
+ *      maxThreads threads (the caller's thread counts as one), or p_ctx is
+ *      NULL if memory or threads could not be obtained.
+ *    p_ctx must be released with mdpsolve_free.
+ */
+mdpsolve_context *
+mdpsolve_create (unsigned int maxStates, unsigned int maxThreads);
+
+
+/*  Procedure
+ *    mdpsolve_free
+ *
+ *  Purpose
+ *    Release a solver context, its workspaces and its threads
+ *
+ *  Parameters
+ *    p_ctx
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_ctx was produced by mdpsolve_create, or is NULL
+ *
+ *  Postconditions
+ *    All resources owned by p_ctx are released
+ */
+void
+mdpsolve_free (mdpsolve_context * p_ctx);
+
+
+/*  Procedure
+ *    mdpsolve_solve
+ *
+ *  Purpose
+ *    Solve an MDP with the given options
+ *
+ *  Parameters
+ *    p_ctx
+ *    p_mdp
+ *    p_options
+ *    utilities
+ *    policy
+ *    p_stats
+ *
+ *  Produces
+ *    status, a mdpsolve_status
+ *
+ *  Preconditions
+ *    p_ctx was produced by mdpsolve_create and is not in use elsewhere
+ *    p_mdp points to a valid, complete mdp
+ *    utilities points to a valid array of length p_mdp->numStates
+ *    policy is NULL or points to a valid array of length p_mdp->numStates;
+ *      for policy iteration it must not be NULL and must hold an initial
+ *      policy whose entry for each state with available actions is an
+ *      entry of p_mdp->actions[s]
+ *    p_stats is NULL or points to a valid mdpsolve_stats struct
+ *
+ *  Postconditions
+ *    For value iteration, utilities holds the utility estimates after the
+ *      Bellman updates stopped changing by more than epsilon*(1-gamma)/gamma.
+ *    For policy iteration, utilities holds the evaluated utilities of the
+ *      final policy, each evaluation having run until no update exceeded
+ *      epsilon.
+ *    When policy is not NULL, policy[s] is a greedy (maximum expected
+ *      utility) action of p_mdp->actions[s] for each state s with available
+ *      actions; other entries are unchanged.
+ *    When p_stats is not NULL, it describes the work performed.
+ *    status is MDPSOLVE_SUCCESS on convergence. Nothing is allocated and
+ *      nothing is printed.
+ */
+mdpsolve_status
+mdpsolve_solve (mdpsolve_context * p_ctx, const mdp * p_mdp,
+                const mdpsolve_options * p_options,
+                double * utilities, unsigned int * policy,
+                mdpsolve_stats * p_stats);
+
+#endif // __MDPSOLVE_H__
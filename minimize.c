@@ -0,0 +1,368 @@
+/*
+ * File
+ *   minimize.c
+ *
+ * Summary
+ *   Bisimulation-based model minimization for MDPs: partition refinement,
+ *   quotient construction and lifting of quotient solutions.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+
+#include "mdp.h"
+#include "minimize.h"
+
+/* A state's signature: for each available action a and each block k that a
+   leads into, the total probability P(k|s,a). Entries are stored sorted by
+   (action, block), and the signatures of all states share one pool. */
+typedef struct {
+  unsigned int *start;  /* numStates+1 offsets into the pool */
+  unsigned int *action; /* Action of each entry */
+  unsigned int *block;  /* Destination block of each entry */
+  double *prob;         /* Total probability of each entry */
+  unsigned int size;    /* Number of entries in use */
+  unsigned int capacity;/* Number of entries allocated */
+} signatures;
+
+
+/*  Procedure
+ *    minimize_malloc
+ *
+ *  Purpose
+ *    Allocate memory or exit with a message naming what was requested
+ */
+static void *
+minimize_malloc (size_t bytes, const char * what)
+{
+  void * ptr = malloc (bytes);
+
+  if (NULL == ptr)
+  {
+    fprintf (stderr,"mdp_minimize failed: Could not allocate %s (%s)\n",
+             what, strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+  return ptr;
+} // minimize_malloc
+
+
+/*  Procedure
+ *    signatures_reserve
+ *
+ *  Purpose
+ *    Ensure the signature pool can hold extra more entries
+ */
+static void
+signatures_reserve (signatures * p_sig, unsigned int extra)
+{
+  if (p_sig->size + extra <= p_sig->capacity)
+    return;
+
+  while (p_sig->size + extra > p_sig->capacity)
+    p_sig->capacity *= 2;
+
+  p_sig->action = realloc (p_sig->action,
+                           sizeof(unsigned int) * p_sig->capacity);
+  p_sig->block = realloc (p_sig->block,
+                          sizeof(unsigned int) * p_sig->capacity);
+  p_sig->prob = realloc (p_sig->prob, sizeof(double) * p_sig->capacity);
+
+  if (NULL == p_sig->action || NULL == p_sig->block || NULL == p_sig->prob)
+  {
+    fprintf (stderr,"mdp_minimize failed: Could not grow signatures (%s)\n",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+} // signatures_reserve
+
+
+/*  Procedure
+ *    compute_signatures
+ *
+ *  Purpose
+ *    Compute the block transition signature of every state
+ *
+ *  Preconditions
+ *    block assigns every state to one of numBlocks blocks
+ *    acc has numBlocks entries, all zero; touched has numBlocks entries
+ *
+ *  Postconditions
+ *    p_sig holds the signature of every state; acc is all zero again
+ */
+static void
+compute_signatures (const mdp * p_mdp, const unsigned int * block,
+                    double * acc, unsigned int * touched, signatures * p_sig)
+{
+  unsigned int s, t, a, i, n;
+
+  p_sig->size = 0;
+
+  for (s=0 ; s < p_mdp->numStates ; s++)
+  {
+    p_sig->start[s] = p_sig->size;
+
+    // Actions in increasing order, so entries stay sorted by action
+    MDP_FOR_EACH_ACTION (a, p_mdp->actionMask[s])
+    {
+      // Accumulate P(k|s,a) for every block k reachable from s under a
+      n = 0;
+      for (t=0 ; t < p_mdp->numStates ; t++)
+      {
+        double p = p_mdp->transitionProb[t][s][a];
+
+        if (p == 0.0)
+          continue;
+
+        if (acc[block[t]] == 0.0)
+        { // Insert block into the sorted list of touched blocks
+          for (i = n ; i > 0 && touched[i-1] > block[t] ; i--)
+            touched[i] = touched[i-1];
+          touched[i] = block[t];
+          n++;
+        }
+        acc[block[t]] += p;
+      }
+
+      // Append the entries for this action, resetting the accumulator
+      signatures_reserve (p_sig, n);
+      for (i=0 ; i < n ; i++)
+      {
+        p_sig->action[p_sig->size] = a;
+        p_sig->block[p_sig->size] = touched[i];
+        p_sig->prob[p_sig->size] = acc[touched[i]];
+        p_sig->size++;
+        acc[touched[i]] = 0.0;
+      }
+    }
+  }
+  p_sig->start[p_mdp->numStates] = p_sig->size;
+} // compute_signatures
+
+
+/*  Procedure
+ *    signatures_equal
+ *
+ *  Purpose
+ *    Determine whether two states have matching signatures, where missing
+ *    entries are treated as zero probability
+ */
+static bool
+signatures_equal (const signatures * p_sig, unsigned int s, unsigned int r,
+                  double tolerance)
+{
+  unsigned int i = p_sig->start[s], iEnd = p_sig->start[s+1];
+  unsigned int k = p_sig->start[r], kEnd = p_sig->start[r+1];
+
+  while (i < iEnd || k < kEnd)
+  {
+    if (k == kEnd ||
+        (i < iEnd && (p_sig->action[i] < p_sig->action[k] ||
+                      (p_sig->action[i] == p_sig->action[k] &&
+                       p_sig->block[i] < p_sig->block[k]))))
+    { // Entry only in s
+      if (p_sig->prob[i] > tolerance)
+        return false;
+      i++;
+    }
+    else if (i == iEnd ||
+             p_sig->action[k] != p_sig->action[i] ||
+             p_sig->block[k] != p_sig->block[i])
+    { // Entry only in r
+      if (p_sig->prob[k] > tolerance)
+        return false;
+      k++;
+    }
+    else
+    { // Entry in both
+      if (fabs (p_sig->prob[i] - p_sig->prob[k]) > tolerance)
+        return false;
+      i++;
+      k++;
+    }
+  }
+  return true;
+} // signatures_equal
+
+
+/*  Procedure
+ *    locally_equal
+ *
+ *  Purpose
+ *    Determine whether two states agree on reward, terminal status and
+ *    available actions (the initial partition)
+ */
+static bool
+locally_equal (const mdp * p_mdp, unsigned int s, unsigned int r,
+               double tolerance)
+{
+  return p_mdp->terminal[s] == p_mdp->terminal[r] &&
+    fabs (p_mdp->rewards[s] - p_mdp->rewards[r]) <= tolerance &&
+    p_mdp->actionMask[s] == p_mdp->actionMask[r];
+} // locally_equal
+
+
+////////////////////////////////////////////////////////////////////////////////
+mdp *
+mdp_minimize (const mdp * p_mdp, double tolerance, unsigned int * block)
+{
+  unsigned int S = p_mdp->numStates;
+  unsigned int s, k, t, a;
+  unsigned int numBlocks, newNumBlocks;
+
+  // Bookkeeping for splitting blocks: each new block records its
+  // representative state, and each old block lists the new blocks split
+  // from it (through firstChild and nextSibling)
+  unsigned int * newBlock = minimize_malloc (sizeof(unsigned int)*S,
+                                             "newBlock");
+  unsigned int * rep = minimize_malloc (sizeof(unsigned int)*S, "rep");
+  unsigned int * firstChild = minimize_malloc (sizeof(unsigned int)*S,
+                                               "firstChild");
+  unsigned int * nextSibling = minimize_malloc (sizeof(unsigned int)*S,
+                                                "nextSibling");
+  double * acc = calloc (S, sizeof(double));
+  unsigned int * touched = minimize_malloc (sizeof(unsigned int)*S,
+                                            "touched");
+
+  if (NULL == acc)
+  {
+    fprintf (stderr,"mdp_minimize failed: Could not allocate acc (%s)\n",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  signatures sig;
+  sig.capacity = 4 * S + 1;
+  sig.size = 0;
+  sig.start = minimize_malloc (sizeof(unsigned int)*(S+1), "signatures");
+  sig.action = minimize_malloc (sizeof(unsigned int)*sig.capacity,
+                                "signatures");
+  sig.block = minimize_malloc (sizeof(unsigned int)*sig.capacity,
+                               "signatures");
+  sig.prob = minimize_malloc (sizeof(double)*sig.capacity, "signatures");
+
+  //----------------------------------------
+  // Initial partition: reward, terminal status and available actions
+
+  numBlocks = 0;
+  for (s=0 ; s < S ; s++)
+  {
+    for (k=0 ; k < numBlocks ; k++)
+      if (locally_equal (p_mdp, s, rep[k], tolerance))
+        break;
+
+    if (k == numBlocks)
+      rep[numBlocks++] = s;
+    block[s] = k;
+  }
+
+  //----------------------------------------
+  // Refine: split blocks whose members disagree on block signatures,
+  // until no block splits
+
+  do
+  {
+    compute_signatures (p_mdp, block, acc, touched, &sig);
+
+    for (k=0 ; k < numBlocks ; k++)
+      firstChild[k] = S; // No children yet (S marks end of list)
+
+    newNumBlocks = 0;
+    for (s=0 ; s < S ; s++)
+    {
+      // Search the blocks already split off from the block of s
+      for (k = firstChild[block[s]] ; k != S ; k = nextSibling[k])
+        if (signatures_equal (&sig, s, rep[k], tolerance))
+          break;
+
+      if (k == S)
+      { // Start a new block with s as its representative
+        k = newNumBlocks++;
+        rep[k] = s;
+        nextSibling[k] = firstChild[block[s]];
+        firstChild[block[s]] = k;
+      }
+      newBlock[s] = k;
+    }
+
+    memcpy (block, newBlock, sizeof(unsigned int) * S);
+
+    if (newNumBlocks == numBlocks)
+      break;
+    numBlocks = newNumBlocks;
+  } while (1);
+
+  //----------------------------------------
+  // Quotient MDP over the blocks
+
+  mdp * p_quotient = mdp_malloc (numBlocks, p_mdp->numActions);
+  p_quotient->numStates = numBlocks;
+  p_quotient->numActions = p_mdp->numActions;
+  p_quotient->start = block[p_mdp->start];
+
+  for (k=0 ; k < numBlocks ; k++)
+  {
+    p_quotient->numAvailableActions[k] = p_mdp->numAvailableActions[rep[k]];
+    p_quotient->rewards[k] = p_mdp->rewards[rep[k]];
+    p_quotient->terminal[k] = p_mdp->terminal[rep[k]];
+  }
+
+  mdp_malloc_actions (p_quotient);
+
+  for (k=0 ; k < numBlocks ; k++)
+  {
+    memcpy (p_quotient->actions[k], p_mdp->actions[rep[k]],
+            sizeof(unsigned int) * p_quotient->numAvailableActions[k]);
+    p_quotient->actionMask[k] = p_mdp->actionMask[rep[k]];
+  }
+
+  mdp_pack_state_info (p_quotient);
+
+  // P(B'|B,a) = sum_{t in B'} P(t|rep(B),a)
+  for (t=0 ; t < S ; t++)
+    for (k=0 ; k < numBlocks ; k++)
+      for (a=0 ; a < p_mdp->numActions ; a++)
+        p_quotient->transitionProb[block[t]][k][a] +=
+          p_mdp->transitionProb[t][rep[k]][a];
+
+  // Clean up
+  free (newBlock);
+  free (rep);
+  free (firstChild);
+  free (nextSibling);
+  free (acc);
+  free (touched);
+  free (sig.start);
+  free (sig.action);
+  free (sig.block);
+  free (sig.prob);
+
+  return p_quotient;
+} // mdp_minimize
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+mdp_lift_utilities (unsigned int numStates, const unsigned int * block,
+                    const double * quotientUtilities, double * utilities)
+{
+  unsigned int s;
+
+  for (s=0 ; s < numStates ; s++)
+    utilities[s] = quotientUtilities[block[s]];
+} // mdp_lift_utilities
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+mdp_lift_policy (unsigned int numStates, const unsigned int * block,
+                 const unsigned int * quotientPolicy, unsigned int * policy)
+{
+  unsigned int s;
+
+  for (s=0 ; s < numStates ; s++)
+    policy[s] = quotientPolicy[block[s]];
+} // mdp_lift_policy
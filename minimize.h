@@ -0,0 +1,122 @@
+/*
+ * File
+ *   minimize.h
+ *
+ * Summary
+ *   Model minimization for MDPs. States that agree on reward, terminal
+ *   status and available actions, and whose transition probabilities
+ *   into every block of equivalent states agree for every action, are
+ *   bisimilar and therefore have identical utilities. The procedures
+ *   below compute such a partition by iterative refinement, build the
+ *   (smaller) quotient MDP over the blocks, and lift solutions of the
+ *   quotient back onto the original states.
+ *
+ */
+#ifndef __MINIMIZE_H__
+#define __MINIMIZE_H__
+
+#include "mdp.h"
+
+/* Tolerance used when comparing rewards and block transition probabilities
+   for exact (up to floating-point noise) bisimulation */
+#define MDP_MINIMIZE_TOLERANCE 1e-9
+
+/*  Procedure
+ *    mdp_minimize
+ *
+ *  Purpose
+ *    Compute a bisimulation partition of an MDP and build its quotient
+ *
+ *  Parameters
+ *    p_mdp
+ *    tolerance
+ *    block
+ *
+ *  Produces
+ *    p_quotient, an mdp*
+ *
+ *  Preconditions
+ *    p_mdp points to a valid, complete mdp
+ *    tolerance >= 0
+ *    block points to a valid array of length p_mdp->numStates
+ *
+ *  Postconditions
+ *    block[s] is the index of the quotient state (block) containing s.
+ *    Two states share a block only if their rewards differ by at most
+ *      tolerance, they are both terminal or both non-terminal, they have
+ *      the same available actions, and for every available action their
+ *      total probability of moving into each block differs by at most
+ *      tolerance (an approximate bisimulation when tolerance > 0).
+ *    p_quotient points to a valid, complete mdp with one state per block;
+ *      the rewards, terminal status and actions of each quotient state are
+ *      those of the lowest-numbered state in its block, and
+ *      P(B'|B,a) = sum_{t in B'} P(t|s,a) for that representative s.
+ *    p_quotient->start = block[p_mdp->start]
+ *    p_quotient must be released with mdp_free.
+ *    Any failure causes program exit.
+ */
+mdp *
+mdp_minimize (const mdp * p_mdp, double tolerance, unsigned int * block);
+
+
+/*  Procedure
+ *    mdp_lift_utilities
+ *
+ *  Purpose
+ *    Expand quotient state utilities to the states of the original MDP
+ *
+ *  Parameters
+ *    numStates
+ *    block
+ *    quotientUtilities
+ *    utilities
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    block is the partition produced by mdp_minimize for an MDP having
+ *      numStates states
+ *    quotientUtilities has one entry per quotient state
+ *    utilities points to a valid array of length numStates
+ *
+ *  Postconditions
+ *    utilities[s] = quotientUtilities[block[s]] for 0 <= s < numStates
+ */
+void
+mdp_lift_utilities (unsigned int numStates, const unsigned int * block,
+                    const double * quotientUtilities, double * utilities);
+
+
+/*  Procedure
+ *    mdp_lift_policy
+ *
+ *  Purpose
+ *    Expand a quotient policy to the states of the original MDP
+ *
+ *  Parameters
+ *    numStates
+ *    block
+ *    quotientPolicy
+ *    policy
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    block is the partition produced by mdp_minimize for an MDP having
+ *      numStates states
+ *    quotientPolicy has one entry per quotient state
+ *    policy points to a valid array of length numStates
+ *
+ *  Postconditions
+ *    policy[s] = quotientPolicy[block[s]] for 0 <= s < numStates.
+ *    Because every state in a block has the same available actions,
+ *    policy[s] is an entry in p_mdp->actions[s] whenever the quotient
+ *    policy entry was valid for the quotient state.
+ */
+void
+mdp_lift_policy (unsigned int numStates, const unsigned int * block,
+                 const unsigned int * quotientPolicy, unsigned int * policy);
+
+#endif // __MINIMIZE_H__
@@ -0,0 +1,180 @@
+/*
+ * File
+ *   model.c
+ *
+ * Summary
+ *   Sparse learned models: successor counts of state-action pairs and
+ *   predecessor lists of states.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "rng.h"
+#include "model.h"
+
+
+/*  Procedure
+ *    model_calloc
+ *
+ *  Purpose
+ *    Allocate zeroed memory or exit with a message naming what was
+ *    requested
+ */
+static void *
+model_calloc (size_t count, size_t size, const char * what)
+{
+  void * ptr = calloc (count, size);
+
+  if (NULL == ptr)
+  {
+    fprintf (stderr,"model_create failed: Could not allocate %s (%s)\n",
+             what, strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+  return ptr;
+} // model_calloc
+
+
+/*  Procedure
+ *    model_grow
+ *
+ *  Purpose
+ *    Reallocate an array to hold twice as many elements (or an initial
+ *    number), or exit with a message
+ */
+static void *
+model_grow (void * ptr, unsigned int * p_capacity, size_t size)
+{
+  unsigned int capacity = (0 == *p_capacity) ?
+    MODEL_INITIAL_SUCCESSORS : 2 * *p_capacity;
+
+  ptr = realloc (ptr, capacity * size);
+
+  if (NULL == ptr)
+  {
+    fprintf (stderr,"model_observe failed: Could not grow model (%s)\n",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  *p_capacity = capacity;
+  return ptr;
+} // model_grow
+
+
+/*  Procedure
+ *    model_append
+ *
+ *  Purpose
+ *    Add a key to the end of a list
+ */
+static void
+model_append (model_list * p_list, unsigned int key)
+{
+  if (p_list->size == p_list->capacity)
+    p_list->keys = model_grow (p_list->keys, &p_list->capacity,
+                               sizeof(unsigned int));
+
+  p_list->keys[p_list->size++] = key;
+} // model_append
+
+
+////////////////////////////////////////////////////////////////////////////////
+learned_model *
+model_create (unsigned int numStates, unsigned int numActions)
+{
+  learned_model * p_model = model_calloc (1, sizeof(learned_model),
+                                          "learned_model");
+
+  p_model->numStates = numStates;
+  p_model->numActions = numActions;
+
+  // Zeroed: no pair observed and no state with predecessors
+  p_model->pairs = model_calloc ((size_t)numStates * numActions,
+                                 sizeof(model_pair), "pairs");
+  p_model->reward = model_calloc (numStates, sizeof(double), "rewards");
+  p_model->predecessors = model_calloc (numStates, sizeof(model_list),
+                                        "predecessors");
+
+  return p_model;
+} // model_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+model_free (learned_model * p_model)
+{
+  unsigned int i;
+
+  // Only observed pairs have successors allocated
+  for (i=0 ; i < p_model->observed.size ; i++)
+    free (p_model->pairs[p_model->observed.keys[i]].next);
+
+  for (i=0 ; i < p_model->numStates ; i++)
+    free (p_model->predecessors[i].keys);
+
+  free (p_model->observed.keys);
+  free (p_model->predecessors);
+  free (p_model->reward);
+  free (p_model->pairs);
+  free (p_model);
+} // model_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+model_observe (learned_model * p_model, unsigned int state,
+               unsigned int action, unsigned int next, double reward)
+{
+  unsigned int key = state * p_model->numActions + action;
+  model_pair * p_pair = p_model->pairs + key;
+  unsigned int i;
+
+  p_model->reward[state] = reward;
+
+  if (0 == p_pair->total)
+    model_append (&p_model->observed, key);
+
+  p_pair->total++;
+
+  // Few successors are expected, so they are searched in order
+  for (i=0 ; i < p_pair->numNext ; i++)
+    if (p_pair->next[i].state == next)
+    {
+      p_pair->next[i].count++;
+
+      // Keep the more frequent successors first
+      if (i > 0 && p_pair->next[i].count > p_pair->next[i-1].count)
+      {
+        model_successor swap = p_pair->next[i];
+
+        p_pair->next[i] = p_pair->next[i-1];
+        p_pair->next[i-1] = swap;
+      }
+      return false;
+    }
+
+  if (p_pair->numNext == p_pair->capacity)
+    p_pair->next = model_grow (p_pair->next, &p_pair->capacity,
+                               sizeof(model_successor));
+
+  p_pair->next[p_pair->numNext].state = next;
+  p_pair->next[p_pair->numNext].count = 1;
+  p_pair->numNext++;
+
+  model_append (p_model->predecessors + next, key);
+
+  return true;
+} // model_observe
+
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int
+model_sample_pair (const learned_model * p_model, rng_state * p_rng)
+{
+  return p_model->observed.keys[rng_below (p_rng, p_model->observed.size)];
+} // model_sample_pair
@@ -0,0 +1,153 @@
+/*
+ * File
+ *   model.h
+ *
+ * Summary
+ *   Sparse models of an MDP learned from experience: for each
+ *   state-action pair, the successors observed and how often, and for
+ *   each state, its reward and the pairs observed to lead to it. Only
+ *   what has been observed is stored, so a model takes space in
+ *   proportion to the distinct transitions seen rather than
+ *   numStates^2 x numActions, and the maximum-likelihood estimate of
+ *   P(t|s,a) is count(s,a,t) / total(s,a).
+ *
+ */
+#ifndef __MODEL_H__
+#define __MODEL_H__
+
+#include <stdbool.h>
+
+#include "rng.h"
+
+typedef struct {
+  unsigned int state;  /* Successor t */
+  unsigned int count;  /* Times t followed the pair */
+} model_successor;
+
+typedef struct {
+  unsigned int      total;    /* Times the pair was observed */
+  unsigned int      numNext;  /* Distinct successors observed */
+  unsigned int      capacity; /* Successors allocated */
+  model_successor * next;     /* Successors observed (NULL if none) */
+} model_pair;
+
+typedef struct {
+  unsigned int   size;      /* Keys in the list */
+  unsigned int   capacity;  /* Keys allocated */
+  unsigned int * keys;      /* Pairs s*numActions+a (NULL if none) */
+} model_list;
+
+typedef struct {
+  unsigned int numStates;   /* Number of states */
+  unsigned int numActions;  /* Number of actions */
+  model_pair * pairs;       /* Pair s*numActions+a of each state-action */
+  double *     reward;      /* Reward R(s) observed of each state */
+  model_list   observed;    /* Pairs observed, in the order first seen */
+  model_list * predecessors;/* Pairs observed to lead to each state */
+} learned_model;
+
+/* Successors allocated for a pair when it is first observed */
+#define MODEL_INITIAL_SUCCESSORS 4
+
+
+/*  Procedure
+ *    model_create
+ *
+ *  Purpose
+ *    Allocate a model with nothing observed
+ *
+ *  Parameters
+ *    numStates
+ *    numActions
+ *
+ *  Produces
+ *    p_model, a learned_model*
+ *
+ *  Postconditions
+ *    Every pair of p_model has total 0 and every state no predecessors;
+ *    creation takes O(numStates x numActions) time.
+ *    p_model must be released with model_free.
+ *    Any failure causes program exit.
+ */
+learned_model *
+model_create (unsigned int numStates, unsigned int numActions);
+
+
+/*  Procedure
+ *    model_free
+ *
+ *  Purpose
+ *    Release a model
+ *
+ *  Parameters
+ *    p_model
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_model was produced by model_create
+ *
+ *  Postconditions
+ *    All memory for p_model is freed
+ */
+void
+model_free (learned_model * p_model);
+
+
+/*  Procedure
+ *    model_observe
+ *
+ *  Purpose
+ *    Record a transition experienced
+ *
+ *  Parameters
+ *    p_model
+ *    state
+ *    action
+ *    next
+ *    reward
+ *
+ *  Produces
+ *    isNew, a bool
+ *
+ *  Preconditions
+ *    state, next < p_model->numStates; action < p_model->numActions
+ *    reward is the reward of state
+ *
+ *  Postconditions
+ *    The counts of (state,action) and of next following it are one more.
+ *    p_model->reward[state] = reward.
+ *    isNew is true when next had never followed (state,action); the pair
+ *    is then a predecessor of next.
+ *    Any failure causes program exit.
+ */
+bool
+model_observe (learned_model * p_model, unsigned int state,
+               unsigned int action, unsigned int next, double reward);
+
+
+/*  Procedure
+ *    model_sample_pair
+ *
+ *  Purpose
+ *    Draw an observed state-action pair uniformly
+ *
+ *  Parameters
+ *    p_model
+ *    p_rng
+ *
+ *  Produces
+ *    key, an unsigned int
+ *
+ *  Preconditions
+ *    p_model->observed.size > 0
+ *
+ *  Postconditions
+ *    key = s*numActions+a for a pair (s,a) observed at least once, each
+ *    equally likely
+ */
+unsigned int
+model_sample_pair (const learned_model * p_model, rng_state * p_rng);
+
+#endif // __MODEL_H__
@@ -4,70 +4,86 @@
 #include <errno.h>
 #include <math.h>
 
-#include "utilities.h"
 #include "mdp.h"
+#include "model.h"
+#include "pqueue.h"
 
 /*  Procedure
- *    policy_evaluation
+ *    policy_evaluation_local
  *
  *  Purpose
- *    Iteratively estimate state utilities under a fixed policy
+ *    Re-estimate state utilities under a fixed policy in a learned model
+ *    after the transitions of one state have changed, updating only the
+ *    states the change reaches
  *
  *  Parameters
  *   policy
- *   p_mdp
+ *   p_model
+ *   state
  *   epsilon
  *   gamma
  *   utilities
+ *   p_queue
  *
- *  Produces,
+ *  Produces
  *   [Nothing.]
  *
  *  Preconditions
- *    policy points to a valid array of length p_mdp->numStates
- *    Each policy entry respects 0 <= policy[s] < p_mdp->numActions
- *       and policy[s] is an entry in p_mdp->actions[s]
- *    p_mdp is a pointer to a valid, complete mdp
+ *    policy points to a valid array of length p_model->numStates
+ *    (policy[state],state) has been observed in p_model
  *    epsilon > 0
  *    0 < gamma < 1
- *    utilities points to a valid array of length p_mdp->numStates
+ *    utilities points to a valid array of length p_model->numStates,
+ *       satisfying the simplified Bellman equations of the model to within
+ *       epsilon except at state (e.g., from the previous call)
+ *    p_queue is an empty queue of at least p_model->numStates keys
  *
  *  Postconditions
- *    utilities[s] has been updated according to the simplified Bellman update
- *    so that no update is larger than epsilon
+ *    Starting from utilities (warm), the simplified Bellman update
+ *       U[s] = R(s) + gamma sum_t P(t|s,policy[s]) U[t]
+ *    has been applied to state and then, largest change first, to each
+ *    state whose policy action was observed to lead to a state whose
+ *    utility changed by more than epsilon, until none did. Utilities of
+ *    states not reached are unchanged; those of states whose policy
+ *    action was never observed (e.g., terminal states) are never changed.
+ *    p_queue is empty again.
  */
-void policy_evaluation( const unsigned int* policy, const mdp* p_mdp,
-			double epsilon, double gamma,
-			double* utilities)
+void policy_evaluation_local( const unsigned int* policy,
+                              const learned_model* p_model,
+                              unsigned int state, double epsilon,
+                              double gamma, double* utilities,
+                              pqueue* p_queue)
 {
-  double delta; // max change in U of any state at any iteration
-  int util_length = p_mdp->numStates;
-  size_t util_bytes = util_length * sizeof(double);
-  double* util_update = (double*) calloc(util_length, sizeof(double));
+  unsigned int numActions = p_model->numActions;
 
-  do
+  // The changed state goes first, whatever its residual
+  pqueue_raise(p_queue, state, HUGE_VAL);
+
+  while(p_queue->size > 0)
     {
-      delta = 0;
-      for(unsigned int state = 0; state < p_mdp->numStates; state++)
+      unsigned int s = pqueue_pop(p_queue);
+      const model_pair* p_pair = p_model->pairs + s*numActions + policy[s];
+      const model_list* p_pred = p_model->predecessors + s;
+      double eu = 0; // count-weighted utility of the successors
+      double change;
+
+      for(unsigned int i = 0; i < p_pair->numNext; i++)
+        eu += p_pair->next[i].count * utilities[p_pair->next[i].state];
+
+      eu = p_model->reward[s] + gamma * eu / p_pair->total;
+      change = fabs(eu - utilities[s]);
+      utilities[s] = eu;
+
+      if(change <= epsilon)
+        continue;
+
+      // Only states following the policy into s depend on it
+      for(unsigned int i = 0; i < p_pred->size; i++)
         {
-          if(p_mdp->terminal[state])
-            {
-              util_update[state] = p_mdp->rewards[state];
-            } else
-            {
-              unsigned int action = 0;
-              util_update[state] = p_mdp->rewards[state] +
-                gamma * calc_eu(p_mdp, state, utilities, action);
-            }
-          if(fabs(util_update[state] - utilities[state]) > delta)
-              delta = fabs(util_update[state] - utilities[state]);
-            
-          
-        }
-       memcpy(utilities, util_update, util_bytes);
-       
-    } while(delta > epsilon);
+          unsigned int pred = p_pred->keys[i] / numActions;
 
-  // free util_update
-  free(util_update);
+          if(p_pred->keys[i] % numActions == policy[pred])
+            pqueue_raise(p_queue, pred, change);
+        }
+    }
 }
@@ -2,38 +2,53 @@
 #define POLICY_EVALUATION_H
 
 #include "mdp.h"
+#include "model.h"
+#include "pqueue.h"
 
 /*  Procedure
- *    policy_evaluation
+ *    policy_evaluation_local
  *
  *  Purpose
- *    Iteratively estimate state utilities under a fixed policy
+ *    Re-estimate state utilities under a fixed policy in a learned model
+ *    after the transitions of one state have changed, updating only the
+ *    states the change reaches
  *
  *  Parameters
  *   policy
- *   p_mdp
+ *   p_model
+ *   state
  *   epsilon
  *   gamma
  *   utilities
+ *   p_queue
  *
  *  Produces
  *   [Nothing.]
  *
  *  Preconditions
- *    policy points to a valid array of length p_mdp->numStates
- *    Each policy entry respects 0 <= policy[s] < p_mdp->numActions
- *       and policy[s] is an entry in p_mdp->actions[s]
- *    p_mdp is a pointer to a valid, complete mdp
+ *    policy points to a valid array of length p_model->numStates
+ *    (policy[state],state) has been observed in p_model
  *    epsilon > 0
  *    0 < gamma < 1
- *    utilities points to a valid array of length p_mdp->numStates
+ *    utilities points to a valid array of length p_model->numStates,
+ *       satisfying the simplified Bellman equations of the model to within
+ *       epsilon except at state (e.g., from the previous call)
+ *    p_queue is an empty queue of at least p_model->numStates keys
  *
  *  Postconditions
- *    utilities[s] has been updated according to the simplified Bellman update
- *    so that no update is larger than epsilon
+ *    Starting from utilities (warm), the simplified Bellman update
+ *       U[s] = R(s) + gamma sum_t P(t|s,policy[s]) U[t]
+ *    has been applied to state and then, largest change first, to each
+ *    state whose policy action was observed to lead to a state whose
+ *    utility changed by more than epsilon, until none did. Utilities of
+ *    states not reached are unchanged; those of states whose policy
+ *    action was never observed (e.g., terminal states) are never changed.
+ *    p_queue is empty again.
  */
-void policy_evaluation( const unsigned int* policy, const mdp* p_mdp,
-			double epsilon, double gamma,
-			double* utilities);
+void policy_evaluation_local( const unsigned int* policy,
+                              const learned_model* p_model,
+                              unsigned int state, double epsilon,
+                              double gamma, double* utilities,
+                              pqueue* p_queue);
 
 #endif
@@ -4,14 +4,15 @@
 #include <errno.h>
 #include <math.h>
 
-#include "utilities.h"
-#include "policy_evaluation.h"
 #include "mdp.h"
+#include "mdpsolve.h"
+#include "minimize.h"
+#include "rng.h"
 
 /* Process command-line arguments, verifying usage */
 void
 process_args ( int argc, char * argv[], double * gamma, double * epsilon,
-               mdp ** p_mdp );
+               mdp ** p_mdp, bool * minimize );
 
 /*  Procedure
  *    policy_iteration
@@ -40,39 +41,37 @@ process_args ( int argc, char * argv[], double * gamma, double * epsilon,
  *    policy[s] contains the optimal policy for the given mdp
  *    Each policy entry respects 0 <= policy[s] < p_mdp->numActions
  *       and policy[s] is an entry in p_mdp->actions[s]
+ *    Any failure causes program exit.
  */			
 void policy_iteration ( const mdp* p_mdp, double epsilon, double gamma,
 		      unsigned int *policy)
 {
-  int util_length = p_mdp->numStates;
-  double* utilities = (double*) malloc(sizeof(double)*util_length);
-  //initializing utilitizes
-  bzero(utilities, sizeof(double)*util_length);
-  bool changed;
+  mdpsolve_options options;
+  mdpsolve_context * p_ctx = mdpsolve_create (p_mdp->numStates, 1);
+  double * utilities = malloc (sizeof(double) * p_mdp->numStates);
 
-  do
-    {
-      // update utilities with policy evaluation
-      policy_evaluation(policy, p_mdp, epsilon, gamma, utilities);
-      changed = false;
-      for(unsigned int state = 0; state < p_mdp->numStates; state++)
-        {
-          double meu = 0;
-          unsigned int action;
-          calc_meu(p_mdp, state, utilities, &meu, &action);
-
-          action = 0;
-          double eu =  calc_eu(p_mdp, state, utilities, action);
-
-          if(meu > eu)
-            {
-              policy[state] = meu;
-              changed = true;
-            }
-        }
-    } while(changed);
-
-  free(utilities);
+  if (NULL == p_ctx || NULL == utilities)
+  {
+    fprintf (stderr, "policy_iteration: Unable to create solver (%s)\n",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  mdpsolve_default_options (&options);
+  options.algorithm = MDPSOLVE_POLICY_ITERATION;
+  options.gamma = gamma;
+  options.epsilon = epsilon;
+
+  if (MDPSOLVE_SUCCESS != mdpsolve_solve (p_ctx, p_mdp, &options, utilities,
+                                          policy, NULL))
+  {
+    fprintf (stderr, "policy_iteration: Solver failed (check gamma=%f and "
+             "epsilon=%f)\n", gamma, epsilon);
+    exit (EXIT_FAILURE);
+  }
+
+  free (utilities);
+  mdpsolve_free (p_ctx);
 } // policy_iteration
 
 
@@ -100,15 +99,17 @@ void policy_iteration ( const mdp* p_mdp, double epsilon, double gamma,
  */
 void randomize_policy( const mdp * p_mdp, unsigned int * policy)
 {
-  srandom(42);
+  rng_state rng;
   unsigned int state;
   unsigned int action;
 
+  rng_seed (&rng, 42);
+
   for ( state=0 ; state < p_mdp->numStates ; state++)
   {
     if (p_mdp->numAvailableActions[state] > 0)
     {
-      action = (unsigned int)(random() % (p_mdp->numAvailableActions[state]));
+      action = rng_below (&rng, p_mdp->numAvailableActions[state]);
       policy[state] = p_mdp->actions[state][action];
     }
   }
@@ -116,18 +117,21 @@ void randomize_policy( const mdp * p_mdp, unsigned int * policy)
 }
 
 /*
- * Main: policy_iteration gamma epsilon mdpfile
+ * Main: policy_iteration [-m] gamma epsilon mdpfile
  *
- * Runs policy_iteration algorithm using gamma and policy_evaluation with max
- * changes of epsilon on MDP in mdpfile.
+ * Runs policy_iteration algorithm (through mdpsolve) using gamma, evaluating
+ * each policy until no utility changes by more than epsilon, on MDP in
+ * mdpfile. With -m, the bisimulation quotient of the MDP is solved instead
+ * and its policy is lifted back to the original states.
  */
 int main(int argc, char* argv[])
 {
   // Read and process configurations
   double gamma, epsilon;
   mdp *p_mdp;
+  bool minimize;
 
-  process_args(argc, argv, &gamma, &epsilon, &p_mdp);
+  process_args(argc, argv, &gamma, &epsilon, &p_mdp, &minimize);
   
   // Allocate policy array
   unsigned int * policy;
@@ -143,11 +147,51 @@ int main(int argc, char* argv[])
     exit (EXIT_FAILURE);
   }
 
-  // Initialize random policy
-  randomize_policy (p_mdp, policy);
+  if (minimize)
+  {
+    // Partition states into bisimilar blocks and solve the quotient
+    unsigned int * block = malloc ( sizeof(unsigned int) * p_mdp->numStates );
+
+    if (NULL == block)
+    {
+      fprintf (stderr,
+               "%s: Unable to allocate block (%s)",
+               argv[0],
+               strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+    mdp * p_quotient = mdp_minimize (p_mdp, MDP_MINIMIZE_TOLERANCE, block);
+    unsigned int * quotientPolicy = malloc ( sizeof(unsigned int) * 
+                                             p_quotient->numStates );
+
+    if (NULL == quotientPolicy)
+    {
+      fprintf (stderr,
+               "%s: Unable to allocate quotient policy (%s)",
+               argv[0],
+               strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+    // Initialize random policy and run policy iteration on the quotient!
+    randomize_policy (p_quotient, quotientPolicy);
+    policy_iteration ( p_quotient, epsilon, gamma, quotientPolicy);
 
-  // Run policy iteration!
-  policy_iteration ( p_mdp, epsilon, gamma, policy);
+    mdp_lift_policy (p_mdp->numStates, block, quotientPolicy, policy);
+
+    free (quotientPolicy);
+    free (block);
+    mdp_free (p_quotient);
+  }
+  else
+  {
+    // Initialize random policy
+    randomize_policy (p_mdp, policy);
+
+    // Run policy iteration!
+    policy_iteration ( p_mdp, epsilon, gamma, policy);
+  }
 
   // Print policies
   unsigned int state;
@@ -165,38 +209,43 @@ int main(int argc, char* argv[])
 
 void
 process_args ( int argc, char * argv[], double * gamma, double * epsilon,
-               mdp ** p_mdp )
+               mdp ** p_mdp, bool * minimize )
 {
-  if (argc != 4)
+  // Optional leading -m flag requests model minimization
+  *minimize = (argc == 5 && 0 == strcmp (argv[1], "-m"));
+
+  int arg = *minimize ? 2 : 1; // Index of first positional argument
+
+  if (argc != arg + 3)
   {
-    fprintf (stderr,"Usage: %s gamma epsilon mdpfile\n",argv[0]);
+    fprintf (stderr,"Usage: %s [-m] gamma epsilon mdpfile\n",argv[0]);
     exit (EXIT_FAILURE);
   }
 
   char * endptr; // String End Location for number parsing
 
   // Read gamma, the discount factor, as a double
-  *gamma = strtod (argv[1], &endptr);
+  *gamma = strtod (argv[arg], &endptr);
 
-  if ( (endptr - argv[1])/sizeof(char) < strlen(argv[1]) )
+  if ( (endptr - argv[arg])/sizeof(char) < strlen(argv[arg]) )
   {
     fprintf (stderr, "%s: Illegal non-numeric value in argument gamma=%s\n",
-             argv[0], argv[1]);
+             argv[0], argv[arg]);
     exit (EXIT_FAILURE);
   }
 
   // Read epsilon, maximum allowable state utility error, as a double
-  *epsilon = strtod (argv[2], &endptr); 
+  *epsilon = strtod (argv[arg+1], &endptr); 
 
-  if ( (endptr - argv[2])/sizeof(char) < strlen(argv[2]) )
+  if ( (endptr - argv[arg+1])/sizeof(char) < strlen(argv[arg+1]) )
   {
     fprintf (stderr, "%s: Illegal non-numeric value in argument epsilon=%s\n",
-             argv[0], argv[2]);
+             argv[0], argv[arg+1]);
     exit (EXIT_FAILURE);
   }
 
   // Read the MDP file (exits with message if error)
-  *p_mdp = mdp_read (argv[3]);
+  *p_mdp = mdp_read (argv[arg+2]);
 
   if (NULL == p_mdp)
   { // mdp_read prints a message
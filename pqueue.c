@@ -0,0 +1,181 @@
+/*
+ * File
+ *   pqueue.c
+ *
+ * Summary
+ *   Indexed binary max-heaps.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+
+#include "pqueue.h"
+
+
+/*  Procedure
+ *    pqueue_malloc
+ *
+ *  Purpose
+ *    Allocate memory or exit with a message naming what was requested
+ */
+static void *
+pqueue_malloc (size_t bytes, const char * what)
+{
+  void * ptr = malloc (bytes);
+
+  if (NULL == ptr)
+  {
+    fprintf (stderr,"pqueue_create failed: Could not allocate %s (%s)\n",
+             what, strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+  return ptr;
+} // pqueue_malloc
+
+
+/*  Procedure
+ *    pqueue_place
+ *
+ *  Purpose
+ *    Put a key at a position of the heap
+ */
+static inline void
+pqueue_place (pqueue * p_queue, unsigned int i, unsigned int key)
+{
+  p_queue->heap[i] = key;
+  p_queue->where[key] = i;
+} // pqueue_place
+
+
+/*  Procedure
+ *    pqueue_up
+ *
+ *  Purpose
+ *    Move a key toward the root until its parent's priority is no less
+ */
+static void
+pqueue_up (pqueue * p_queue, unsigned int i)
+{
+  unsigned int key = p_queue->heap[i];
+  double priority = p_queue->priority[key];
+
+  while (i > 0)
+  {
+    unsigned int parent = (i - 1) / 2;
+
+    if (p_queue->priority[p_queue->heap[parent]] >= priority)
+      break;
+
+    pqueue_place (p_queue, i, p_queue->heap[parent]);
+    i = parent;
+  }
+
+  pqueue_place (p_queue, i, key);
+} // pqueue_up
+
+
+/*  Procedure
+ *    pqueue_down
+ *
+ *  Purpose
+ *    Move a key toward the leaves until no child's priority is greater
+ */
+static void
+pqueue_down (pqueue * p_queue, unsigned int i)
+{
+  unsigned int key = p_queue->heap[i];
+  double priority = p_queue->priority[key];
+
+  for (;;)
+  {
+    unsigned int child = 2*i + 1;
+
+    if (child >= p_queue->size)
+      break;
+
+    // Follow the larger child
+    if (child + 1 < p_queue->size &&
+        p_queue->priority[p_queue->heap[child + 1]] >
+        p_queue->priority[p_queue->heap[child]])
+      child++;
+
+    if (p_queue->priority[p_queue->heap[child]] <= priority)
+      break;
+
+    pqueue_place (p_queue, i, p_queue->heap[child]);
+    i = child;
+  }
+
+  pqueue_place (p_queue, i, key);
+} // pqueue_down
+
+
+////////////////////////////////////////////////////////////////////////////////
+pqueue *
+pqueue_create (unsigned int numKeys)
+{
+  pqueue * p_queue = pqueue_malloc (sizeof(pqueue), "pqueue");
+  unsigned int key;
+
+  p_queue->numKeys = numKeys;
+  p_queue->size = 0;
+  p_queue->heap = pqueue_malloc (sizeof(unsigned int) * numKeys, "heap");
+  p_queue->priority = pqueue_malloc (sizeof(double) * numKeys, "priorities");
+  p_queue->where = pqueue_malloc (sizeof(unsigned int) * numKeys, "index");
+
+  for (key=0 ; key < numKeys ; key++)
+    p_queue->where[key] = PQUEUE_NONE;
+
+  return p_queue;
+} // pqueue_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+pqueue_free (pqueue * p_queue)
+{
+  free (p_queue->heap);
+  free (p_queue->priority);
+  free (p_queue->where);
+  free (p_queue);
+} // pqueue_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+pqueue_raise (pqueue * p_queue, unsigned int key, double priority)
+{
+  unsigned int i = p_queue->where[key];
+
+  if (PQUEUE_NONE == i)
+  {
+    i = p_queue->size++;
+    p_queue->heap[i] = key;
+  }
+  else if (p_queue->priority[key] >= priority)
+    return;
+
+  p_queue->priority[key] = priority;
+  pqueue_up (p_queue, i);
+} // pqueue_raise
+
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int
+pqueue_pop (pqueue * p_queue)
+{
+  unsigned int key = p_queue->heap[0];
+
+  p_queue->where[key] = PQUEUE_NONE;
+
+  // The last key fills the root and sinks to its place
+  if (--p_queue->size > 0)
+  {
+    p_queue->heap[0] = p_queue->heap[p_queue->size];
+    pqueue_down (p_queue, 0);
+  }
+
+  return key;
+} // pqueue_pop
@@ -0,0 +1,122 @@
+/*
+ * File
+ *   pqueue.h
+ *
+ * Summary
+ *   Indexed max-priority queues of integer keys (binary heaps with the
+ *   position of each key), as prioritized sweeping needs: a key is queued
+ *   at most once, and queueing it again only ever raises its priority.
+ *
+ */
+#ifndef __PQUEUE_H__
+#define __PQUEUE_H__
+
+#include <limits.h>
+
+/* Position of a key not in the queue */
+#define PQUEUE_NONE UINT_MAX
+
+typedef struct {
+  unsigned int   numKeys;   /* Keys that may be queued: 0 <= key < numKeys */
+  unsigned int   size;      /* Keys queued */
+  unsigned int * heap;      /* Keys queued, as a max-heap on priority */
+  double *       priority;  /* Priority of each key (valid when queued) */
+  unsigned int * where;     /* Position of each key in heap, or
+                               PQUEUE_NONE */
+} pqueue;
+
+
+/*  Procedure
+ *    pqueue_create
+ *
+ *  Purpose
+ *    Allocate an empty priority queue
+ *
+ *  Parameters
+ *    numKeys
+ *
+ *  Produces
+ *    p_queue, a pqueue*
+ *
+ *  Preconditions
+ *    numKeys < PQUEUE_NONE
+ *
+ *  Postconditions
+ *    p_queue is empty.
+ *    p_queue must be released with pqueue_free.
+ *    Any failure causes program exit.
+ */
+pqueue *
+pqueue_create (unsigned int numKeys);
+
+
+/*  Procedure
+ *    pqueue_free
+ *
+ *  Purpose
+ *    Release a priority queue
+ *
+ *  Parameters
+ *    p_queue
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_queue was produced by pqueue_create
+ *
+ *  Postconditions
+ *    All memory for p_queue is freed
+ */
+void
+pqueue_free (pqueue * p_queue);
+
+
+/*  Procedure
+ *    pqueue_raise
+ *
+ *  Purpose
+ *    Queue a key with at least a given priority
+ *
+ *  Parameters
+ *    p_queue
+ *    key
+ *    priority
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    key < p_queue->numKeys
+ *
+ *  Postconditions
+ *    key is queued, with the larger of priority and its priority before
+ *    (if it was queued). Takes O(log size) time.
+ */
+void
+pqueue_raise (pqueue * p_queue, unsigned int key, double priority);
+
+
+/*  Procedure
+ *    pqueue_pop
+ *
+ *  Purpose
+ *    Remove the key of highest priority
+ *
+ *  Parameters
+ *    p_queue
+ *
+ *  Produces
+ *    key, an unsigned int
+ *
+ *  Preconditions
+ *    p_queue->size > 0
+ *
+ *  Postconditions
+ *    key had the highest priority queued, and is no longer queued.
+ *    Takes O(log size) time.
+ */
+unsigned int
+pqueue_pop (pqueue * p_queue);
+
+#endif // __PQUEUE_H__
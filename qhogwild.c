@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "mdp.h"
+#include "environment.h"
+#include "qtable.h"
+#include "qlearn_agent.h"
+#include "hogwild.h"
+
+/* Comparisons with the reference policy over a run */
+#define QHOGWILD_CHECKS 1000
+
+/* Read a non-negative integer argument or exit with a message */
+static unsigned int
+read_count (char * argv[], int index, const char * name);
+
+/*
+ Usage: qhogwild gamma reward attempts mdpfile trials workers shards
+                 [policyfile [tolerance]]
+
+ Runs Q-Learning-Agent as qlearn does, with an exploration function
+ that uses reward as an optimistic estimate when the number of
+ state-action experiences is less than attempts, but as workers
+ concurrent agents (one thread each) learning a single shared Q table
+ over trials trials in total. With shards 0, the agents update the
+ table without locks (Hogwild!); otherwise its rows are striped over
+ shards locks. The Q-values, utilities, and policy learned are printed
+ as by qlearn; one worker without shards gives the same output as
+ qlearn with one replica.
+
+ With a policyfile (e.g., from policy_iteration), the learned greedy
+ policy is compared with it QHOGWILD_CHECKS times during the run, and
+ the wall time and trials taken until at most tolerance (default 0)
+ states differ are reported on standard error, along with the total
+ time. Serial and parallel runs are compared by running this with
+ different numbers of workers.
+
+ Trials are capped at MDP_MAX_EPISODE_STEPS steps and each worker's
+ trials at MDP_RUN_SECONDS seconds when those are set; a warning reports
+ any trials cut short.
+*/
+int
+main (int argc, char* argv[])
+{
+  if (argc < 8 || argc > 10)
+  {
+    fprintf (stderr, "Usage: %s gamma reward attempts mdpfile trials "
+             "workers shards [policyfile [tolerance]]\n", argv[0]);
+    exit (EXIT_FAILURE);
+  }
+
+  char * endptr; // String End Location for number parsing
+  qlearn_agent_config config;
+  const char * names[] = { "gamma", "reward", "attempts" };
+  double * params[] = { &config.gamma, &config.reward, &config.attempts };
+  int i;
+
+  // Read gamma, the optimistic reward and attempts as doubles
+  for (i=0 ; i < 3 ; i++)
+  {
+    *params[i] = strtod (argv[i+1], &endptr);
+
+    if ( (endptr - argv[i+1])/sizeof(char) < strlen (argv[i+1]) )
+    {
+      fprintf (stderr, "%s: Illegal non-numeric value in argument %s=%s\n",
+               argv[0], names[i], argv[i+1]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+  // Learn only from experience, one step at a time
+  config.replays = 0;
+  config.replayCapacity = QLEARN_REPLAY_CAPACITY;
+  config.lambda = 0;
+  config.backups = 0;
+  config.threshold = 0;
+
+  hogwild_options opts = hogwild_default_options ();
+
+  opts.trials = read_count (argv, 5, "trials");
+  opts.workers = read_count (argv, 6, "workers");
+  opts.shards = read_count (argv, 7, "shards");
+
+  if (0 == opts.workers)
+  {
+    fprintf (stderr, "%s: Illegal value in argument workers=%s\n",
+             argv[0], argv[6]);
+    exit (EXIT_FAILURE);
+  }
+
+  // Initialize environment
+  environment * p_env = env_create (argv[4]);
+  mdp * p_mdp = env_get_structure (p_env);
+  unsigned int * policy = NULL;
+
+  // Read the reference policy
+  if (argc >= 9)
+  {
+    FILE * stream = fopen (argv[8], "r");
+
+    policy = malloc ( sizeof(unsigned int) * p_mdp->numStates );
+
+    if (NULL == stream || NULL == policy)
+    {
+      fprintf (stderr, "%s: Unable to read policy %s (%s)\n", argv[0],
+               argv[8], strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+    mdp_read_policy (stream, p_mdp, policy);
+    fclose (stream);
+
+    opts.policy = policy;
+    if (10 == argc)
+      opts.tolerance = read_count (argv, 9, "tolerance");
+    opts.checkEvery = (opts.trials + QHOGWILD_CHECKS - 1) / QHOGWILD_CHECKS;
+    if (0 == opts.checkEvery)
+      opts.checkEvery = 1;
+  }
+
+  // Run the Q-Learning-Agents!
+  hogwild_result * p_result = hogwild_run (p_env, &config, &opts);
+
+  if (p_result->truncated > 0 || p_result->timeouts > 0)
+    fprintf (stderr, "%s: Warning: %llu trials truncated and %llu workers "
+             "stopped by limits\n", argv[0], p_result->truncated,
+             p_result->timeouts);
+
+  if (NULL != policy)
+  {
+    if (p_result->convergedSeconds >= 0)
+      fprintf (stderr, "%s: Greedy policy agreed after %u trials, %.3f s "
+               "(%u states differ at the end)\n", argv[0],
+               p_result->convergedTrials, p_result->convergedSeconds,
+               p_result->mismatches);
+    else
+      fprintf (stderr, "%s: Greedy policy did not agree (%u states differ)\n",
+               argv[0], p_result->mismatches);
+  }
+
+  fprintf (stderr, "%s: %u workers, %u shards: %u trials in %.3f s\n",
+           argv[0], opts.workers, opts.shards, opts.trials,
+           p_result->seconds);
+
+  qlearn_print (p_mdp, p_result->p_table->value);
+
+  free (policy);
+  mdp_free (p_mdp);
+  hogwild_result_free (p_result);
+  env_free (p_env);
+
+  return 0;
+} // main
+
+
+/* Read a non-negative integer argument or exit with a message */
+static unsigned int
+read_count (char * argv[], int index, const char * name)
+{
+  char * endptr; // String End Location for number parsing
+  unsigned int value = (unsigned int)strtol(argv[index], &endptr, 10);
+
+  if ( (endptr - argv[index])/sizeof(char) < strlen (argv[index]) )
+  {
+    fprintf (stderr, "%s: Illegal non-numeric value in argument %s=%s\n",
+             argv[0], name, argv[index]);
+    exit (EXIT_FAILURE);
+  }
+
+  return value;
+} // read_count
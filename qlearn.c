@@ -7,264 +7,94 @@
 #include "mdp.h"
 #include "environment.h"
 #include "max.h"
-
-// Persistent (external) variables
-
-mdp *         p_mdp; /* MDP to operate on/in */
-double        gamma; /* Discount factor to use */
-double **     state_action_freq; /* Counts of state-action pair frequencies */
-double **     state_action_value; /* Counts of state-action pair values */
-unsigned int  prevState;  /* Previous state encountered */
-unsigned int  prevAction; /* Previous action taken */
-double        prevReward; /* Previous reward received */
-bool          prevValid = false;  /* A state variable indicating whether the
-                                     previous state-action pair is valid
-                                     (i.e., not restarting after terminal
-                                     state */
-double        bestReward; /* "Optimistic estimate of best possible reward" */
-double        minTries;   /* Minimum number of times agent must
-			     attempt each state-action pair */
+#include "runner.h"
+#include "qlearn_agent.h"
 
 /* Process command-line arguments, verifying usage */
 void
 process_args (int argc, char * argv[], 
               double * gamma, double * reward,  double * attempts, 
-              unsigned int * trials);
-
-/* 
- * Procedure:
- *   qlearn_initialize
- *
- * Purpose:
- *   Initialize persistent variables for Q-learning using partial MDP information
- *
- * Parameters:
- *   p_mdp_in
- *   gamma_in
- *   reward
- *   attempts
- *
- * Preconditions:
- *   p_mdp_in points to a valid MDP struct that has the numStates field set
- *   0 < gamma_in < 1
- *
- * Postconditions:
- *   The following assignments are made to the persistent variables:
- *     p_mdp = p_mdp_in
- *     gamma = gamma_in
- *     bestReward = reward
- *     minTries = attempts
- *     prevValid = false
- *   The following persistent variables point to valid, allocated arrays
- *     state_action_freq[numStates][numActions], all entries initialized to zero
- *     state_action_value[numStates][numActions], all entries initialized to zero
- *
- * Progenitor
- *   Jerod Weinman
- */
-void qlearn_initialize( mdp * p_mdp_in, double gamma_in, double reward, 
-			double attempts)
-{
-  // Assign MDP object
-  p_mdp = p_mdp_in;
-
-  // Set other constants
-  gamma = gamma_in;
-  bestReward = reward;
-  minTries = attempts;
-
-  // Allocate N[s,a]
-  state_action_freq = mdp_malloc_state_action( p_mdp->numStates, 
-					       p_mdp->numActions );
-
-  // Allocate Q[s,a]
-  state_action_value = mdp_malloc_state_action( p_mdp->numStates, 
-						p_mdp->numActions );
-
-  // Indicate no previous state
-  prevValid = false;
-}
-
-
-/*
- * Procedure
- *   updateWeight
- *
- * Purpose
- *   Give an adjustment factor based on state frequency
- *
- * Parameters
- *   freq
- *
- * Produces
- *   alpha, a double
- *
- * Postconditions
- *   alpha = O(1/freq)
- *
- *   The equation for alpha is taken from Russel & Norvig, Artificial
- *   Intelligence (2010), p. 837.
- *
- *  Author
- *    Jerod Weinman
- */
-
-double updateWeight(double freq)
-{
-  return 60.0/(59.0 + freq);
-}
-
-/*
- * Procedure
- *   exploration_function
- *
- * Purpose
- *   Return an optimistic reward/utility value that encourages new actions
- *
- * Parameters
- *   u
- *   n
- *
- * Produces
- *   f, a double
- *
- * Postconditions
- *   If (n < minTries), f = bestReward.
- *   Otherwise, f = u  .
- *
- *   The equation for f is taken from Russel & Norvig, Artificial
- *   Intelligence (2010), p. 842.
- *
- *  Progenitor
- *    Jerod Weinman
- */
-
-double exploration_function( double u, double n )
-{
-  if (n < minTries)
-    return bestReward;
-  else
-    return u;
-}
-  
-/* rl_agent_action - 
- *   receive reward for a prior action; indicate action to take in given state
- * 
- * Produces
- *   action, an unsigned int
- *
- * Preconditions
- *   qlearn_initialize has run successfully
- *   0 <= state < p_mdp->numStates
- *
- * Postconditions
- *   action is a member of p_mdp->actions[state]
- */
-unsigned int rl_agent_action(unsigned int state, double reward)
-{
-  double maxQ = 0;
-  // if terminal state
-  if (p_mdp->terminal[state]) {
-    for (unsigned int action = 0; action < p_mdp->numActions; action++) {
-      state_action_value[state][action] = reward;
-    }
-    maxQ = reward; 
-  } else {
-    maxQ = max_value(p_mdp->numAvailableActions[state], p_mdp->actions[state], state_action_value[state]);
-  }
-
-  if (prevValid) {
-    state_action_freq[prevState][prevAction]++;
-    state_action_value[prevState][prevAction] += updateWeight(state_action_freq[prevState][prevAction]) *
-      (prevReward + gamma*maxQ - state_action_value[prevState][prevAction]);
-  }
-
-  if (p_mdp->terminal[state]) {
-    prevValid = false;
-  } else {
-    prevState = state;
-    for (unsigned int action = 0; action < p_mdp->numAvailableActions[state]; action++) {
-      if (exploration_function(state_action_value[state][action], state_action_freq[state][action]) >
-          exploration_function(state_action_value[state][prevAction], state_action_freq[state][prevAction])) {
-        prevAction = p_mdp->actions[state][action];
-      }
-    }
-    prevReward = reward;
-    prevValid = true;
-  }
-
-  return prevAction;
-}
-
+              unsigned int * trials, unsigned int * replicas,
+              unsigned int * replays, double * lambda);
 
 /*
  Usage: qlearn gamma reward attempts mdpfile trials
+               [replicas [replays [lambda]]]
  
  Runs Q-Learning-Agent in an environment for the given number of
  trials with an exploration function that uses reward as an optimistic
  estimate when the number of state-action experiences is less than
  attempts.
 
+ With replicas, that many independent agents (each with its own random
+ number stream) run concurrently, one per processor, and the Q-values
+ printed are their means. One replica is the same as a single agent.
+
+ With replays, each agent also keeps its last QLEARN_REPLAY_CAPACITY
+ transitions and, after every step, learns again from that many of them,
+ sampled by prioritized experience replay (see replay.h), so rare
+ transitions propagate in fewer simulated steps.
+
+ With lambda (default 0), each agent learns by Watkins's Q(lambda),
+ passing every error back to the state-action pairs of the episode whose
+ eligibility traces have not decayed below TRACE_DEFAULT_CUTOFF, since
+ the last exploratory action.
+
+ Trials are capped at MDP_MAX_EPISODE_STEPS steps and each replica's run
+ at MDP_RUN_SECONDS seconds when those are set; a warning reports any
+ trials cut short.
+
+ When MDP_CONVERGE_WINDOW is set, a replica stops once that many
+ consecutive trials have changed no Q-value by more than
+ MDP_CONVERGE_TOLERANCE (default CONVERGE_DEFAULT_TOLERANCE) and no
+ state's greedy action; the trial at which each replica converged is
+ reported.
+
+ When MDP_TRAJLOG is set, each replica's experience is recorded to that
+ trajectory log (suffixed with the replica number when there are
+ several), which trajplay can replay.
+
  Author: Jerod Weinman
 */
 int
 main (int argc, char* argv[])
 {
-  // Loop variables for later
-  unsigned int state,action;
-
   // Read and process configurations
-  double gamma, reward, attempts;
-  unsigned int trials;
+  double gamma, reward, attempts, lambda;
+  unsigned int trials, replicas, replays;
 
-  process_args (argc,argv, &gamma, &reward, &attempts, &trials);
+  process_args (argc,argv, &gamma, &reward, &attempts, &trials, &replicas,
+                &replays, &lambda);
 
   // Initialize environment
-  environment_setup (argv[4]);
+  environment * p_env = env_create (argv[4]);
 
-  // Initialize agent
-  qlearn_initialize (environment_get_mdp(), gamma, reward, attempts );
+  // Run Q-Learning-Agent replicas (without planning; see dyna)!
+  qlearn_agent_config config = { gamma, reward, attempts, replays,
+                                 QLEARN_REPLAY_CAPACITY, lambda, 0, 0 };
+  rl_agent_factory factory = qlearn_agent_factory (&config, p_env);
+  runner_options opts = runner_default_options ();
 
-  // Run Q-Learning-Agent!
-  environment_run (trials);
+  opts.replicas = replicas;
+  opts.trials = trials;
 
-  // Print values
-  printf("Q[s,a]\n");
-  for ( state=0 ; state < p_mdp->numStates ; state++)
-  {
-    for ( action=0 ; action < p_mdp->numActions ; action++)
-      printf ("%1.3f\t",state_action_value[state][action]);
-    printf ("\n");
-  }
+  runner_result * p_result = runner_run (p_env, &factory, &opts);
+
+  if (p_result->truncated > 0 || p_result->timeouts > 0)
+    fprintf (stderr, "%s: Warning: %llu trials truncated and %llu replicas "
+             "stopped by limits\n", argv[0], p_result->truncated,
+             p_result->timeouts);
 
-  // Print utilities
-  printf("\nU[s]\n");
-  for ( state = 0; state < p_mdp->numStates ; state++) // For each state
-    
-    // if there are any actions in the state
-    if (p_mdp->numAvailableActions[state] > 0)
-      // print the maximum Q-value (which is the utility)
-      printf ("%f\n", max_value (p_mdp->numAvailableActions[state],
-                                 p_mdp->actions[state],
-                                 state_action_value[state] ) );
-  // Otherwise, if the state is terminal
-    else if (p_mdp->terminal[state])
-      // Print the value of the first action (which is the reward)
-      printf ("%f\n", state_action_value[state][0] );
-    else
-      // Otherwise, just print X
-      printf ("X\n");
-
-
-  // Print policy
-  printf ("\npolicy[s]\n");
-  for ( state = 0; state < p_mdp->numStates ; state++)
-    if (p_mdp->numAvailableActions[state] > 0)
-      printf ("%u\n", arg_max_value ( p_mdp->numAvailableActions[state],
-                                      p_mdp->actions[state],
-                                      state_action_value[state] ) );
-    else
-      printf ("X\n");
+  runner_print_convergence (stderr, argv[0], p_result);
+
+  // Mean Q-values, laid out as the agent's flat table: row s is Q[s,.]
+  mdp * p_mdp = env_get_structure (p_env);
+
+  qlearn_print (p_mdp, p_result->mean);
+
+  mdp_free (p_mdp);
+  runner_result_free (p_result);
+  env_free (p_env);
 
   return 0;
 } // main
@@ -274,12 +104,14 @@ main (int argc, char* argv[])
 void
 process_args (int argc, char * argv[], 
               double * gamma, double * reward,  double * attempts, 
-              unsigned int * trials)
+              unsigned int * trials, unsigned int * replicas,
+              unsigned int * replays, double * lambda)
 {
-  if (argc != 6)
+  if (argc < 6 || argc > 9)
   {
     fprintf (stderr,
-             "Usage: %s gamma reward attempts mdpfile trials\n", argv[0]);
+             "Usage: %s gamma reward attempts mdpfile trials "
+             "[replicas [replays [lambda]]]\n", argv[0]);
     exit (EXIT_FAILURE);
   }
 
@@ -324,4 +156,51 @@ process_args (int argc, char * argv[],
              argv[0], argv[5]);
     exit (EXIT_FAILURE);
   }
+
+  // Read replicas, number of independent agents, as an unsigned integer
+  *replicas = 1;
+
+  if (argc >= 7)
+  {
+    *replicas = (unsigned int)strtol(argv[6], &endptr, 10);
+
+    if ( (endptr - argv[6])/sizeof(char) < strlen (argv[6]) || 
+         0 == *replicas )
+    {
+      fprintf (stderr, "%s: Illegal value in argument replicas=%s\n",
+               argv[0], argv[6]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+  // Read replays, transitions replayed per step, as an unsigned integer
+  *replays = 0;
+
+  if (argc >= 8)
+  {
+    *replays = (unsigned int)strtol(argv[7], &endptr, 10);
+
+    if ( (endptr - argv[7])/sizeof(char) < strlen (argv[7]) )
+    {
+      fprintf (stderr, "%s: Illegal value in argument replays=%s\n",
+               argv[0], argv[7]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+  // Read lambda, the trace decay, as a double
+  *lambda = 0;
+
+  if (9 == argc)
+  {
+    *lambda = strtod (argv[8], &endptr);
+
+    if ( (endptr - argv[8])/sizeof(char) < strlen (argv[8]) ||
+         *lambda < 0 || *lambda > 1 )
+    {
+      fprintf (stderr, "%s: Illegal value in argument lambda=%s\n",
+               argv[0], argv[8]);
+      exit (EXIT_FAILURE);
+    }
+  }
 } // process_args
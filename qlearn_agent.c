@@ -0,0 +1,947 @@
+/*
+ * File
+ *   qlearn_agent.c
+ *
+ * Summary
+ *   Q-learning agent instances.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mdp.h"
+#include "max.h"
+#include "qtable.h"
+#include "replay.h"
+#include "trace.h"
+#include "model.h"
+#include "pqueue.h"
+#include "rng.h"
+#include "environment.h"
+#include "runner.h"
+#include "qlearn_agent.h"
+
+
+/*
+ * Procedure
+ *   updateWeight
+ *
+ * Purpose
+ *   Give an adjustment factor based on state frequency
+ *
+ * Parameters
+ *   freq
+ *
+ * Produces
+ *   alpha, a double
+ *
+ * Postconditions
+ *   alpha = O(1/freq)
+ *
+ *   The equation for alpha is taken from Russel & Norvig, Artificial
+ *   Intelligence (2010), p. 837.
+ *
+ *  Author
+ *    Jerod Weinman
+ */
+static double updateWeight(double freq)
+{
+  return 60.0/(59.0 + freq);
+}
+
+/*  Procedure
+ *    qlearn_agent_init
+ *
+ *  Purpose
+ *    Create an agent learning in a given table
+ */
+static qlearn_agent *
+qlearn_agent_init (mdp * p_mdp, double gamma, double reward,
+                   double attempts, qtable * p_table, bool shared)
+{
+  qlearn_agent * p_agent = malloc (sizeof(qlearn_agent));
+
+  if (NULL == p_agent)
+  {
+    fprintf (stderr, "qlearn_agent_create: Unable to allocate agent (%s)",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  // Assign MDP object
+  p_agent->p_mdp = p_mdp;
+
+  // Set other constants
+  p_agent->gamma = gamma;
+  p_agent->bestReward = reward;
+  p_agent->minTries = attempts;
+
+  // Assign Q[s,a] and N[s,a]
+  p_agent->p_table = p_table;
+  p_agent->shared = shared;
+  p_agent->rowValue = NULL;
+  p_agent->rowCount = NULL;
+  p_agent->bestValue = NULL;
+  p_agent->bestAction = NULL;
+  p_agent->p_replay = NULL;
+  p_agent->replays = 0;
+  p_agent->p_trace = NULL;
+  p_agent->lambda = 0;
+  p_agent->p_model = NULL;
+  p_agent->p_queue = NULL;
+  p_agent->backups = 0;
+  p_agent->threshold = 0;
+
+  // Rows of a shared table are read through private snapshots
+  if (shared)
+  {
+    p_agent->rowValue = malloc (sizeof(double) * p_mdp->numActions);
+    p_agent->rowCount = malloc (sizeof(uint32_t) * p_mdp->numActions);
+
+    if (NULL == p_agent->rowValue || NULL == p_agent->rowCount)
+    {
+      fprintf (stderr, "qlearn_agent_create: Unable to allocate row (%s)",
+               strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+  }
+  else
+  {
+    // Concurrent writers would leave a cache stale unnoticed
+    unsigned int state;
+
+    p_agent->bestValue = malloc (sizeof(double) * p_mdp->numStates);
+    p_agent->bestAction = malloc (sizeof(unsigned int) * p_mdp->numStates);
+
+    if (NULL == p_agent->bestValue || NULL == p_agent->bestAction)
+    {
+      fprintf (stderr, "qlearn_agent_create: Unable to allocate cache (%s)",
+               strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+    for (state=0 ; state < p_mdp->numStates ; state++)
+      p_agent->bestAction[state] = QLEARN_STALE;
+  }
+
+  // Dispatch max/argmax for the width of a row
+  p_agent->kernel = max_select_kernel( p_mdp->numActions );
+
+  // Indicate no previous state
+  p_agent->prevValid = false;
+
+  return p_agent;
+} // qlearn_agent_init
+
+
+////////////////////////////////////////////////////////////////////////////////
+qlearn_agent *
+qlearn_agent_create (mdp * p_mdp, double gamma, double reward,
+                     double attempts)
+{
+  return qlearn_agent_init (p_mdp, gamma, reward, attempts,
+                            qtable_create (p_mdp->numStates,
+                                           p_mdp->numActions),
+                            false);
+} // qlearn_agent_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+qlearn_agent *
+qlearn_agent_create_shared (mdp * p_mdp, double gamma, double reward,
+                            double attempts, qtable * p_table)
+{
+  return qlearn_agent_init (p_mdp, gamma, reward, attempts, p_table, true);
+} // qlearn_agent_create_shared
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+qlearn_agent_free (qlearn_agent * p_agent)
+{
+  if (!p_agent->shared)
+    qtable_free (p_agent->p_table);
+  free (p_agent->rowValue);
+  free (p_agent->rowCount);
+  free (p_agent->bestValue);
+  free (p_agent->bestAction);
+  if (NULL != p_agent->p_replay)
+    replay_free (p_agent->p_replay);
+  if (NULL != p_agent->p_trace)
+    trace_free (p_agent->p_trace);
+  if (NULL != p_agent->p_model)
+    model_free (p_agent->p_model);
+  if (NULL != p_agent->p_queue)
+    pqueue_free (p_agent->p_queue);
+  mdp_free (p_agent->p_mdp);
+  free (p_agent);
+} // qlearn_agent_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+qlearn_agent_enable_replay (qlearn_agent * p_agent, unsigned int replays,
+                            unsigned int capacity, uint64_t seed)
+{
+  if (NULL != p_agent->p_replay)
+    replay_free (p_agent->p_replay);
+
+  p_agent->p_replay = replay_create (capacity, REPLAY_DEFAULT_ALPHA,
+                                     REPLAY_DEFAULT_BETA, seed);
+  p_agent->replays = replays;
+} // qlearn_agent_enable_replay
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+qlearn_agent_enable_traces (qlearn_agent * p_agent, double lambda)
+{
+  const mdp * p_mdp = p_agent->p_mdp;
+
+  if (NULL == p_agent->p_trace)
+    p_agent->p_trace = trace_create (p_mdp->numStates * p_mdp->numActions,
+                                     TRACE_DEFAULT_CUTOFF);
+  p_agent->lambda = lambda;
+} // qlearn_agent_enable_traces
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+qlearn_agent_enable_planning (qlearn_agent * p_agent, unsigned int backups,
+                              double threshold, uint64_t seed)
+{
+  const mdp * p_mdp = p_agent->p_mdp;
+
+  if (NULL == p_agent->p_model)
+    p_agent->p_model = model_create (p_mdp->numStates, p_mdp->numActions);
+
+  if (NULL != p_agent->p_queue)
+  {
+    pqueue_free (p_agent->p_queue);
+    p_agent->p_queue = NULL;
+  }
+
+  if (threshold > 0)
+    p_agent->p_queue = pqueue_create (p_mdp->numStates * p_mdp->numActions);
+
+  p_agent->backups = backups;
+  p_agent->threshold = threshold;
+  rng_stream (&p_agent->planRng, seed, 1);
+} // qlearn_agent_enable_planning
+
+
+/*  Procedure
+ *    qlearn_agent_row
+ *
+ *  Purpose
+ *    Locate the values and counts of a state: the table's own row, or a
+ *    snapshot of it when the table is shared
+ */
+static void
+qlearn_agent_row (qlearn_agent * p_agent, unsigned int state,
+                  const double ** p_Q, const uint32_t ** p_N)
+{
+  if (p_agent->shared)
+  {
+    qtable_snapshot (p_agent->p_table, state, p_agent->rowValue,
+                     p_agent->rowCount);
+    *p_Q = p_agent->rowValue;
+    *p_N = p_agent->rowCount;
+  }
+  else
+  {
+    *p_Q = QTABLE_VALUES(p_agent->p_table, state);
+    *p_N = QTABLE_COUNTS(p_agent->p_table, state);
+  }
+} // qlearn_agent_row
+
+
+/*  Procedure
+ *    qlearn_agent_explore
+ *
+ *  Purpose
+ *    Evaluate the exploration function f(Q[s,a],N[s,a]) (R&N p. 842)
+ */
+static inline double
+qlearn_agent_explore (const qlearn_agent * p_agent, double value,
+                      uint32_t count)
+{
+  return (count < p_agent->minTries) ? p_agent->bestReward : value;
+} // qlearn_agent_explore
+
+
+/*  Procedure
+ *    qlearn_agent_best
+ *
+ *  Purpose
+ *    Find max_a Q[state,a] and the available action maximizing the
+ *    exploration function, searching the row only when it is not cached
+ *
+ *  Practica
+ *    The state must not be terminal. The action found is the one
+ *    arg_max_explore_mask would give.
+ */
+static unsigned int
+qlearn_agent_best (qlearn_agent * p_agent, unsigned int state,
+                   double * p_max)
+{
+  uint64_t mask = p_agent->p_mdp->stateInfo[state].actionMask;
+  const double * Q;
+  const uint32_t * N;
+  unsigned int action;
+
+  if (NULL != p_agent->bestAction &&
+      QLEARN_STALE != p_agent->bestAction[state]) {
+    *p_max = p_agent->bestValue[state];
+    return p_agent->bestAction[state];
+  }
+
+  qlearn_agent_row (p_agent, state, &Q, &N);
+  action = p_agent->kernel.arg_max_explore_mask (mask, Q, N,
+                                                 p_agent->minTries,
+                                                 p_agent->bestReward, p_max);
+
+  if (NULL != p_agent->bestAction) {
+    p_agent->bestValue[state] = *p_max;
+    p_agent->bestAction[state] = action;
+  }
+
+  return action;
+} // qlearn_agent_best
+
+
+/*  Procedure
+ *    qlearn_agent_changed
+ *
+ *  Purpose
+ *    Bring the cache of a state up to date after one entry of its row, a
+ *    pair previously with value oldQ and count oldN, was written
+ *
+ *  Practica
+ *    A value or exploration estimate that rose, or one that fell but was
+ *    not the largest, adjusts the cache in O(1) time; otherwise the row
+ *    is searched again when next needed. Ties keep the first action, as
+ *    arg_max_explore_mask does.
+ */
+static void
+qlearn_agent_changed (qlearn_agent * p_agent, unsigned int state,
+                      unsigned int action, double oldQ, uint32_t oldN)
+{
+  const qtable * p_table = p_agent->p_table;
+  unsigned int best = p_agent->bestAction[state];
+  size_t sa = (size_t)state * p_table->numActions + action;
+  double q = p_table->value[sa];
+  double f, fBest;
+
+  if (QLEARN_STALE == best)
+    return;
+
+  // Largest value
+  if (q >= p_agent->bestValue[state])
+    p_agent->bestValue[state] = q;
+  else if (oldQ == p_agent->bestValue[state]) {
+    p_agent->bestAction[state] = QLEARN_STALE;  // The largest may have fallen
+    return;
+  }
+
+  // Exploration choice
+  f = qlearn_agent_explore (p_agent, q, p_table->count[sa]);
+
+  if (action == best) {
+    if (f < qlearn_agent_explore (p_agent, oldQ, oldN))
+      p_agent->bestAction[state] = QLEARN_STALE;
+    return;
+  }
+
+  sa = (size_t)state * p_table->numActions + best;
+  fBest = qlearn_agent_explore (p_agent, p_table->value[sa],
+                                p_table->count[sa]);
+
+  if (f > fBest || (f == fBest && action < best))
+    p_agent->bestAction[state] = action;
+} // qlearn_agent_changed
+
+
+/*  Procedure
+ *    qlearn_agent_terminal
+ *
+ *  Purpose
+ *    Set every Q-value of a terminal state to its reward
+ */
+static void
+qlearn_agent_terminal (qlearn_agent * p_agent, unsigned int state,
+                       double reward)
+{
+  qtable * p_table = p_agent->p_table;
+  double * Q = QTABLE_VALUES(p_table, state);
+  unsigned int action;
+
+  if (!p_agent->shared) {
+    for (action = 0; action < p_table->numActions; action++)
+      Q[action] = reward;
+    p_agent->bestAction[state] = QLEARN_STALE;
+    return;
+  }
+
+  QTABLE_LOCK(p_table, state);
+  for (action = 0; action < p_table->numActions; action++)
+    __atomic_store (Q + action, &reward, __ATOMIC_RELAXED);
+  QTABLE_UNLOCK(p_table, state);
+} // qlearn_agent_terminal
+
+
+/*  Procedure
+ *    qlearn_agent_update
+ *
+ *  Purpose
+ *    Move a Q-value toward a sampled target, counting the visit when it
+ *    was experienced rather than replayed
+ *
+ *  Practica
+ *    The step is weight times the usual learning rate for the pair's
+ *    visits; the error (target less the old value) is returned.
+ *    In a shared table the entries are read and written atomically, but
+ *    the update as a whole is atomic only under a shard lock: lock-free,
+ *    an agent updating the same pair in between has its update (or its
+ *    count) overwritten, which Hogwild! tolerates as noise.
+ */
+static double
+qlearn_agent_update (qlearn_agent * p_agent, unsigned int state,
+                     unsigned int action, double target, double weight,
+                     bool visit)
+{
+  qtable * p_table = p_agent->p_table;
+  size_t sa = (size_t)state * p_table->numActions + action;
+  uint32_t * n = p_table->count + sa;
+  double * q = p_table->value + sa;
+  double error;
+
+  if (!p_agent->shared) {
+    uint32_t oldN = *n;
+    double oldQ = *q;
+
+    if (visit && *n < UINT32_MAX)
+      (*n)++;
+    error = target - *q;
+    *q += updateWeight(*n) * weight * error;
+    qlearn_agent_changed (p_agent, state, action, oldQ, oldN);
+    return error;
+  }
+
+  uint32_t count;
+  double value;
+
+  QTABLE_LOCK(p_table, state);
+
+  count = __atomic_load_n (n, __ATOMIC_RELAXED);
+  if (visit && count < UINT32_MAX)
+    __atomic_store_n (n, ++count, __ATOMIC_RELAXED);
+
+  __atomic_load (q, &value, __ATOMIC_RELAXED);
+  error = target - value;
+  value += updateWeight(count) * weight * error;
+  __atomic_store (q, &value, __ATOMIC_RELAXED);
+
+  QTABLE_UNLOCK(p_table, state);
+
+  return error;
+} // qlearn_agent_update
+
+
+/*  Procedure
+ *    qlearn_agent_credit
+ *
+ *  Purpose
+ *    Move a Q-value by a share of another pair's error, at its own
+ *    learning rate
+ *
+ *  Practica
+ *    Shared tables are read and written as by qlearn_agent_update.
+ */
+static void
+qlearn_agent_credit (qlearn_agent * p_agent, unsigned int sa, double share)
+{
+  qtable * p_table = p_agent->p_table;
+  double * q = p_table->value + sa;
+  unsigned int state = sa / p_table->numActions;
+  double value;
+
+  if (!p_agent->shared) {
+    value = *q;
+    *q += updateWeight(p_table->count[sa]) * share;
+    qlearn_agent_changed (p_agent, state, sa % p_table->numActions, value,
+                          p_table->count[sa]);
+    return;
+  }
+
+  QTABLE_LOCK(p_table, state);
+
+  __atomic_load (q, &value, __ATOMIC_RELAXED);
+  value += updateWeight(__atomic_load_n (p_table->count + sa,
+                                         __ATOMIC_RELAXED)) * share;
+  __atomic_store (q, &value, __ATOMIC_RELAXED);
+
+  QTABLE_UNLOCK(p_table, state);
+} // qlearn_agent_credit
+
+
+/*  Procedure
+ *    qlearn_agent_trace
+ *
+ *  Purpose
+ *    Pass the error of the latest update back along the traces, then
+ *    make the pair updated eligible
+ *
+ *  Practica
+ *    The other actions of the state lose their traces (Singh & Sutton,
+ *    1996): otherwise, while an agent circles through a state, they share
+ *    in errors that are not theirs, and may all be dragged to the value of
+ *    circling forever.
+ */
+static void
+qlearn_agent_trace (qlearn_agent * p_agent, double error)
+{
+  const mdp * p_mdp = p_agent->p_mdp;
+  trace_list * p_trace = p_agent->p_trace;
+  unsigned int state = p_agent->prevState;
+  unsigned int sa = state * p_mdp->numActions + p_agent->prevAction;
+  unsigned int i;
+
+  // The pair itself already had the whole error
+  for (i=0 ; i < p_trace->size ; i++)
+    if (p_trace->keys[i] != sa)
+      qlearn_agent_credit (p_agent, p_trace->keys[i],
+                           error * p_trace->values[i]);
+
+  for (i=0 ; i < p_mdp->numAvailableActions[state] ; i++)
+    trace_drop (p_trace, state * p_mdp->numActions + p_mdp->actions[state][i]);
+
+  trace_visit (p_trace, sa);
+} // qlearn_agent_trace
+
+
+/*  Procedure
+ *    qlearn_agent_utility
+ *
+ *  Purpose
+ *    Estimate the utility of a state, max_a Q[state,a]
+ */
+static double
+qlearn_agent_utility (qlearn_agent * p_agent, unsigned int state)
+{
+  const mdp * p_mdp = p_agent->p_mdp;
+  const double * Q;
+  const uint32_t * N;
+  double maxQ;
+
+  if (NULL != p_agent->bestAction && !MDP_IS_TERMINAL(p_mdp, state)) {
+    qlearn_agent_best (p_agent, state, &maxQ);
+    return maxQ;
+  }
+
+  qlearn_agent_row (p_agent, state, &Q, &N);
+
+  // Every Q-value of a terminal state is its reward
+  if (MDP_IS_TERMINAL(p_mdp, state))
+    return Q[0];
+
+  return p_agent->kernel.max_value_mask (p_mdp->stateInfo[state].actionMask,
+                                         Q);
+} // qlearn_agent_utility
+
+
+/*  Procedure
+ *    qlearn_agent_replay
+ *
+ *  Purpose
+ *    Store the transition just experienced and learn again from sampled
+ *    earlier ones
+ */
+static void
+qlearn_agent_replay (qlearn_agent * p_agent, unsigned int state)
+{
+  replay_buffer * p_replay = p_agent->p_replay;
+  replay_transition transition = { p_agent->prevState, p_agent->prevAction,
+                                   state, p_agent->prevReward };
+  unsigned int k;
+
+  replay_add (p_replay, &transition);
+
+  for (k=0 ; k < p_agent->replays ; k++)
+  {
+    double weight;
+    unsigned int slot = replay_sample (p_replay, &weight);
+    const replay_transition * p_t = p_replay->transitions + slot;
+    double target = p_t->reward +
+      p_agent->gamma * qlearn_agent_utility (p_agent, p_t->next);
+
+    replay_update (p_replay, slot,
+                   qlearn_agent_update (p_agent, p_t->state, p_t->action,
+                                        target, weight, false));
+  }
+} // qlearn_agent_replay
+
+
+/*  Procedure
+ *    qlearn_agent_expected
+ *
+ *  Purpose
+ *    Compute the target of a planning backup of a pair: its state's
+ *    reward plus the discounted utility expected of its successors under
+ *    the learned model
+ */
+static double
+qlearn_agent_expected (qlearn_agent * p_agent, unsigned int sa)
+{
+  const learned_model * p_model = p_agent->p_model;
+  const model_pair * p_pair = p_model->pairs + sa;
+  double utility = 0;
+  unsigned int i;
+
+  for (i=0 ; i < p_pair->numNext ; i++)
+    utility += p_pair->next[i].count *
+      qlearn_agent_utility (p_agent, p_pair->next[i].state);
+
+  return p_model->reward[sa / p_model->numActions] +
+    p_agent->gamma * utility / p_pair->total;
+} // qlearn_agent_expected
+
+
+/*  Procedure
+ *    qlearn_agent_value
+ *
+ *  Purpose
+ *    Read a Q-value, atomically when the table is shared
+ */
+static double
+qlearn_agent_value (const qlearn_agent * p_agent, unsigned int sa)
+{
+  double value;
+
+  if (!p_agent->shared)
+    return p_agent->p_table->value[sa];
+
+  __atomic_load (p_agent->p_table->value + sa, &value, __ATOMIC_RELAXED);
+  return value;
+} // qlearn_agent_value
+
+
+/*  Procedure
+ *    qlearn_agent_backup
+ *
+ *  Purpose
+ *    Set a Q-value to a planning target
+ */
+static void
+qlearn_agent_backup (qlearn_agent * p_agent, unsigned int sa, double target)
+{
+  qtable * p_table = p_agent->p_table;
+  unsigned int state = sa / p_table->numActions;
+
+  if (!p_agent->shared) {
+    double oldQ = p_table->value[sa];
+
+    p_table->value[sa] = target;
+    qlearn_agent_changed (p_agent, state, sa % p_table->numActions, oldQ,
+                          p_table->count[sa]);
+    return;
+  }
+
+  QTABLE_LOCK(p_table, state);
+  __atomic_store (p_table->value + sa, &target, __ATOMIC_RELAXED);
+  QTABLE_UNLOCK(p_table, state);
+} // qlearn_agent_backup
+
+
+/*  Procedure
+ *    qlearn_agent_queue
+ *
+ *  Purpose
+ *    Queue a pair for prioritized sweeping if a backup would change it by
+ *    more than the threshold
+ */
+static void
+qlearn_agent_queue (qlearn_agent * p_agent, unsigned int sa)
+{
+  double change = qlearn_agent_expected (p_agent, sa) -
+    qlearn_agent_value (p_agent, sa);
+
+  if (change < 0)
+    change = -change;
+
+  if (change > p_agent->threshold)
+    pqueue_raise (p_agent->p_queue, sa, change);
+} // qlearn_agent_queue
+
+
+/*  Procedure
+ *    qlearn_agent_plan
+ *
+ *  Purpose
+ *    Record the transition just experienced in the model and make the
+ *    planning backups of one step
+ */
+static void
+qlearn_agent_plan (qlearn_agent * p_agent, unsigned int state)
+{
+  learned_model * p_model = p_agent->p_model;
+  pqueue * p_queue = p_agent->p_queue;
+  unsigned int sa = p_agent->prevState * p_model->numActions +
+    p_agent->prevAction;
+  unsigned int k, i;
+
+  model_observe (p_model, p_agent->prevState, p_agent->prevAction, state,
+                 p_agent->prevReward);
+
+  // Dyna-Q: back up pairs drawn uniformly from experience
+  if (NULL == p_queue) {
+    for (k=0 ; k < p_agent->backups ; k++) {
+      sa = model_sample_pair (p_model, &p_agent->planRng);
+      qlearn_agent_backup (p_agent, sa, qlearn_agent_expected (p_agent, sa));
+    }
+    return;
+  }
+
+  // Prioritized sweeping: back up the largest changes, then queue the
+  // pairs leading to each state changed
+  qlearn_agent_queue (p_agent, sa);
+
+  for (k=0 ; k < p_agent->backups && p_queue->size > 0 ; k++) {
+    const model_list * p_pred;
+
+    sa = pqueue_pop (p_queue);
+    qlearn_agent_backup (p_agent, sa, qlearn_agent_expected (p_agent, sa));
+
+    p_pred = p_model->predecessors + sa / p_model->numActions;
+    for (i=0 ; i < p_pred->size ; i++)
+      qlearn_agent_queue (p_agent, p_pred->keys[i]);
+  }
+} // qlearn_agent_plan
+
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int
+qlearn_agent_action (void * context, unsigned int state, double reward)
+{
+  qlearn_agent * p_agent = context;
+  const mdp * p_mdp = p_agent->p_mdp;
+  unsigned int action = 0;
+  double maxQ = 0;
+  // if terminal state
+  if (MDP_IS_TERMINAL(p_mdp, state)) {
+    qlearn_agent_terminal (p_agent, state, reward);
+    maxQ = reward;
+  } else {
+    // max Q[state,.] and the available action maximizing the exploration
+    // function f(Q[state,a],N[state,a]) (R&N p. 842)
+    action = qlearn_agent_best (p_agent, state, &maxQ);
+  }
+
+  if (p_agent->prevValid) {
+    bool changed = (p_agent->prevState == state); // This row was updated
+
+    double error = qlearn_agent_update (p_agent, p_agent->prevState,
+                                        p_agent->prevAction,
+                                        p_agent->prevReward +
+                                        p_agent->gamma*maxQ, 1.0, true);
+
+    if (NULL != p_agent->p_trace) {
+      qlearn_agent_trace (p_agent, error);
+      changed = true;
+    }
+
+    if (NULL != p_agent->p_replay) {
+      qlearn_agent_replay (p_agent, state);
+      changed = true;
+    }
+
+    if (NULL != p_agent->p_model) {
+      qlearn_agent_plan (p_agent, state);
+      changed = true;
+    }
+
+    // Updates may have changed this row, so choose again
+    if (changed && !MDP_IS_TERMINAL(p_mdp, state))
+      action = qlearn_agent_best (p_agent, state, &maxQ);
+  }
+
+  // Traces end with the episode or an action not greedy in Q (Watkins),
+  // and otherwise decay
+  if (NULL != p_agent->p_trace) {
+    if (MDP_IS_TERMINAL(p_mdp, state) ||
+        qlearn_agent_value (p_agent, state * p_mdp->numActions + action) <
+        maxQ)
+      trace_clear (p_agent->p_trace);
+    else
+      trace_decay (p_agent->p_trace, p_agent->gamma * p_agent->lambda);
+  }
+
+  if (MDP_IS_TERMINAL(p_mdp, state)) {
+    p_agent->prevValid = false;
+  } else {
+    p_agent->prevState = state;
+    p_agent->prevAction = action;
+    p_agent->prevReward = reward;
+    p_agent->prevValid = true;
+  }
+
+  return p_agent->prevAction;
+} // qlearn_agent_action
+
+
+/*  Procedure
+ *    qlearn_agent_truncate
+ *
+ *  Purpose
+ *    Forget the previous state when a trial is cut short, since it has no
+ *    successor
+ */
+static void
+qlearn_agent_truncate (void * context)
+{
+  qlearn_agent * p_agent = context;
+
+  p_agent->prevValid = false;
+  if (NULL != p_agent->p_trace)
+    trace_clear (p_agent->p_trace);
+} // qlearn_agent_truncate
+
+
+////////////////////////////////////////////////////////////////////////////////
+rl_agent
+qlearn_agent_interface (qlearn_agent * p_agent)
+{
+  rl_agent agent = { p_agent, qlearn_agent_action, qlearn_agent_truncate };
+
+  return agent;
+} // qlearn_agent_interface
+
+
+/*  Procedure
+ *    factory_create
+ *
+ *  Purpose
+ *    Create a replica from a qlearn_agent_config
+ */
+static rl_agent
+factory_create (void * config, const environment * p_env)
+{
+  const qlearn_agent_config * p_config = config;
+  qlearn_agent * p_agent = qlearn_agent_create (env_get_structure (p_env),
+                                                p_config->gamma,
+                                                p_config->reward,
+                                                p_config->attempts);
+
+  if (p_config->replays > 0)
+    qlearn_agent_enable_replay (p_agent, p_config->replays,
+                                p_config->replayCapacity,
+                                env_agent_seed (p_env));
+
+  if (p_config->lambda > 0)
+    qlearn_agent_enable_traces (p_agent, p_config->lambda);
+
+  if (p_config->backups > 0)
+    qlearn_agent_enable_planning (p_agent, p_config->backups,
+                                  p_config->threshold, env_agent_seed (p_env));
+
+  return qlearn_agent_interface (p_agent);
+} // factory_create
+
+
+/*  Procedure
+ *    factory_values
+ *
+ *  Purpose
+ *    Report a replica's Q-values, row by row
+ */
+static void
+factory_values (void * context, double * values)
+{
+  const qlearn_agent * p_agent = context;
+  const qtable * p_table = p_agent->p_table;
+
+  // The table's layout is the factory's
+  memcpy (values, p_table->value,
+          sizeof(double) * p_table->numStates * p_table->numActions);
+} // factory_values
+
+
+/*  Procedure
+ *    factory_destroy
+ *
+ *  Purpose
+ *    Release a replica
+ */
+static void
+factory_destroy (void * context)
+{
+  qlearn_agent_free (context);
+} // factory_destroy
+
+
+////////////////////////////////////////////////////////////////////////////////
+rl_agent_factory
+qlearn_agent_factory (qlearn_agent_config * p_config,
+                      const environment * p_env)
+{
+  rl_agent_factory factory;
+
+  factory.config = p_config;
+  factory.valueLength = p_env->p_mdp->numStates * p_env->p_mdp->numActions;
+  factory.valueWidth = p_env->p_mdp->numActions;
+  factory.create = factory_create;
+  factory.values = factory_values;
+  factory.destroy = factory_destroy;
+
+  return factory;
+} // qlearn_agent_factory
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+qlearn_print (const mdp * p_mdp, const double * Q)
+{
+  unsigned int state, action;
+  size_t A = p_mdp->numActions;
+
+  // Print values
+  printf("Q[s,a]\n");
+  for ( state=0 ; state < p_mdp->numStates ; state++)
+  {
+    for ( action=0 ; action < p_mdp->numActions ; action++)
+      printf ("%1.3f\t",Q[state*A + action]);
+    printf ("\n");
+  }
+
+  // Print utilities
+  printf("\nU[s]\n");
+  for ( state = 0; state < p_mdp->numStates ; state++) // For each state
+    
+    // if there are any actions in the state
+    if (p_mdp->numAvailableActions[state] > 0)
+      // print the maximum Q-value (which is the utility)
+      printf ("%f\n", max_value (p_mdp->numAvailableActions[state],
+                                 p_mdp->actions[state],
+                                 Q + state*A ) );
+  // Otherwise, if the state is terminal
+    else if (p_mdp->terminal[state])
+      // Print the value of the first action (which is the reward)
+      printf ("%f\n", Q[state*A] );
+    else
+      // Otherwise, just print X
+      printf ("X\n");
+
+
+  // Print policy, breaking ties toward the lowest action as the agent does
+  printf ("\npolicy[s]\n");
+  for ( state = 0; state < p_mdp->numStates ; state++)
+    if (p_mdp->numAvailableActions[state] > 0)
+      printf ("%u\n", arg_max_value_mask ( p_mdp->stateInfo[state].actionMask,
+                                           Q + state*A ) );
+    else
+      printf ("X\n");
+} // qlearn_print
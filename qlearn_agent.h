@@ -0,0 +1,398 @@
+/*
+ * File
+ *   qlearn_agent.h
+ *
+ * Summary
+ *   An active Q-learning agent (Q-Learning-Agent of Russell & Norvig,
+ *   Artificial Intelligence, 2010, p. 844) with an optimistic exploration
+ *   function. Each agent owns its state, so several may run at once;
+ *   agents may also share one Q table, learning it together (see qtable.h).
+ *
+ *   Agents may learn by Watkins's Q(lambda) instead of one-step updates:
+ *   each temporal difference also adjusts the pairs tried earlier in the
+ *   episode by their eligibility traces (see trace.h), until an action
+ *   that is not greedy is taken.
+ *
+ *   Agents may also plan, as Dyna-Q (Sutton, 1990): they learn a sparse
+ *   model of the transitions and rewards they experience (see model.h)
+ *   and after every real step make a number of backups simulated from
+ *   it, of pairs drawn uniformly or, with prioritized sweeping (Moore &
+ *   Atkeson, 1993), of the pairs whose values most need changing.
+ *
+ *   An agent with a table of its own caches each state's largest Q-value
+ *   and the action its exploration function chooses, adjusting them as
+ *   single entries of the row change, so that choosing an action or
+ *   estimating a utility seldom searches the row.
+ *
+ */
+#ifndef __QLEARN_AGENT_H__
+#define __QLEARN_AGENT_H__
+
+#include <stdbool.h>
+#include <limits.h>
+
+#include "mdp.h"
+#include "max.h"
+#include "qtable.h"
+#include "replay.h"
+#include "trace.h"
+#include "model.h"
+#include "pqueue.h"
+#include "rng.h"
+#include "environment.h"
+#include "runner.h"
+
+typedef struct {
+  mdp *         p_mdp;      /* MDP to operate on/in */
+  double        gamma;      /* Discount factor to use */
+  qtable *      p_table;    /* Values Q[s,a] and counts N[s,a] of
+                               state-action pairs */
+  unsigned int  prevState;  /* Previous state encountered */
+  unsigned int  prevAction; /* Previous action taken */
+  double        prevReward; /* Previous reward received */
+  bool          prevValid;  /* Whether the previous state-action pair is
+                               valid (i.e., not restarting after terminal
+                               state) */
+  double        bestReward; /* "Optimistic estimate of best possible reward" */
+  double        minTries;   /* Minimum number of times agent must
+                               attempt each state-action pair */
+  max_kernel    kernel;     /* Max/argmax specialized for numActions */
+  bool          shared;     /* Whether p_table is shared with concurrent
+                               agents (and so not owned) */
+  double *      rowValue;   /* Snapshot of a row of a shared table */
+  uint32_t *    rowCount;
+  double *      bestValue;  /* max_a Q[s,a] of each state, when cached */
+  unsigned int* bestAction; /* Action of each state maximizing the
+                               exploration function, or QLEARN_STALE; NULL
+                               when the table is shared (and so cannot be
+                               cached) */
+  replay_buffer * p_replay; /* Transitions experienced, or NULL when
+                               learning only from the latest */
+  unsigned int  replays;    /* Transitions replayed per step */
+  trace_list *  p_trace;    /* Eligibility of pairs s*numActions+a, or NULL
+                               for one-step updates */
+  double        lambda;     /* Trace decay */
+  learned_model * p_model;  /* Model of the transitions experienced, or
+                               NULL when not planning */
+  pqueue *      p_queue;    /* Pairs awaiting backups by priority, or NULL
+                               when planning draws pairs uniformly */
+  unsigned int  backups;    /* Planning backups per step */
+  double        threshold;  /* Smallest change a pair is queued for */
+  rng_state     planRng;    /* Stream of pairs drawn for planning */
+} qlearn_agent;
+
+typedef struct {
+  double gamma;     /* Discount factor to use */
+  double reward;    /* Optimistic estimate of best possible reward */
+  double attempts;  /* Minimum number of times agent must attempt each
+                       state-action pair */
+  unsigned int replays;  /* Transitions replayed per step (0 for none) */
+  unsigned int replayCapacity; /* Transitions kept for replay */
+  double lambda;    /* Trace decay (0 for one-step updates) */
+  unsigned int backups; /* Planning backups per step (0 for none) */
+  double threshold; /* Smallest change queued by prioritized sweeping (0
+                       to plan from uniformly drawn pairs instead) */
+} qlearn_agent_config;
+
+/* Cached best action of a state whose row must be searched again */
+#define QLEARN_STALE UINT_MAX
+
+/* Transitions kept for replay unless configured otherwise */
+#define QLEARN_REPLAY_CAPACITY 65536
+
+
+/*  Procedure
+ *    qlearn_agent_create
+ *
+ *  Purpose
+ *    Create a Q-learning agent using partial MDP information
+ *
+ *  Parameters
+ *    p_mdp
+ *    gamma
+ *    reward
+ *    attempts
+ *
+ *  Produces
+ *    p_agent, a qlearn_agent*
+ *
+ *  Preconditions
+ *    p_mdp points to a valid MDP struct (as from env_get_structure, so
+ *    its transitionProb may be NULL); the agent takes ownership of it
+ *    0 < gamma < 1
+ *
+ *  Postconditions
+ *    p_agent->p_table is a zeroed numStates x numActions table.
+ *    The exploration function gives reward for pairs tried fewer than
+ *    attempts times.
+ *    p_agent must be released with qlearn_agent_free.
+ *    Any failure causes program exit.
+ */
+qlearn_agent *
+qlearn_agent_create (mdp * p_mdp, double gamma, double reward,
+                     double attempts);
+
+
+/*  Procedure
+ *    qlearn_agent_create_shared
+ *
+ *  Purpose
+ *    Create a Q-learning agent that learns in a table shared with other
+ *    agents running concurrently
+ *
+ *  Parameters
+ *    p_mdp
+ *    gamma
+ *    reward
+ *    attempts
+ *    p_table
+ *
+ *  Produces
+ *    p_agent, a qlearn_agent*
+ *
+ *  Preconditions
+ *    As for qlearn_agent_create
+ *    p_table has p_mdp's dimensions and outlives p_agent
+ *
+ *  Postconditions
+ *    p_agent is as from qlearn_agent_create, except that it reads and
+ *    updates p_table following the sharing protocol of qtable.h (lock-free
+ *    unless p_table is sharded), and does not free it.
+ *    Any failure causes program exit.
+ */
+qlearn_agent *
+qlearn_agent_create_shared (mdp * p_mdp, double gamma, double reward,
+                            double attempts, qtable * p_table);
+
+
+/*  Procedure
+ *    qlearn_agent_enable_replay
+ *
+ *  Purpose
+ *    Have an agent learn also from replayed experience
+ *
+ *  Parameters
+ *    p_agent
+ *    replays
+ *    capacity
+ *    seed
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_agent was produced by qlearn_agent_create or
+ *    qlearn_agent_create_shared
+ *    capacity > 0
+ *
+ *  Postconditions
+ *    Each transition p_agent experiences from now on is stored in a
+ *    prioritized replay buffer of capacity transitions (see replay.h),
+ *    sampled with a stream seeded by seed. After each online update,
+ *    replays stored transitions are sampled and Q[s,a] moved toward
+ *    r + gamma max_a' Q[s',a'] by their importance-sampling weight times
+ *    the learning rate for N[s,a]; replays do not count as visits.
+ *    Any failure causes program exit.
+ */
+void
+qlearn_agent_enable_replay (qlearn_agent * p_agent, unsigned int replays,
+                            unsigned int capacity, uint64_t seed);
+
+
+/*  Procedure
+ *    qlearn_agent_enable_traces
+ *
+ *  Purpose
+ *    Have an agent learn by Watkins's Q(lambda)
+ *
+ *  Parameters
+ *    p_agent
+ *    lambda
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_agent was produced by qlearn_agent_create or
+ *    qlearn_agent_create_shared
+ *    0 < lambda <= 1
+ *
+ *  Postconditions
+ *    From now on, after each online update of Q[s,a] by the error d, every
+ *    other pair with an active trace e is moved by d e times its learning
+ *    rate; the trace of (s,a) is then 1, and those of the other actions
+ *    of s are cleared. Traces decay by gamma*lambda
+ *    (dropping below TRACE_DEFAULT_CUTOFF) while the actions taken are
+ *    greedy in Q, and are cleared when one is not, or when an episode
+ *    ends.
+ *    Any failure causes program exit.
+ */
+void
+qlearn_agent_enable_traces (qlearn_agent * p_agent, double lambda);
+
+
+/*  Procedure
+ *    qlearn_agent_enable_planning
+ *
+ *  Purpose
+ *    Have an agent learn a model and plan with it (Dyna-Q)
+ *
+ *  Parameters
+ *    p_agent
+ *    backups
+ *    threshold
+ *    seed
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_agent was produced by qlearn_agent_create or
+ *    qlearn_agent_create_shared
+ *    threshold >= 0
+ *
+ *  Postconditions
+ *    From now on, each transition p_agent experiences is recorded in a
+ *    learned model. After each online update, up to backups pairs (s,a)
+ *    are backed up: Q[s,a] is set to R(s) + gamma sum_t P(t|s,a) U(t)
+ *    under the model, with U(t) = max_a' Q[t,a']. Backups do not count as
+ *    visits.
+ *    With threshold 0, the pairs are drawn uniformly from those
+ *    experienced, by stream 1 of seed (see rng_stream). Otherwise
+ *    (prioritized sweeping), the pair just experienced and, after each
+ *    backup of a pair of state t, every pair observed to lead to t, are
+ *    queued by how much a backup would change them when that is more
+ *    than threshold, and the pairs backed up are taken from the queue,
+ *    largest change first.
+ *    Any failure causes program exit.
+ */
+void
+qlearn_agent_enable_planning (qlearn_agent * p_agent, unsigned int backups,
+                              double threshold, uint64_t seed);
+
+
+/*  Procedure
+ *    qlearn_agent_free
+ *
+ *  Purpose
+ *    Release a Q-learning agent and its MDP
+ *
+ *  Parameters
+ *    p_agent
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_agent was produced by qlearn_agent_create or
+ *    qlearn_agent_create_shared
+ *
+ *  Postconditions
+ *    All memory for p_agent is freed, except a shared table
+ */
+void
+qlearn_agent_free (qlearn_agent * p_agent);
+
+
+/*  Procedure
+ *    qlearn_agent_action
+ *
+ *  Purpose
+ *    Receive reward for a prior action; indicate action to take in given
+ *    state
+ *
+ *  Parameters
+ *    context
+ *    state
+ *    reward
+ *
+ *  Produces
+ *    action, an unsigned int
+ *
+ *  Preconditions
+ *    context is a qlearn_agent* produced by qlearn_agent_create or
+ *    qlearn_agent_create_shared
+ *    0 <= state < numStates
+ *
+ *  Postconditions
+ *    Q[prevState,prevAction] is updated toward reward + gamma max_a Q[state,a]
+ *    action is a member of p_mdp->actions[state]
+ */
+unsigned int
+qlearn_agent_action (void * context, unsigned int state, double reward);
+
+
+/*  Procedure
+ *    qlearn_agent_interface
+ *
+ *  Purpose
+ *    Wrap a Q-learning agent for use with env_run
+ *
+ *  Parameters
+ *    p_agent
+ *
+ *  Produces
+ *    agent, an rl_agent
+ */
+rl_agent
+qlearn_agent_interface (qlearn_agent * p_agent);
+
+
+/*  Procedure
+ *    qlearn_agent_factory
+ *
+ *  Purpose
+ *    Describe how to create Q-learning agent replicas for runner_run
+ *
+ *  Parameters
+ *    p_config
+ *    p_env
+ *
+ *  Produces
+ *    factory, an rl_agent_factory
+ *
+ *  Preconditions
+ *    p_config outlives any use of factory
+ *    p_env was produced by env_create
+ *
+ *  Postconditions
+ *    Each agent created by factory is qlearn_agent_create applied to
+ *    env_get_structure of its environment and *p_config, replaying
+ *    p_config->replays transitions per step when that is positive (with a
+ *    stream seeded by env_agent_seed), learning by Q(lambda) when
+ *    p_config->lambda is positive, and planning with p_config->backups
+ *    backups per step when that is positive (again seeded by
+ *    env_agent_seed). Its values are Q[s,a], stored at index
+ *    s*numActions+a.
+ */
+rl_agent_factory
+qlearn_agent_factory (qlearn_agent_config * p_config,
+                      const environment * p_env);
+
+
+/*  Procedure
+ *    qlearn_print
+ *
+ *  Purpose
+ *    Print Q-values and the utilities and greedy policy they imply
+ *
+ *  Parameters
+ *    p_mdp
+ *    Q
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    Q holds Q[s,a] at index s*numActions+a for the states and actions of
+ *    p_mdp
+ *
+ *  Postconditions
+ *    Q[s,a], U[s] and policy[s] have been printed to standard output.
+ *    policy[s] is the lowest-numbered available action of largest Q[s,a],
+ *    the tie-break the agent and its convergence monitor use.
+ */
+void
+qlearn_print (const mdp * p_mdp, const double * Q);
+
+#endif // __QLEARN_AGENT_H__
@@ -0,0 +1,121 @@
+/*
+ * File
+ *   qtable.c
+ *
+ * Summary
+ *   Allocation of flat state-action tables and their row locks.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "qtable.h"
+
+
+/*  Procedure
+ *    qtable_aligned
+ *
+ *  Purpose
+ *    Allocate zeroed, cache-line aligned memory or exit with a message
+ *    naming what was requested
+ */
+static void *
+qtable_aligned (size_t bytes, const char * what)
+{
+  void * ptr;
+
+  // Allocate at least one line so empty tables are valid
+  bytes = (bytes + 63) & ~(size_t)63;
+  if (0 == bytes)
+    bytes = 64;
+
+  if (0 != posix_memalign (&ptr, 64, bytes))
+  {
+    fprintf (stderr,"qtable_create failed: Could not allocate %s\n", what);
+    exit (EXIT_FAILURE);
+  }
+
+  memset (ptr, 0, bytes);
+  return ptr;
+} // qtable_aligned
+
+
+////////////////////////////////////////////////////////////////////////////////
+qtable *
+qtable_create (unsigned int numStates, unsigned int numActions)
+{
+  size_t entries = (size_t)numStates * numActions;
+  qtable * p_table = qtable_aligned (sizeof(qtable), "qtable");
+
+  p_table->numStates = numStates;
+  p_table->numActions = numActions;
+  p_table->value = qtable_aligned (sizeof(double) * entries, "value");
+  p_table->count = qtable_aligned (sizeof(uint32_t) * entries, "count");
+  p_table->numShards = 0;
+  p_table->shards = NULL;
+
+  return p_table;
+} // qtable_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+qtable *
+qtable_create_sharded (unsigned int numStates, unsigned int numActions,
+                       unsigned int numShards)
+{
+  qtable * p_table = qtable_create (numStates, numActions);
+  unsigned int i;
+
+  p_table->shards = qtable_aligned (sizeof(qtable_shard) * numShards,
+                                    "shards");
+
+  for (i=0 ; i < numShards ; i++)
+    if (0 != pthread_mutex_init (&p_table->shards[i].lock, NULL))
+    {
+      fprintf (stderr,"qtable_create failed: Could not initialize shard %u\n",
+               i);
+      exit (EXIT_FAILURE);
+    }
+
+  p_table->numShards = numShards;
+
+  return p_table;
+} // qtable_create_sharded
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+qtable_snapshot (const qtable * p_table, unsigned int state, double * values,
+                 uint32_t * counts)
+{
+  const double * Q = QTABLE_VALUES(p_table, state);
+  const uint32_t * N = QTABLE_COUNTS(p_table, state);
+  unsigned int a;
+
+  QTABLE_LOCK(p_table, state);
+
+  for (a=0 ; a < p_table->numActions ; a++)
+  {
+    __atomic_load (Q + a, values + a, __ATOMIC_RELAXED);
+    counts[a] = __atomic_load_n (N + a, __ATOMIC_RELAXED);
+  }
+
+  QTABLE_UNLOCK(p_table, state);
+} // qtable_snapshot
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+qtable_free (qtable * p_table)
+{
+  unsigned int i;
+
+  for (i=0 ; i < p_table->numShards ; i++)
+    pthread_mutex_destroy (&p_table->shards[i].lock);
+
+  free (p_table->shards);
+  free (p_table->value);
+  free (p_table->count);
+  free (p_table);
+} // qtable_free
@@ -0,0 +1,167 @@
+/*
+ * File
+ *   qtable.h
+ *
+ * Summary
+ *   Flat state-action tables of Q-values and visit counts. Values and
+ *   counts are kept in separate contiguous arrays (rather than interleaved)
+ *   so each state's row of values is a plain double array for the max
+ *   kernels, and counts take four bytes instead of eight. Both arrays are
+ *   cache-line aligned, and entry (s,a) is at index s*numActions+a.
+ *
+ *   A table may be shared by agents updating it concurrently. Unsharded,
+ *   such agents read and write entries with relaxed atomic operations and
+ *   no locks (Hogwild!: an update racing another to the same pair may be
+ *   lost). Sharded, the rows are striped over locks (state s belongs to
+ *   shard s % numShards) that writers, and readers wanting whole rows,
+ *   hold, so no update is lost and only agents in one shard contend.
+ *
+ */
+#ifndef __QTABLE_H__
+#define __QTABLE_H__
+
+#include <stdint.h>
+#include <pthread.h>
+
+/* Lock of one shard of rows, alone on its cache line */
+typedef struct {
+  pthread_mutex_t lock;
+} __attribute__((aligned(64))) qtable_shard;
+
+typedef struct {
+  unsigned int numStates;  /* Number of states (rows) */
+  unsigned int numActions; /* Number of actions (columns) */
+  double *     value;      /* Values Q[s,a] of state-action pairs */
+  uint32_t *   count;      /* Visit counts N[s,a] of state-action pairs,
+                              saturating at UINT32_MAX */
+  unsigned int numShards;  /* Number of row locks, or 0 when unsharded */
+  qtable_shard * shards;   /* Row locks (NULL when unsharded) */
+} qtable;
+
+/* Row of values, or counts, of a state */
+#define QTABLE_VALUES(p_table, s) \
+  ((p_table)->value + (size_t)(s) * (p_table)->numActions)
+#define QTABLE_COUNTS(p_table, s) \
+  ((p_table)->count + (size_t)(s) * (p_table)->numActions)
+
+/* Lock of a state's shard (sharded tables only) */
+#define QTABLE_SHARD_LOCK(p_table, s) \
+  (&(p_table)->shards[(s) % (p_table)->numShards].lock)
+
+/* Acquire, or release, the lock of a state's shard (if sharded) */
+#define QTABLE_LOCK(p_table, s)                                 \
+  do {                                                          \
+    if ((p_table)->numShards)                                   \
+      pthread_mutex_lock (QTABLE_SHARD_LOCK(p_table, s));       \
+  } while (0)
+#define QTABLE_UNLOCK(p_table, s)                               \
+  do {                                                          \
+    if ((p_table)->numShards)                                   \
+      pthread_mutex_unlock (QTABLE_SHARD_LOCK(p_table, s));     \
+  } while (0)
+
+
+/*  Procedure
+ *    qtable_create
+ *
+ *  Purpose
+ *    Allocate a zeroed state-action table
+ *
+ *  Parameters
+ *    numStates
+ *    numActions
+ *
+ *  Produces
+ *    p_table, a qtable*
+ *
+ *  Postconditions
+ *    Every value and count of p_table is zero.
+ *    p_table must be released with qtable_free.
+ *    Any failure causes program exit.
+ */
+qtable *
+qtable_create (unsigned int numStates, unsigned int numActions);
+
+
+/*  Procedure
+ *    qtable_create_sharded
+ *
+ *  Purpose
+ *    Allocate a zeroed state-action table whose rows are guarded by locks
+ *
+ *  Parameters
+ *    numStates
+ *    numActions
+ *    numShards
+ *
+ *  Produces
+ *    p_table, a qtable*
+ *
+ *  Preconditions
+ *    numShards > 0
+ *
+ *  Postconditions
+ *    As for qtable_create, with p_table->numShards = numShards unlocked
+ *    row locks.
+ *    Any failure causes program exit.
+ */
+qtable *
+qtable_create_sharded (unsigned int numStates, unsigned int numActions,
+                       unsigned int numShards);
+
+
+/*  Procedure
+ *    qtable_snapshot
+ *
+ *  Purpose
+ *    Copy a state's row of values and counts while other agents may be
+ *    updating it
+ *
+ *  Parameters
+ *    p_table
+ *    state
+ *    values
+ *    counts
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    state < p_table->numStates
+ *    values and counts have room for p_table->numActions entries
+ *    Concurrent writers follow the protocol above
+ *
+ *  Postconditions
+ *    values and counts hold row state of p_table. When sharded, the copy
+ *    is taken under the row's lock and so is a consistent row; otherwise
+ *    each entry is read atomically, but entries may come from different
+ *    moments.
+ */
+void
+qtable_snapshot (const qtable * p_table, unsigned int state, double * values,
+                 uint32_t * counts);
+
+
+/*  Procedure
+ *    qtable_free
+ *
+ *  Purpose
+ *    Release a state-action table
+ *
+ *  Parameters
+ *    p_table
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_table was produced by qtable_create or qtable_create_sharded, and
+ *    no agent is still using it
+ *
+ *  Postconditions
+ *    All memory for p_table is freed
+ */
+void
+qtable_free (qtable * p_table);
+
+#endif // __QTABLE_H__
@@ -0,0 +1,173 @@
+/*
+ * File
+ *   replay.c
+ *
+ * Summary
+ *   Prioritized replay buffers: a ring of transitions with sum and min
+ *   trees over their priorities.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+
+#include "rng.h"
+#include "replay.h"
+
+
+/*  Procedure
+ *    replay_malloc
+ *
+ *  Purpose
+ *    Allocate memory or exit with a message naming what was requested
+ */
+static void *
+replay_malloc (size_t bytes, const char * what)
+{
+  void * ptr = malloc (bytes);
+
+  if (NULL == ptr)
+  {
+    fprintf (stderr,"replay_create failed: Could not allocate %s (%s)\n",
+             what, strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+  return ptr;
+} // replay_malloc
+
+
+/*  Procedure
+ *    replay_set
+ *
+ *  Purpose
+ *    Assign the priority of a slot and restore both trees above it
+ *
+ *  Practica
+ *    Parents are recomputed from their children rather than adjusted by
+ *    the change, so rounding errors never accumulate in the totals.
+ */
+static void
+replay_set (replay_buffer * p_replay, unsigned int slot, double priority)
+{
+  double * sum = p_replay->sum;
+  double * min = p_replay->min;
+  unsigned int i = p_replay->leaves + slot;
+
+  sum[i] = priority;
+  min[i] = priority;
+
+  for (i /= 2 ; i > 0 ; i /= 2)
+  {
+    sum[i] = sum[2*i] + sum[2*i + 1];
+    min[i] = (min[2*i] < min[2*i + 1]) ? min[2*i] : min[2*i + 1];
+  }
+} // replay_set
+
+
+////////////////////////////////////////////////////////////////////////////////
+replay_buffer *
+replay_create (unsigned int capacity, double alpha, double beta,
+               uint64_t seed)
+{
+  replay_buffer * p_replay = replay_malloc (sizeof(replay_buffer),
+                                            "replay_buffer");
+  unsigned int i;
+
+  p_replay->capacity = capacity;
+  p_replay->size = 0;
+  p_replay->next = 0;
+  p_replay->maxPriority = 1.0;
+  p_replay->alpha = alpha;
+  p_replay->beta = beta;
+  rng_seed (&p_replay->rng, seed);
+
+  for (p_replay->leaves = 1 ; p_replay->leaves < capacity ;
+       p_replay->leaves *= 2)
+    ;
+
+  p_replay->sum = replay_malloc (sizeof(double) * 2 * p_replay->leaves,
+                                 "sum tree");
+  p_replay->min = replay_malloc (sizeof(double) * 2 * p_replay->leaves,
+                                 "min tree");
+  p_replay->transitions = replay_malloc (sizeof(replay_transition) * capacity,
+                                         "transitions");
+
+  // Empty leaves add nothing to sums and never are minima
+  for (i=0 ; i < 2 * p_replay->leaves ; i++)
+  {
+    p_replay->sum[i] = 0.0;
+    p_replay->min[i] = INFINITY;
+  }
+
+  return p_replay;
+} // replay_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+replay_free (replay_buffer * p_replay)
+{
+  free (p_replay->sum);
+  free (p_replay->min);
+  free (p_replay->transitions);
+  free (p_replay);
+} // replay_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+replay_add (replay_buffer * p_replay, const replay_transition * p_transition)
+{
+  unsigned int slot = p_replay->next;
+
+  p_replay->transitions[slot] = *p_transition;
+  replay_set (p_replay, slot, p_replay->maxPriority);
+
+  p_replay->next = (slot + 1 == p_replay->capacity) ? 0 : slot + 1;
+  if (p_replay->size < p_replay->capacity)
+    p_replay->size++;
+} // replay_add
+
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int
+replay_sample (replay_buffer * p_replay, double * p_weight)
+{
+  const double * sum = p_replay->sum;
+  double total = sum[1];
+  double u = rng_uniform (&p_replay->rng) * total;
+  unsigned int i = 1;
+
+  // Descend toward the leaf whose prefix sums bracket u; a child with
+  // nothing in it is never entered, whatever the rounding of u
+  while (i < p_replay->leaves)
+  {
+    i *= 2;
+    if ((u >= sum[i] && sum[i+1] > 0) || 0 == sum[i])
+    {
+      u -= sum[i];
+      i++;
+    }
+  }
+
+  // Weight relative to the largest, which has the smallest priority
+  *p_weight = (0 == p_replay->beta) ? 1.0 :
+    pow (p_replay->min[1] / sum[i], p_replay->beta);
+
+  return i - p_replay->leaves;
+} // replay_sample
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+replay_update (replay_buffer * p_replay, unsigned int slot, double error)
+{
+  double priority = pow (fabs (error) + REPLAY_EPSILON, p_replay->alpha);
+
+  if (priority > p_replay->maxPriority)
+    p_replay->maxPriority = priority;
+
+  replay_set (p_replay, slot, priority);
+} // replay_update
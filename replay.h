@@ -0,0 +1,180 @@
+/*
+ * File
+ *   replay.h
+ *
+ * Summary
+ *   Prioritized experience replay (Schaul et al., 2016): a fixed-capacity
+ *   ring buffer of transitions, sampled in proportion to priorities kept
+ *   in a sum tree, so adding, sampling and reprioritizing each take
+ *   O(log capacity). A transition's priority is (|delta| + epsilon)^alpha
+ *   for the last temporal-difference error delta seen for it; new
+ *   transitions get the largest priority so far, so each is replayed at
+ *   least once soon. The bias of non-uniform sampling is corrected by
+ *   importance-sampling weights (N P(i))^-beta, normalized by the largest
+ *   (found with a parallel min tree).
+ *
+ */
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <stdint.h>
+
+#include "rng.h"
+
+/* Default priority exponent (0 samples uniformly) */
+#define REPLAY_DEFAULT_ALPHA 0.6
+
+/* Default importance-sampling exponent (0 uses no correction) */
+#define REPLAY_DEFAULT_BETA 0.4
+
+/* Added to every error so no transition's priority is zero */
+#define REPLAY_EPSILON 0.01
+
+typedef struct {
+  unsigned int state;   /* State the action was taken in */
+  unsigned int action;  /* Action taken */
+  unsigned int next;    /* Successor state */
+  double       reward;  /* Reward of state */
+} replay_transition;
+
+typedef struct {
+  unsigned int capacity;  /* Transitions kept */
+  unsigned int size;      /* Transitions stored (at most capacity) */
+  unsigned int next;      /* Slot the next transition overwrites */
+  unsigned int leaves;    /* Leaves of the trees (a power of two at least
+                             capacity); slot k is leaf leaves+k */
+  double *     sum;       /* Sum tree of priorities: node i is the sum of
+                             nodes 2i and 2i+1 (node 1 the total) */
+  double *     min;       /* Min tree of priorities (empty leaves are
+                             infinite) */
+  replay_transition * transitions; /* Ring buffer of transitions */
+  double       maxPriority; /* Priority of new transitions */
+  double       alpha;     /* Priority exponent */
+  double       beta;      /* Importance-sampling exponent */
+  rng_state    rng;       /* Stream of sampling draws */
+} replay_buffer;
+
+
+/*  Procedure
+ *    replay_create
+ *
+ *  Purpose
+ *    Allocate an empty replay buffer
+ *
+ *  Parameters
+ *    capacity
+ *    alpha
+ *    beta
+ *    seed
+ *
+ *  Produces
+ *    p_replay, a replay_buffer*
+ *
+ *  Preconditions
+ *    capacity > 0, alpha >= 0, beta >= 0
+ *
+ *  Postconditions
+ *    p_replay is empty and samples with a stream seeded by seed.
+ *    p_replay must be released with replay_free.
+ *    Any failure causes program exit.
+ */
+replay_buffer *
+replay_create (unsigned int capacity, double alpha, double beta,
+               uint64_t seed);
+
+
+/*  Procedure
+ *    replay_free
+ *
+ *  Purpose
+ *    Release a replay buffer
+ *
+ *  Parameters
+ *    p_replay
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_replay was produced by replay_create
+ *
+ *  Postconditions
+ *    All memory for p_replay is freed
+ */
+void
+replay_free (replay_buffer * p_replay);
+
+
+/*  Procedure
+ *    replay_add
+ *
+ *  Purpose
+ *    Store a transition, replacing the oldest when full
+ *
+ *  Parameters
+ *    p_replay
+ *    p_transition
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_replay was produced by replay_create
+ *
+ *  Postconditions
+ *    *p_transition is stored with priority p_replay->maxPriority
+ */
+void
+replay_add (replay_buffer * p_replay, const replay_transition * p_transition);
+
+
+/*  Procedure
+ *    replay_sample
+ *
+ *  Purpose
+ *    Draw a stored transition in proportion to its priority
+ *
+ *  Parameters
+ *    p_replay
+ *    p_weight
+ *
+ *  Produces
+ *    slot, an unsigned int
+ *
+ *  Preconditions
+ *    p_replay->size > 0
+ *
+ *  Postconditions
+ *    p_replay->transitions[slot] was drawn with probability P(slot), its
+ *    priority over the total, and *p_weight = (size P(slot))^-beta
+ *    divided by the largest such weight, so 0 < *p_weight <= 1.
+ */
+unsigned int
+replay_sample (replay_buffer * p_replay, double * p_weight);
+
+
+/*  Procedure
+ *    replay_update
+ *
+ *  Purpose
+ *    Reprioritize a stored transition after replaying it
+ *
+ *  Parameters
+ *    p_replay
+ *    slot
+ *    error
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    slot < p_replay->size
+ *
+ *  Postconditions
+ *    The priority of slot is (|error| + REPLAY_EPSILON)^alpha, and
+ *    p_replay->maxPriority is at least that
+ */
+void
+replay_update (replay_buffer * p_replay, unsigned int slot, double error);
+
+#endif // __REPLAY_H__
@@ -0,0 +1,95 @@
+/*
+ * File
+ *   rng.c
+ *
+ * Summary
+ *   Seeding, jumping and bulk generation for the xoshiro256** generator.
+ *   The generator and jump polynomial are those published by Blackman
+ *   and Vigna (2018).
+ *
+ */
+#include "rng.h"
+
+
+/*  Procedure
+ *    splitmix64
+ *
+ *  Purpose
+ *    Advance a 64-bit counter and return a well-mixed value of it, used to
+ *    expand a seed into a full generator state
+ */
+static uint64_t
+splitmix64 (uint64_t * p_x)
+{
+  uint64_t z = (*p_x += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+} // splitmix64
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+rng_seed (rng_state * p_rng, uint64_t seed)
+{
+  unsigned int i;
+
+  for (i=0 ; i < 4 ; i++)
+    p_rng->s[i] = splitmix64 (&seed);
+} // rng_seed
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+rng_jump (rng_state * p_rng)
+{
+  static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                   0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+  uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  unsigned int i, b;
+
+  for (i=0 ; i < 4 ; i++)
+    for (b=0 ; b < 64 ; b++)
+    {
+      if (JUMP[i] & ((uint64_t)1 << b))
+      {
+        s0 ^= p_rng->s[0];
+        s1 ^= p_rng->s[1];
+        s2 ^= p_rng->s[2];
+        s3 ^= p_rng->s[3];
+      }
+      rng_next (p_rng);
+    }
+
+  p_rng->s[0] = s0;
+  p_rng->s[1] = s1;
+  p_rng->s[2] = s2;
+  p_rng->s[3] = s3;
+} // rng_jump
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+rng_stream (rng_state * p_rng, uint64_t seed, unsigned int index)
+{
+  rng_seed (p_rng, seed);
+
+  while (index-- > 0)
+    rng_jump (p_rng);
+} // rng_stream
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+rng_fill_uniform (rng_state * p_rng, double * buffer, size_t count)
+{
+  // Work on a local copy so the state stays in registers
+  rng_state rng = *p_rng;
+  size_t i;
+
+  for (i=0 ; i < count ; i++)
+    buffer[i] = rng_uniform (&rng);
+
+  *p_rng = rng;
+} // rng_fill_uniform
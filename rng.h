@@ -0,0 +1,170 @@
+/*
+ * File
+ *   rng.h
+ *
+ * Summary
+ *   A small, fast pseudo-random number generator (xoshiro256**) with
+ *   explicit state, so that every environment or thread can own a
+ *   reproducible stream. Streams are separated with rng_jump, which
+ *   advances a generator by 2^128 draws.
+ *
+ */
+#ifndef __RNG_H__
+#define __RNG_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+  uint64_t s[4]; /* Generator state; must not be all zero */
+} rng_state;
+
+
+/*  Procedure
+ *    rng_seed
+ *
+ *  Purpose
+ *    Initialize a generator from a 64-bit seed
+ *
+ *  Parameters
+ *    p_rng
+ *    seed
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_rng points to a valid rng_state
+ *
+ *  Postconditions
+ *    *p_rng is a valid generator state determined entirely by seed
+ *    (expanded with splitmix64, so any seed, including zero, is valid)
+ */
+void
+rng_seed (rng_state * p_rng, uint64_t seed);
+
+
+/*  Procedure
+ *    rng_jump
+ *
+ *  Purpose
+ *    Advance a generator by 2^128 draws
+ *
+ *  Parameters
+ *    p_rng
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_rng points to a seeded rng_state
+ *
+ *  Postconditions
+ *    *p_rng is the state 2^128 draws later, so repeated jumps from one
+ *    seed give non-overlapping streams (for instance, one per thread)
+ */
+void
+rng_jump (rng_state * p_rng);
+
+
+/*  Procedure
+ *    rng_stream
+ *
+ *  Purpose
+ *    Derive the generator for a numbered stream of a seed
+ *
+ *  Parameters
+ *    p_rng
+ *    seed
+ *    index
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_rng points to a valid rng_state
+ *
+ *  Postconditions
+ *    *p_rng is rng_seed(seed) advanced by index jumps
+ */
+void
+rng_stream (rng_state * p_rng, uint64_t seed, unsigned int index);
+
+
+/*  Procedure
+ *    rng_fill_uniform
+ *
+ *  Purpose
+ *    Generate many uniform doubles at once
+ *
+ *  Parameters
+ *    p_rng
+ *    buffer
+ *    count
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_rng points to a seeded rng_state
+ *    buffer points to a valid array of length count
+ *
+ *  Postconditions
+ *    buffer[i] = rng_uniform (p_rng) for successive draws, 0 <= i < count
+ */
+void
+rng_fill_uniform (rng_state * p_rng, double * buffer, size_t count);
+
+
+/*  Procedure
+ *    rng_next
+ *
+ *  Purpose
+ *    Draw 64 random bits
+ */
+static inline uint64_t
+rng_next (rng_state * p_rng)
+{
+  uint64_t * s = p_rng->s;
+  uint64_t x = s[1] * 5;
+  uint64_t result = ((x << 7) | (x >> 57)) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = (s[3] << 45) | (s[3] >> 19);
+
+  return result;
+} // rng_next
+
+
+/*  Procedure
+ *    rng_uniform
+ *
+ *  Purpose
+ *    Draw a double uniformly distributed in [0,1), using 53 random bits
+ */
+static inline double
+rng_uniform (rng_state * p_rng)
+{
+  return (rng_next (p_rng) >> 11) * 0x1.0p-53;
+} // rng_uniform
+
+
+/*  Procedure
+ *    rng_below
+ *
+ *  Purpose
+ *    Draw an integer uniformly distributed in [0,n), for n > 0
+ *    (multiply-shift reduction; bias is at most n/2^32)
+ */
+static inline unsigned int
+rng_below (rng_state * p_rng, unsigned int n)
+{
+  return (unsigned int)(((rng_next (p_rng) >> 32) * (uint64_t)n) >> 32);
+} // rng_below
+
+#endif // __RNG_H__
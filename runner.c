@@ -0,0 +1,366 @@
+/*
+ * File
+ *   runner.c
+ *
+ * Summary
+ *   A thread pool running independent agent replicas on a shared model.
+ *   Workers claim replicas from a shared counter, so uneven replicas
+ *   balance themselves across threads (as do replicas that converge
+ *   early).
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "environment.h"
+#include "converge.h"
+#include "trajlog.h"
+#include "runner.h"
+
+typedef struct {
+  const environment *      p_env;     /* Model shared by every replica */
+  const rl_agent_factory * p_factory; /* Source of agents */
+  const runner_options *   p_opts;    /* Run configuration */
+  runner_result *          p_result;  /* Destination of each replica */
+  unsigned int             next;      /* Next unclaimed replica (atomic) */
+} runner_job;
+
+typedef struct {
+  const rl_agent_factory * p_factory;  /* Source of the agent's values */
+  void *                   context;    /* Agent watched */
+  converge_monitor *       p_converge; /* Judge of its values */
+} replica_watch;
+
+
+/*  Procedure
+ *    runner_malloc
+ *
+ *  Purpose
+ *    Allocate memory or exit with a message naming what was requested
+ */
+static void *
+runner_malloc (size_t bytes, const char * what)
+{
+  void * ptr = malloc (bytes);
+
+  if (NULL == ptr)
+  {
+    fprintf (stderr,"runner_run failed: Could not allocate %s (%s)\n",
+             what, strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+  return ptr;
+} // runner_malloc
+
+
+/*  Procedure
+ *    replica_converged
+ *
+ *  Purpose
+ *    Show a replica's values after a trial to its convergence monitor,
+ *    ending the run once they have converged
+ */
+static bool
+replica_converged (void * context)
+{
+  replica_watch * p_watch = context;
+
+  p_watch->p_factory->values (p_watch->context,
+                              p_watch->p_converge->current);
+
+  return converge_observe (p_watch->p_converge);
+} // replica_converged
+
+
+/*  Procedure
+ *    run_replica
+ *
+ *  Purpose
+ *    Run one replica to completion and record its results
+ */
+static void
+run_replica (runner_job * p_job, unsigned int replica)
+{
+  const runner_options * p_opts = p_job->p_opts;
+  runner_result * p_result = p_job->p_result;
+  environment * p_env = env_share (p_job->p_env);
+  double * values = p_result->values + (size_t)replica * p_result->valueLength;
+  double * curve = NULL;
+  converge_monitor * p_converge = NULL;
+  trajlog * p_log = NULL;
+  unsigned int trial;
+
+  env_seed_stream (p_env, p_opts->seed, replica);
+
+  rl_agent agent = p_job->p_factory->create (p_job->p_factory->config, p_env);
+  rl_agent actor = agent; // What the environment runs
+
+  if (NULL != p_opts->trajlog)
+  {
+    char * path = runner_malloc (strlen (p_opts->trajlog) + 12, "path");
+
+    if (1 == p_opts->replicas)
+      strcpy (path, p_opts->trajlog);
+    else
+      sprintf (path, "%s.%u", p_opts->trajlog, replica);
+
+    p_log = trajlog_open (path, p_env->p_mdp);
+
+    if (NULL == p_log)
+    {
+      fprintf (stderr,"runner_run failed: Could not record to %s\n", path);
+      exit (EXIT_FAILURE);
+    }
+
+    free (path);
+    actor = trajlog_agent (p_log, &agent);
+  }
+
+  if (NULL != p_result->curves)
+    curve = p_result->curves + (size_t)replica * p_opts->trials;
+
+  replica_watch watch = { p_job->p_factory, agent.context, NULL };
+  env_monitor monitor = { &watch, replica_converged };
+
+  if (p_opts->convergeWindow > 0)
+    watch.p_converge = p_converge =
+      converge_create (p_env->p_mdp, p_result->valueLength,
+                       p_job->p_factory->valueWidth,
+                       p_opts->convergeTolerance, p_opts->convergeWindow);
+
+  trial = env_run_monitored (p_env, &actor, p_opts->trials, curve,
+                             (NULL == p_converge) ? NULL : &monitor);
+
+  // A log that could not be written was reported, and the run is valid
+  if (NULL != p_log)
+    trajlog_close (p_log);
+
+  p_result->completed[replica] = trial;
+  p_result->converged[replica] = 0;
+
+  if (NULL != p_converge)
+  {
+    p_result->converged[replica] = p_converge->converged;
+    converge_free (p_converge);
+  }
+
+  // Mark the trials a timeout or convergence prevented
+  if (NULL != curve)
+    for ( ; trial < p_opts->trials ; trial++)
+      curve[trial] = NAN;
+
+  __atomic_fetch_add (&p_result->truncated, p_env->stats.truncated,
+                      __ATOMIC_RELAXED);
+  __atomic_fetch_add (&p_result->timeouts, p_env->stats.timeouts,
+                      __ATOMIC_RELAXED);
+
+  p_job->p_factory->values (agent.context, values);
+
+  p_job->p_factory->destroy (agent.context);
+  env_free (p_env);
+} // run_replica
+
+
+/*  Procedure
+ *    worker_main
+ *
+ *  Purpose
+ *    Claim and run replicas until none remain
+ */
+static void *
+worker_main (void * arg)
+{
+  runner_job * p_job = arg;
+  unsigned int replica;
+
+  while ((replica = __atomic_fetch_add (&p_job->next, 1, __ATOMIC_RELAXED))
+         < p_job->p_opts->replicas)
+    run_replica (p_job, replica);
+
+  return NULL;
+} // worker_main
+
+
+////////////////////////////////////////////////////////////////////////////////
+runner_options
+runner_default_options (void)
+{
+  runner_options opts;
+
+  opts.replicas = 1;
+  opts.trials = 0;
+  opts.threads = 0;
+  opts.seed = ENVIRONMENT_DEFAULT_SEED;
+  opts.recordCurves = false;
+  opts.convergeWindow = 0;
+  opts.convergeTolerance = CONVERGE_DEFAULT_TOLERANCE;
+  opts.trajlog = NULL;
+
+  const char * value;
+  char * endptr;
+
+  value = getenv (RUNNER_CONVERGE_WINDOW_VAR);
+  if (NULL != value && '\0' != value[0])
+  {
+    unsigned long window = strtoul (value, &endptr, 10);
+
+    if ('\0' != *endptr || window > UINT_MAX || '-' == value[0])
+    {
+      fprintf (stderr,"runner_default_options: Illegal value %s=%s\n",
+               RUNNER_CONVERGE_WINDOW_VAR, value);
+      exit (EXIT_FAILURE);
+    }
+    opts.convergeWindow = (unsigned int)window;
+  }
+
+  value = getenv (RUNNER_CONVERGE_TOLERANCE_VAR);
+  if (NULL != value && '\0' != value[0])
+  {
+    opts.convergeTolerance = strtod (value, &endptr);
+
+    if ('\0' != *endptr || !(opts.convergeTolerance >= 0))
+    {
+      fprintf (stderr,"runner_default_options: Illegal value %s=%s\n",
+               RUNNER_CONVERGE_TOLERANCE_VAR, value);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+  value = getenv (RUNNER_TRAJLOG_VAR);
+  if (NULL != value && '\0' != value[0])
+    opts.trajlog = value;
+
+  return opts;
+} // runner_default_options
+
+
+////////////////////////////////////////////////////////////////////////////////
+runner_result *
+runner_run (const environment * p_env, const rl_agent_factory * p_factory,
+            const runner_options * p_opts)
+{
+  unsigned int R = p_opts->replicas;
+  unsigned int L = p_factory->valueLength;
+  unsigned int numThreads = p_opts->threads;
+  unsigned int numLaunched = 0;
+  unsigned int i, r;
+
+  if (0 == R)
+  {
+    fprintf (stderr,"runner_run failed: At least one replica is required\n");
+    exit (EXIT_FAILURE);
+  }
+
+  //----------------------------------------
+  // Allocate results
+
+  runner_result * p_result = runner_malloc (sizeof(runner_result),
+                                            "runner_result");
+
+  p_result->replicas = R;
+  p_result->trials = p_opts->trials;
+  p_result->valueLength = L;
+  p_result->truncated = 0;
+  p_result->timeouts = 0;
+
+  // Allocate at least one entry so empty arrays are valid
+  p_result->values = runner_malloc (sizeof(double) * ((size_t)R*L + 1),
+                                    "values");
+  p_result->mean = runner_malloc (sizeof(double) * (L + 1), "mean");
+  p_result->stddev = runner_malloc (sizeof(double) * (L + 1), "stddev");
+  p_result->completed = runner_malloc (sizeof(unsigned int) * R,
+                                       "completed");
+  p_result->converged = runner_malloc (sizeof(unsigned int) * R,
+                                       "converged");
+  p_result->curves = p_opts->recordCurves ?
+    runner_malloc (sizeof(double) * ((size_t)R*p_opts->trials + 1),
+                   "curves") : NULL;
+
+  //----------------------------------------
+  // Run replicas: the caller works alongside numThreads-1 workers
+
+  if (0 == numThreads)
+  {
+    long online = sysconf (_SC_NPROCESSORS_ONLN);
+    numThreads = (online > 0) ? (unsigned int)online : 1;
+  }
+  if (numThreads > R)
+    numThreads = R;
+
+  runner_job job = { p_env, p_factory, p_opts, p_result, 0 };
+  pthread_t * threads = NULL;
+
+  if (numThreads > 1)
+  {
+    threads = runner_malloc (sizeof(pthread_t) * (numThreads-1), "threads");
+
+    // Threads that cannot be started are not needed for correctness
+    for (i=0 ; i < numThreads-1 ; i++)
+      if (0 == pthread_create (&threads[numLaunched], NULL, worker_main, &job))
+        numLaunched++;
+  }
+
+  worker_main (&job);
+
+  for (i=0 ; i < numLaunched ; i++)
+    pthread_join (threads[i], NULL);
+
+  free (threads);
+
+  //----------------------------------------
+  // Aggregate values over replicas
+
+  for (i=0 ; i < L ; i++)
+  {
+    double sum = 0.0, sumSq = 0.0;
+
+    for (r=0 ; r < R ; r++)
+      sum += p_result->values[(size_t)r*L + i];
+
+    p_result->mean[i] = sum / R;
+
+    for (r=0 ; r < R ; r++)
+    {
+      double d = p_result->values[(size_t)r*L + i] - p_result->mean[i];
+      sumSq += d*d;
+    }
+
+    p_result->stddev[i] = (R > 1) ? sqrt (sumSq / (R-1)) : 0.0;
+  }
+
+  return p_result;
+} // runner_run
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+runner_result_free (runner_result * p_result)
+{
+  free (p_result->values);
+  free (p_result->mean);
+  free (p_result->stddev);
+  free (p_result->curves);
+  free (p_result->completed);
+  free (p_result->converged);
+  free (p_result);
+} // runner_result_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+runner_print_convergence (FILE * stream, const char * program,
+                          const runner_result * p_result)
+{
+  unsigned int r;
+
+  for (r=0 ; r < p_result->replicas ; r++)
+    if (p_result->converged[r] > 0)
+      fprintf (stream, "%s: Replica %u converged at trial %u of %u\n",
+               program, r, p_result->converged[r], p_result->trials);
+} // runner_print_convergence
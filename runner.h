@@ -0,0 +1,201 @@
+/*
+ * File
+ *   runner.h
+ *
+ * Summary
+ *   Run independent replicas of an agent concurrently on one environment
+ *   model. Each replica has its own agent and its own random number stream
+ *   but reads the same MDP and alias tables, which are never modified.
+ *   Results are deterministic: replica r always uses stream r of the seed,
+ *   whatever the number of threads.
+ *
+ *   A replica may also stop early, once a convergence monitor (see
+ *   converge.h) finds its values have settled, and may record the
+ *   experience it is given to a trajectory log (see trajlog.h).
+ *
+ */
+#ifndef __RUNNER_H__
+#define __RUNNER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "environment.h"
+
+/* Environment variables giving the default convergence criterion */
+#define RUNNER_CONVERGE_WINDOW_VAR    "MDP_CONVERGE_WINDOW"
+#define RUNNER_CONVERGE_TOLERANCE_VAR "MDP_CONVERGE_TOLERANCE"
+
+/* Environment variable giving the default trajectory log path */
+#define RUNNER_TRAJLOG_VAR "MDP_TRAJLOG"
+
+typedef struct {
+  void * config;            /* Parameters shared by every replica */
+  unsigned int valueLength; /* Number of values each replica reports */
+  unsigned int valueWidth;  /* Values per state: numActions for Q-values
+                               Q[s*numActions+a] (whose greedy policy is
+                               then monitored too), otherwise 1 */
+  rl_agent (*create) (void * config, const environment * p_env);
+                            /* Create a fresh agent for p_env; called
+                               concurrently, so it must only read config */
+  void (*values) (void * context, double * values);
+                            /* Write an agent's valueLength learned values
+                               (such as utilities or Q-values) */
+  void (*destroy) (void * context); /* Release an agent */
+} rl_agent_factory;
+
+typedef struct {
+  unsigned int replicas;    /* Number of independent agents to run */
+  unsigned int trials;      /* Trials run by each replica */
+  unsigned int threads;     /* Maximum threads to use; 0 for one per
+                               online processor */
+  uint64_t seed;            /* Replica r uses env_seed_stream(seed,r) */
+  bool recordCurves;        /* Whether to keep every trial's total reward */
+  unsigned int convergeWindow; /* Consecutive quiet trials that end a
+                                  replica's run (0 to run every trial) */
+  double convergeTolerance; /* Largest change of a value in a quiet trial */
+  const char * trajlog;     /* Path of the trajectory log each replica's
+                               experience is recorded to (replica r's to
+                               path.r when there are several), or NULL */
+} runner_options;
+
+typedef struct {
+  unsigned int replicas;    /* Number of replicas run */
+  unsigned int trials;      /* Trials run by each replica */
+  unsigned int valueLength; /* Number of values reported by each replica */
+  double * values;          /* A replicas*valueLength array; replica r's
+                               values start at values[r*valueLength] */
+  double * mean;            /* Mean of each value over the replicas */
+  double * stddev;          /* Sample standard deviation of each value over
+                               the replicas (zero for one replica) */
+  double * curves;          /* When recorded, a replicas*trials array of
+                               the total reward of each trial (the learning
+                               curve of replica r starts at
+                               curves[r*trials]); otherwise NULL. Trials
+                               not run (after a timeout or convergence)
+                               are NAN */
+  unsigned int * completed; /* Trials run by each replica */
+  unsigned int * converged; /* Trial at which each replica was found
+                               converged, or 0 */
+  unsigned long long truncated; /* Trials cut off by the environment's limits,
+                                   over all replicas */
+  unsigned long long timeouts;  /* Replicas stopped by the time limit */
+} runner_result;
+
+
+/*  Procedure
+ *    runner_default_options
+ *
+ *  Purpose
+ *    Produce options for one replica on every processor
+ *
+ *  Parameters
+ *    [None.]
+ *
+ *  Produces
+ *    opts, a runner_options
+ *
+ *  Postconditions
+ *    opts.replicas = 1, opts.trials = 0, opts.threads = 0,
+ *    opts.seed = ENVIRONMENT_DEFAULT_SEED, opts.recordCurves = false
+ *    opts.convergeWindow is the value of the environment variable
+ *    RUNNER_CONVERGE_WINDOW_VAR (0 when unset or empty), and
+ *    opts.convergeTolerance that of RUNNER_CONVERGE_TOLERANCE_VAR
+ *    (CONVERGE_DEFAULT_TOLERANCE when unset or empty); an illegal value
+ *    causes program exit.
+ *    opts.trajlog is the value of RUNNER_TRAJLOG_VAR (NULL when unset or
+ *    empty).
+ */
+runner_options
+runner_default_options (void);
+
+
+/*  Procedure
+ *    runner_run
+ *
+ *  Purpose
+ *    Run agent replicas concurrently and aggregate what they learn
+ *
+ *  Parameters
+ *    p_env
+ *    p_factory
+ *    p_opts
+ *
+ *  Produces
+ *    p_result, a runner_result*
+ *
+ *  Preconditions
+ *    p_env was produced by env_create
+ *    p_factory creates agents satisfying the rl_agent contract for p_env
+ *    p_opts->replicas > 0
+ *
+ *  Postconditions
+ *    Each replica r ran p_opts->trials trials on env_share(p_env) seeded
+ *    with env_seed_stream(p_opts->seed,r), and its values were recorded
+ *    before the agent was destroyed. p_env is unchanged.
+ *    When p_opts->convergeWindow > 0, replica r's values were shown to a
+ *    converge_monitor (with p_factory->valueWidth and p_opts's tolerance
+ *    and window) after each trial, and its run ended at the trial
+ *    p_result->converged[r] at which they were judged converged.
+ *    When p_opts->trajlog is not NULL, every step given to replica r's
+ *    agent was recorded with trajlog_agent to p_opts->trajlog (when
+ *    p_opts->replicas = 1) or to p_opts->trajlog suffixed with ".r";
+ *    a log that cannot be created causes program exit.
+ *    When at most one thread is available, replicas run in the caller.
+ *    p_result must be released with runner_result_free.
+ *    Any failure causes program exit.
+ */
+runner_result *
+runner_run (const environment * p_env, const rl_agent_factory * p_factory,
+            const runner_options * p_opts);
+
+
+/*  Procedure
+ *    runner_result_free
+ *
+ *  Purpose
+ *    Release the results of runner_run
+ *
+ *  Parameters
+ *    p_result
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_result was produced by runner_run
+ *
+ *  Postconditions
+ *    All memory for p_result is freed
+ */
+void
+runner_result_free (runner_result * p_result);
+
+
+/*  Procedure
+ *    runner_print_convergence
+ *
+ *  Purpose
+ *    Report the replicas that stopped early by converging
+ *
+ *  Parameters
+ *    stream
+ *    program
+ *    p_result
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_result was produced by runner_run
+ *
+ *  Postconditions
+ *    A line naming program, the replica and the trial at which it
+ *    converged was written to stream for each replica that converged.
+ */
+void
+runner_print_convergence (FILE * stream, const char * program,
+                          const runner_result * p_result);
+
+#endif // __RUNNER_H__
@@ -6,169 +6,40 @@
 
 #include "mdp.h"
 #include "environment.h"
-
-// Persistent  variables
-mdp *         p_mdp;      /* MDP to operate on/in */
-double        gamma;      /* Discount factor to use */
-unsigned int* policy;     /* Policy: array of actions for each state */
-double *      utilities;  /* Array of utilities */
-double *      state_freq; /* Counts of state frequencies */
-unsigned int  prevState;  /* Previous state encountered */
-unsigned int  prevAction; /* Previous action taken */
-double        prevReward; /* Previous reward received */
-bool          prevValid = false;  /* A state variable indicating whether the
-                                     previous state-action pair is valid
-                                     (i.e., not restarting after terminal
-                                     state */
-
+#include "runner.h"
+#include "td_agent.h"
 
 /* Process command-line arguments, verifying usage */
 void
-process_args (int argc, char * argv[], double * gamma, unsigned int * trials );
-  
-/* td_initialize - Establish values of persistent variables for the environment
- *
- * Produces:
- *   [Nothing. Called for side effect.]
- *
- * Preconditions: 
- *   p_mdp_in points to a valid mdp structure 
- *   0 < gamma_in < 1
- *
- * Postconditions:
- *   The following assignments are made to the persistent variables:
- *     p_mdp = p_mdp_in
- *     gamma = gamma_in
- *     prevValid = 0
- *   The following persistent variables point to valid, allocated arrays
- *     policy[numStates] 
- *     utilities[numStates]
- *     state_freq[numStates], all entries initialized to zero
- *
- * Progenitor
- *   Jerod Weinman
- */
-void
-td_initialize ( mdp * p_mdp_in, double gamma_in )
-{
-  p_mdp = p_mdp_in;   // Assign MDP object
-  gamma = gamma_in; // Set other constants
-
-  // Allocate policy
-  policy = malloc ( sizeof(unsigned int) * p_mdp->numStates );
-
-  if (NULL == policy)
-  {
-    fprintf (stderr, "td_initialize: Unable to allocate policy (%s)",
-             strerror (errno));
-    exit (EXIT_FAILURE);
-  }
-  
-  // Allocate utilities (zeroed by calloc)
-  utilities = calloc ( p_mdp->numStates, sizeof(double) );
-  
-  if (NULL == utilities)
-  {
-    fprintf (stderr, "td_initialize: Unable to allocate utilities (%s)",
-	    strerror (errno));
-    exit (EXIT_FAILURE);
-  }
-
-  // Allocate visitation history (zeroed by calloc)
-  state_freq = calloc ( p_mdp->numStates, sizeof(double) );
-
-  if (NULL == state_freq)
-  {
-    fprintf (stderr, "td_initialize: Unable to allocate state_freq  (%s)",
-             strerror (errno));
-    exit (EXIT_FAILURE);
-  }
+process_args (int argc, char * argv[], double * gamma, unsigned int * trials,
+              unsigned int * replicas, double * lambda );
   
-  // Indicate no previous state
-  prevValid = false;
-} // td_initialize
-
-
-/* td_cleanup - Release values of persistent variables for the environment
- *
- * Produces:
- *   [Nothing. Called for side effect.]
- *
- * Preconditions: 
- *   p_mdp points to a valid mdp structure 
- *
- * Postconditions:
- *   The following persistent (global) pointer variables are freed
- *     policy
- *     utilities
- *     state_freq
- *   p_mdp has been freed via procedure mdp_free
- *
- * Progenitor
- *   Jerod Weinman
- */
-void
-td_cleanup ( mdp * p_mdp )
-{
-  free(policy);
-  free(utilities);
-  free(state_freq);
-  mdp_free(p_mdp);
-} // td_cleanup
-
-/* updateWeight - "Learning rate" multiplier
- *
- * Produces:
- *   alpha, a double
- *
- * Preconditions: 
- *   freq > 0
+/*
+ * Usage: td gamma mdpfile trials [replicas [lambda]] < policy
  *
- * Postconditions:
- *   alpha = O(1/freq)
+ * Runs Passive-TD-Agent in an environment for the given number of trials
+ * on a fixed policy read from standard input.
  *
- *   The equation for alpha is taken from Russel & Norvig, Artificial
- *   Intelligence (2010), p. 837.
+ * With lambda (default 0), the agent learns by TD(lambda), updating every
+ * state of the episode whose eligibility trace has not yet decayed below
+ * TRACE_DEFAULT_CUTOFF after each step.
  *
- * Progenitor
- *   Jerod Weinman
+ * With replicas, that many independent agents (each with its own random
+ * number stream) run concurrently, one per processor, and the utilities
+ * printed are their means. One replica is the same as a single agent.
  *
- */
-double
-updateWeight (double freq)
-{
-  return 60.0/(59.0 + freq);
-} // updateWeight
-
-
-/* rl_agent_action - 
- *   receive reward for a prior action; indicate action to take in given state
- * 
- * Produces
- *   action, an unsigned int
+ * Trials are capped at MDP_MAX_EPISODE_STEPS steps and each replica's run
+ * at MDP_RUN_SECONDS seconds when those are set; a warning reports any
+ * trials cut short.
  *
- * Preconditions
- *   td_initialize has run successfully
- *   0 <= state < p_mdp->numStates
+ * When MDP_CONVERGE_WINDOW is set, a replica stops once that many
+ * consecutive trials have changed no utility by more than
+ * MDP_CONVERGE_TOLERANCE (default CONVERGE_DEFAULT_TOLERANCE); the trial
+ * at which each replica converged is reported.
  *
- * Postconditions
- *   action = policy[state]
- *   utilities is updated according to the TD learning rule
- *
- * Progenitor
- *   Jerod Weinman
- */
-unsigned int
-rl_agent_action(unsigned int state, double reward)
-{
-  return policy[state]; // Return the policy action for the state
-} // rl_agent_action
-
-/*
- * Usage: td gamma mdpfile trials < policy
- *
- * Runs Passive-TD-Agent in an environment for the given number of trials
- * on a fixed policy read from standard input.
+ * When MDP_TRAJLOG is set, each replica's experience is recorded to that
+ * trajectory log (suffixed with the replica number when there are
+ * several), which trajplay can replay.
  *
  * Jerod Weinman
  */
@@ -176,42 +47,68 @@ int
 main (int argc, char* argv[])
 {
   // Read and process configurations
-  double gamma;
-  unsigned int trials;
+  double gamma, lambda;
+  unsigned int trials, replicas;
 
-  process_args (argc, argv, &gamma, &trials);
+  process_args (argc, argv, &gamma, &trials, &replicas, &lambda);
 
   // Initialize environment
-  environment_setup(argv[2]);
-
-  // Initialize agent
-  td_initialize (environment_get_mdp(), gamma );
+  environment * p_env = env_create (argv[2]);
+  mdp * p_mdp = env_get_structure (p_env);
 
   // Read policy from stdin
+  unsigned int * policy = malloc ( sizeof(unsigned int) * p_mdp->numStates );
+
+  if (NULL == policy)
+  {
+    fprintf (stderr, "%s: Unable to allocate policy (%s)\n", argv[0],
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
   mdp_read_policy (stdin, p_mdp, policy);
   
-  // Run Passive-TD-Agent!
-  environment_run (trials);
+  // Run Passive-TD-Agent replicas!
+  td_agent_config config = { gamma, policy, lambda };
+  rl_agent_factory factory = td_agent_factory (&config, p_env);
+  runner_options opts = runner_default_options ();
+
+  opts.replicas = replicas;
+  opts.trials = trials;
+
+  runner_result * p_result = runner_run (p_env, &factory, &opts);
+
+  if (p_result->truncated > 0 || p_result->timeouts > 0)
+    fprintf (stderr, "%s: Warning: %llu trials truncated and %llu replicas "
+             "stopped by limits\n", argv[0], p_result->truncated,
+             p_result->timeouts);
+
+  runner_print_convergence (stderr, argv[0], p_result);
 
   // Print utilities
   unsigned int state;
   for ( state=0 ; state < p_mdp->numStates ; state++)
     if (p_mdp->numAvailableActions[state] > 0 || p_mdp->terminal[state] )
-      printf ("%1.3f\n", utilities[state]);
+      printf ("%1.3f\n", p_result->mean[state]);
     else
       printf("X\n");
 
-  td_cleanup (p_mdp);
+  runner_result_free (p_result);
+  free (policy);
+  mdp_free (p_mdp);
+  env_free (p_env);
 } // main
 
 
 /* Process command-line arguments, verifying usage */
 void
-process_args (int argc, char * argv[], double * gamma, unsigned int * trials )
+process_args (int argc, char * argv[], double * gamma, unsigned int * trials,
+              unsigned int * replicas, double * lambda )
 {
-  if (argc != 4)
+  if (argc < 4 || argc > 6)
   {
-    fprintf (stderr,"Usage: %s gamma mdpfile trials\n",argv[0]);
+    fprintf (stderr,"Usage: %s gamma mdpfile trials [replicas [lambda]]\n",
+             argv[0]);
     exit (EXIT_FAILURE);
   }
   
@@ -237,4 +134,36 @@ process_args (int argc, char * argv[], double * gamma, unsigned int * trials )
     exit (EXIT_FAILURE);
   }
 
+  // Read replicas, number of independent agents, as an unsigned integer
+  *replicas = 1;
+
+  if (argc >= 5)
+  {
+    *replicas = (unsigned int)strtol (argv[4], &endptr,10);
+
+    if ( (endptr - argv[4])/sizeof(char) < strlen (argv[4]) ||
+         0 == *replicas )
+    {
+      fprintf (stderr, "%s: Illegal value in argument replicas=%s\n",
+               argv[0], argv[4]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+  // Read lambda, the trace decay, as a double
+  *lambda = 0;
+
+  if (6 == argc)
+  {
+    *lambda = strtod (argv[5], &endptr);
+
+    if ( (endptr - argv[5])/sizeof(char) < strlen (argv[5]) ||
+         *lambda < 0 || *lambda > 1 )
+    {
+      fprintf (stderr, "%s: Illegal value in argument lambda=%s\n",
+               argv[0], argv[5]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
 } // process_args
@@ -0,0 +1,328 @@
+/*
+ * File
+ *   td_agent.c
+ *
+ * Summary
+ *   Passive temporal-difference agent instances.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "mdp.h"
+#include "environment.h"
+#include "runner.h"
+#include "trace.h"
+#include "td_agent.h"
+
+
+/*
+ * Procedure
+ *   updateWeight
+ *
+ * Purpose
+ *   Give an adjustment factor based on state frequency
+ *
+ * Parameters
+ *   freq
+ *
+ * Produces
+ *   alpha, a double
+ *
+ * Postconditions
+ *   alpha = O(1/freq)
+ *
+ *   The equation for alpha is taken from Russel & Norvig, Artificial
+ *   Intelligence (2010), p. 837.
+ */
+static double updateWeight(double freq)
+{
+  return 60.0/(59.0 + freq);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+td_agent *
+td_agent_create (mdp * p_mdp, double gamma, double lambda)
+{
+  td_agent * p_agent = malloc (sizeof(td_agent));
+
+  if (NULL == p_agent)
+  {
+    fprintf (stderr, "td_agent_create: Unable to allocate agent (%s)",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  p_agent->p_mdp = p_mdp;   // Assign MDP object
+  p_agent->gamma = gamma; // Set other constants
+  p_agent->lambda = lambda;
+
+  // Allocate policy
+  p_agent->policy = malloc ( sizeof(unsigned int) * p_mdp->numStates );
+
+  if (NULL == p_agent->policy)
+  {
+    fprintf (stderr, "td_agent_create: Unable to allocate policy (%s)",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  // Allocate utilities (zeroed by calloc)
+  p_agent->utilities = calloc ( p_mdp->numStates, sizeof(double) );
+
+  if (NULL == p_agent->utilities)
+  {
+    fprintf (stderr, "td_agent_create: Unable to allocate utilities (%s)",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  // Allocate visitation history (zeroed by calloc)
+  p_agent->stateFreq = calloc ( p_mdp->numStates, sizeof(double) );
+
+  if (NULL == p_agent->stateFreq)
+  {
+    fprintf (stderr, "td_agent_create: Unable to allocate stateFreq (%s)",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  // Traces are kept only for the states of the current episode
+  p_agent->p_trace = trace_create (p_mdp->numStates, TRACE_DEFAULT_CUTOFF);
+
+  // Indicate no previous state
+  p_agent->prevValid = false;
+
+  return p_agent;
+} // td_agent_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+td_agent_free (td_agent * p_agent)
+{
+  free (p_agent->policy);
+  free (p_agent->utilities);
+  free (p_agent->stateFreq);
+  trace_free (p_agent->p_trace);
+  mdp_free (p_agent->p_mdp);
+  free (p_agent);
+} // td_agent_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int
+td_agent_action (void * context, unsigned int state, double reward)
+{
+  td_agent * p_agent = context;
+  const mdp * p_mdp = p_agent->p_mdp;
+  trace_list * p_trace = p_agent->p_trace;
+  double * U = p_agent->utilities;
+  double * N = p_agent->stateFreq;
+
+  // A state never left is estimated by its reward alone
+  if (0 == N[state])
+    U[state] = reward;
+
+  if (p_agent->prevValid) {
+    unsigned int prev = p_agent->prevState;
+    double delta = p_agent->prevReward + p_agent->gamma*U[state] - U[prev];
+    unsigned int i;
+
+    N[prev]++;
+    trace_visit (p_trace, prev);
+
+    // Every state still eligible shares in the difference
+    for (i=0 ; i < p_trace->size ; i++) {
+      unsigned int s = p_trace->keys[i];
+
+      U[s] += updateWeight(N[s]) * delta * p_trace->values[i];
+    }
+
+    trace_decay (p_trace, p_agent->gamma * p_agent->lambda);
+  }
+
+  if (MDP_IS_TERMINAL(p_mdp, state)) {
+    p_agent->prevValid = false;
+    trace_clear (p_trace);
+  } else {
+    p_agent->prevState = state;
+    p_agent->prevAction = p_agent->policy[state];
+    p_agent->prevReward = reward;
+    p_agent->prevValid = true;
+  }
+
+  return p_agent->policy[state]; // Return the policy action for the state
+} // td_agent_action
+
+
+/*  Procedure
+ *    td_agent_truncate
+ *
+ *  Purpose
+ *    Forget the previous state when a trial is cut short, since it has no
+ *    successor
+ */
+static void
+td_agent_truncate (void * context)
+{
+  td_agent * p_agent = context;
+
+  p_agent->prevValid = false;
+  trace_clear (p_agent->p_trace);
+} // td_agent_truncate
+
+
+////////////////////////////////////////////////////////////////////////////////
+rl_agent
+td_agent_interface (td_agent * p_agent)
+{
+  rl_agent agent = { p_agent, td_agent_action, td_agent_truncate };
+
+  return agent;
+} // td_agent_interface
+
+
+/*  Procedure
+ *    factory_create
+ *
+ *  Purpose
+ *    Create a replica from a td_agent_config
+ */
+static rl_agent
+factory_create (void * config, const environment * p_env)
+{
+  const td_agent_config * p_config = config;
+  td_agent * p_agent = td_agent_create (env_get_structure (p_env),
+                                        p_config->gamma, p_config->lambda);
+
+  memcpy (p_agent->policy, p_config->policy,
+          sizeof(unsigned int) * p_agent->p_mdp->numStates);
+
+  return td_agent_interface (p_agent);
+} // factory_create
+
+
+/*  Procedure
+ *    factory_values
+ *
+ *  Purpose
+ *    Report a replica's utilities
+ */
+static void
+factory_values (void * context, double * values)
+{
+  const td_agent * p_agent = context;
+
+  memcpy (values, p_agent->utilities,
+          sizeof(double) * p_agent->p_mdp->numStates);
+} // factory_values
+
+
+/*  Procedure
+ *    factory_destroy
+ *
+ *  Purpose
+ *    Release a replica
+ */
+static void
+factory_destroy (void * context)
+{
+  td_agent_free (context);
+} // factory_destroy
+
+
+////////////////////////////////////////////////////////////////////////////////
+rl_agent_factory
+td_agent_factory (td_agent_config * p_config, const environment * p_env)
+{
+  rl_agent_factory factory;
+
+  factory.config = p_config;
+  factory.valueLength = p_env->p_mdp->numStates;
+  factory.valueWidth = 1;
+  factory.create = factory_create;
+  factory.values = factory_values;
+  factory.destroy = factory_destroy;
+
+  return factory;
+} // td_agent_factory
+
+
+////////////////////////////////////////////////////////////////////////////////
+td_batch *
+td_batch_create (td_agent * p_agent, unsigned int lanes)
+{
+  td_batch * p_batch = malloc (sizeof(td_batch));
+
+  if (NULL == p_batch)
+  {
+    fprintf (stderr, "td_batch_create: Unable to allocate batch (%s)",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  p_batch->p_agent = p_agent;
+  p_batch->lanes = lanes;
+  p_batch->prevState = malloc (sizeof(unsigned int) * lanes);
+  p_batch->prevReward = malloc (sizeof(double) * lanes);
+
+  if (NULL == p_batch->prevState || NULL == p_batch->prevReward)
+  {
+    fprintf (stderr, "td_batch_create: Unable to allocate lanes (%s)",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+
+  return p_batch;
+} // td_batch_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+td_batch_free (td_batch * p_batch)
+{
+  free (p_batch->prevState);
+  free (p_batch->prevReward);
+  free (p_batch);
+} // td_batch_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+td_batch_action (void * context, unsigned int count,
+                 const unsigned int * states, const double * rewards,
+                 const unsigned int * lengths, unsigned int * actions)
+{
+  td_batch * p_batch = context;
+  td_agent * p_agent = p_batch->p_agent;
+  const unsigned int * policy = p_agent->policy;
+  double * U = p_agent->utilities;
+  double * N = p_agent->stateFreq;
+  double gamma = p_agent->gamma;
+  unsigned int i;
+
+  for (i=0 ; i < count ; i++) {
+    unsigned int state = states[i];
+
+    // A state never left is estimated by its reward alone
+    if (0 == N[state])
+      U[state] = rewards[i];
+
+    // A lane of zero length has just started, with no previous state
+    if (lengths[i] > 0) {
+      unsigned int prev = p_batch->prevState[i];
+
+      N[prev]++;
+      U[prev] += updateWeight(N[prev]) *
+        (p_batch->prevReward[i] + gamma*U[state] - U[prev]);
+    }
+
+    p_batch->prevState[i] = state;
+    p_batch->prevReward[i] = rewards[i];
+    actions[i] = policy[state];
+  }
+} // td_batch_action
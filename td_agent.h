@@ -0,0 +1,272 @@
+/*
+ * File
+ *   td_agent.h
+ *
+ * Summary
+ *   A passive temporal-difference agent (Passive-TD-Agent of Russell &
+ *   Norvig, Artificial Intelligence, 2010, p. 837) following a fixed
+ *   policy. Each agent owns its state, so several may run at once.
+ *
+ *   With lambda > 0 the agent learns by TD(lambda): each temporal
+ *   difference also adjusts the states visited earlier in the episode,
+ *   in proportion to their eligibility traces (see trace.h), so credit
+ *   travels back along a corridor in one episode rather than one state
+ *   per episode. lambda = 0 is the one-step agent of R&N.
+ *
+ */
+#ifndef __TD_AGENT_H__
+#define __TD_AGENT_H__
+
+#include <stdbool.h>
+
+#include "mdp.h"
+#include "environment.h"
+#include "runner.h"
+#include "trace.h"
+
+typedef struct {
+  mdp *         p_mdp;      /* MDP to operate on/in */
+  double        gamma;      /* Discount factor to use */
+  double        lambda;     /* Trace decay: 0 for one-step updates */
+  unsigned int* policy;     /* Policy: array of actions for each state */
+  double *      utilities;  /* Array of utilities */
+  double *      stateFreq;  /* Counts of state frequencies */
+  unsigned int  prevState;  /* Previous state encountered */
+  unsigned int  prevAction; /* Previous action taken */
+  double        prevReward; /* Previous reward received */
+  bool          prevValid;  /* Whether the previous state-action pair is
+                               valid (i.e., not restarting after terminal
+                               state) */
+  trace_list *  p_trace;    /* Eligibility of the states of this episode */
+} td_agent;
+
+typedef struct {
+  double gamma;                 /* Discount factor to use */
+  const unsigned int * policy;  /* Policy followed by every agent */
+  double lambda;                /* Trace decay (0 for TD(0)) */
+} td_agent_config;
+
+typedef struct {
+  td_agent *     p_agent;    /* Agent whose utilities every lane updates */
+  unsigned int   lanes;      /* Number of lanes of the batch */
+  unsigned int * prevState;  /* Previous state of each lane */
+  double *       prevReward; /* Previous reward of each lane */
+} td_batch;
+
+
+/*  Procedure
+ *    td_agent_create
+ *
+ *  Purpose
+ *    Create a passive TD agent using partial MDP information
+ *
+ *  Parameters
+ *    p_mdp
+ *    gamma
+ *    lambda
+ *
+ *  Produces
+ *    p_agent, a td_agent*
+ *
+ *  Preconditions
+ *    p_mdp points to a valid MDP struct (as from env_get_structure, so
+ *    its transitionProb may be NULL); the agent takes ownership of it
+ *    0 < gamma < 1
+ *    0 <= lambda <= 1
+ *
+ *  Postconditions
+ *    p_agent->policy is an allocated numStates array, to be filled in by
+ *    the caller before running the agent.
+ *    p_agent->utilities and p_agent->stateFreq are zeroed numStates arrays.
+ *    p_agent must be released with td_agent_free.
+ *    Any failure causes program exit.
+ */
+td_agent *
+td_agent_create (mdp * p_mdp, double gamma, double lambda);
+
+
+/*  Procedure
+ *    td_agent_free
+ *
+ *  Purpose
+ *    Release a passive TD agent and its MDP
+ *
+ *  Parameters
+ *    p_agent
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_agent was produced by td_agent_create
+ *
+ *  Postconditions
+ *    All memory for p_agent is freed
+ */
+void
+td_agent_free (td_agent * p_agent);
+
+
+/*  Procedure
+ *    td_agent_action
+ *
+ *  Purpose
+ *    Receive reward for a prior action; indicate action to take in given
+ *    state
+ *
+ *  Parameters
+ *    context
+ *    state
+ *    reward
+ *
+ *  Produces
+ *    action, an unsigned int
+ *
+ *  Preconditions
+ *    context is a td_agent* produced by td_agent_create whose policy
+ *    has been filled in
+ *    0 <= state < numStates
+ *
+ *  Postconditions
+ *    U[state] = reward if state was never left before.
+ *    The temporal difference d = prevReward + gamma U[state] - U[prevState]
+ *    has been added to U[s], weighted by the learning rate for the visits
+ *    of s and by the trace of s, for every s with an active trace;
+ *    prevState's trace was first set to 1, and all were then decayed by
+ *    gamma*lambda (dropping those below TRACE_DEFAULT_CUTOFF).
+ *    Traces are cleared at terminal states.
+ *    action = policy[state]
+ */
+unsigned int
+td_agent_action (void * context, unsigned int state, double reward);
+
+
+/*  Procedure
+ *    td_agent_interface
+ *
+ *  Purpose
+ *    Wrap a passive TD agent for use with env_run
+ *
+ *  Parameters
+ *    p_agent
+ *
+ *  Produces
+ *    agent, an rl_agent
+ */
+rl_agent
+td_agent_interface (td_agent * p_agent);
+
+
+/*  Procedure
+ *    td_agent_factory
+ *
+ *  Purpose
+ *    Describe how to create passive TD agent replicas for runner_run
+ *
+ *  Parameters
+ *    p_config
+ *    p_env
+ *
+ *  Produces
+ *    factory, an rl_agent_factory
+ *
+ *  Preconditions
+ *    p_config and p_config->policy outlive any use of factory;
+ *    p_config->policy is a numStates length array of valid actions
+ *    p_env was produced by env_create
+ *
+ *  Postconditions
+ *    Each agent created by factory is td_agent_create applied to
+ *    env_get_structure of its environment, p_config->gamma and
+ *    p_config->lambda, with a copy of p_config->policy. Its values are the
+ *    utilities U[s].
+ */
+rl_agent_factory
+td_agent_factory (td_agent_config * p_config, const environment * p_env);
+
+
+/*  Procedure
+ *    td_batch_create
+ *
+ *  Purpose
+ *    Let a passive TD agent learn from a batch of episodes at once (see
+ *    envbatch.h)
+ *
+ *  Parameters
+ *    p_agent
+ *    lanes
+ *
+ *  Produces
+ *    p_batch, a td_batch*
+ *
+ *  Preconditions
+ *    p_agent was produced by td_agent_create, its policy filled in, and
+ *    outlives p_batch
+ *    lanes > 0
+ *
+ *  Postconditions
+ *    p_batch must be released with td_batch_free, which leaves p_agent.
+ *    Any failure causes program exit.
+ */
+td_batch *
+td_batch_create (td_agent * p_agent, unsigned int lanes);
+
+
+/*  Procedure
+ *    td_batch_free
+ *
+ *  Purpose
+ *    Release a batch created by td_batch_create, but not its agent
+ *
+ *  Parameters
+ *    p_batch
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_batch was produced by td_batch_create
+ *
+ *  Postconditions
+ *    All memory for p_batch is freed
+ */
+void
+td_batch_free (td_batch * p_batch);
+
+
+/*  Procedure
+ *    td_batch_action
+ *
+ *  Purpose
+ *    Receive rewards for every lane's prior action; indicate the actions
+ *    to take in their states (an rl_batch_agent)
+ *
+ *  Parameters
+ *    context
+ *    count
+ *    states
+ *    rewards
+ *    lengths
+ *    actions
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    context is a td_batch* with at least count lanes
+ *    The arguments satisfy the rl_batch_agent contract
+ *
+ *  Postconditions
+ *    Lanes are taken in order, each as td_agent_action with lambda = 0
+ *    would take a step of its own episode: U[state] = reward for a state
+ *    never left, and the lane's previous state (when lengths[i] > 0) was
+ *    updated toward its reward plus gamma*U[state]. Traces are not kept,
+ *    whatever the agent's lambda.
+ *    actions[i] = policy[states[i]]
+ */
+void
+td_batch_action (void * context, unsigned int count,
+                 const unsigned int * states, const double * rewards,
+                 const unsigned int * lengths, unsigned int * actions);
+
+#endif // __TD_AGENT_H__
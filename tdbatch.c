@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "mdp.h"
+#include "environment.h"
+#include "envbatch.h"
+#include "td_agent.h"
+
+/* Lanes simulated together unless given */
+#define TDBATCH_DEFAULT_LANES 256
+
+/* Process command-line arguments, verifying usage */
+void
+process_args (int argc, char * argv[], double * gamma,
+              unsigned long long * episodes, unsigned int * lanes);
+
+
+/*
+ * Usage: tdbatch gamma mdpfile episodes [lanes] < policy
+ *
+ * Runs Passive-TD-Agent (with one-step updates) on a fixed policy read
+ * from standard input in a batched environment (see envbatch.h): lanes
+ * episodes (default TDBATCH_DEFAULT_LANES) are simulated in lockstep, and
+ * the agent is given every lane's state at once, until the given number
+ * of episodes has ended. The utilities are printed as td prints them, and
+ * the simulation rate is reported on standard error.
+ *
+ * Episodes are capped at MDP_MAX_EPISODE_STEPS steps (counting toward
+ * the episodes requested) and the run at MDP_RUN_SECONDS seconds when
+ * those are set.
+ */
+int
+main (int argc, char* argv[])
+{
+  // Read and process configurations
+  double gamma;
+  unsigned long long episodes;
+  unsigned int lanes;
+
+  process_args (argc, argv, &gamma, &episodes, &lanes);
+
+  // Initialize environment
+  environment * p_env = env_create (argv[2]);
+
+  // Initialize agent, reading its policy from stdin
+  td_agent * p_agent = td_agent_create (env_get_structure (p_env), gamma, 0);
+  mdp * p_mdp = p_agent->p_mdp;
+
+  mdp_read_policy (stdin, p_mdp, p_agent->policy);
+
+  // Run it on every lane!
+  environment_batch * p_batch =
+    environment_batch_create (p_env, lanes, ENVIRONMENT_DEFAULT_SEED);
+  td_batch * p_lanes = td_batch_create (p_agent, lanes);
+  struct timespec begin, end;
+
+  clock_gettime (CLOCK_MONOTONIC, &begin);
+  environment_batch_run (p_batch, td_batch_action, p_lanes, episodes);
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  double seconds = (end.tv_sec - begin.tv_sec) +
+    1e-9 * (end.tv_nsec - begin.tv_nsec);
+
+  fprintf (stderr, "%s: %llu episodes (%llu truncated) and %llu steps in "
+           "%.3f s (%.0f steps/s)\n", argv[0],
+           p_batch->episodes + p_batch->truncated, p_batch->truncated,
+           p_batch->steps, seconds,
+           (seconds > 0) ? p_batch->steps / seconds : 0.0);
+
+  // Print utilities
+  unsigned int state;
+  for ( state=0 ; state < p_mdp->numStates ; state++)
+    if (p_mdp->numAvailableActions[state] > 0 || p_mdp->terminal[state] )
+      printf ("%1.3f\n", p_agent->utilities[state]);
+    else
+      printf("X\n");
+
+  td_batch_free (p_lanes);
+  environment_batch_free (p_batch);
+  td_agent_free (p_agent);
+  env_free (p_env);
+
+  return 0;
+} // main
+
+
+/* Process command-line arguments, verifying usage */
+void
+process_args (int argc, char * argv[], double * gamma,
+              unsigned long long * episodes, unsigned int * lanes)
+{
+  if (argc < 4 || argc > 5)
+  {
+    fprintf (stderr,"Usage: %s gamma mdpfile episodes [lanes] < policy\n",
+             argv[0]);
+    exit (EXIT_FAILURE);
+  }
+
+  char * endptr; // String End Location for number parsing
+
+  // Read gamma, the discount factor, as a double
+  *gamma = strtod (argv[1], &endptr);
+
+  if ( (endptr - argv[1])/sizeof(char) < strlen (argv[1]) )
+  {
+    fprintf (stderr, "%s: Illegal non-numeric value in argument gamma=%s\n",
+             argv[0], argv[1]);
+    exit (EXIT_FAILURE);
+  }
+
+  // Read episodes, number to run, as an unsigned integer
+  *episodes = strtoull (argv[3], &endptr, 10);
+
+  if ( (endptr - argv[3])/sizeof(char) < strlen (argv[3]) )
+  {
+    fprintf (stderr, "%s: Illegal non-numeric value in argument episodes=%s\n",
+             argv[0], argv[3]);
+    exit (EXIT_FAILURE);
+  }
+
+  // Read lanes, number of concurrent episodes, as an unsigned integer
+  *lanes = TDBATCH_DEFAULT_LANES;
+
+  if (5 == argc)
+  {
+    *lanes = (unsigned int)strtol (argv[4], &endptr, 10);
+
+    if ( (endptr - argv[4])/sizeof(char) < strlen (argv[4]) || 0 == *lanes )
+    {
+      fprintf (stderr, "%s: Illegal value in argument lanes=%s\n",
+               argv[0], argv[4]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+} // process_args
@@ -0,0 +1,149 @@
+/*
+ * File
+ *   trace.c
+ *
+ * Summary
+ *   Sparse eligibility trace lists.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+
+#include "trace.h"
+
+
+/*  Procedure
+ *    trace_malloc
+ *
+ *  Purpose
+ *    Allocate memory or exit with a message naming what was requested
+ */
+static void *
+trace_malloc (size_t bytes, const char * what)
+{
+  void * ptr = malloc (bytes);
+
+  if (NULL == ptr)
+  {
+    fprintf (stderr,"trace_create failed: Could not allocate %s (%s)\n",
+             what, strerror (errno));
+    exit (EXIT_FAILURE);
+  }
+  return ptr;
+} // trace_malloc
+
+
+/*  Procedure
+ *    trace_remove
+ *
+ *  Purpose
+ *    Deactivate the trace at a position, moving the last one into its
+ *    place
+ */
+static void
+trace_remove (trace_list * p_trace, unsigned int i)
+{
+  unsigned int last = --p_trace->size;
+
+  p_trace->where[p_trace->keys[i]] = TRACE_NONE;
+
+  if (i != last)
+  {
+    p_trace->keys[i] = p_trace->keys[last];
+    p_trace->values[i] = p_trace->values[last];
+    p_trace->where[p_trace->keys[i]] = i;
+  }
+} // trace_remove
+
+
+////////////////////////////////////////////////////////////////////////////////
+trace_list *
+trace_create (unsigned int numKeys, double cutoff)
+{
+  trace_list * p_trace = trace_malloc (sizeof(trace_list), "trace_list");
+  unsigned int key;
+
+  p_trace->numKeys = numKeys;
+  p_trace->size = 0;
+  p_trace->cutoff = cutoff;
+  p_trace->keys = trace_malloc (sizeof(unsigned int) * numKeys, "keys");
+  p_trace->values = trace_malloc (sizeof(double) * numKeys, "values");
+  p_trace->where = trace_malloc (sizeof(unsigned int) * numKeys, "index");
+
+  // Only here is every key touched; afterward only active ones are
+  for (key=0 ; key < numKeys ; key++)
+    p_trace->where[key] = TRACE_NONE;
+
+  return p_trace;
+} // trace_create
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+trace_free (trace_list * p_trace)
+{
+  free (p_trace->keys);
+  free (p_trace->values);
+  free (p_trace->where);
+  free (p_trace);
+} // trace_free
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+trace_clear (trace_list * p_trace)
+{
+  unsigned int i;
+
+  for (i=0 ; i < p_trace->size ; i++)
+    p_trace->where[p_trace->keys[i]] = TRACE_NONE;
+
+  p_trace->size = 0;
+} // trace_clear
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+trace_visit (trace_list * p_trace, unsigned int key)
+{
+  unsigned int i = p_trace->where[key];
+
+  if (TRACE_NONE == i)
+  {
+    i = p_trace->size++;
+    p_trace->keys[i] = key;
+    p_trace->where[key] = i;
+  }
+
+  p_trace->values[i] = 1.0;
+} // trace_visit
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+trace_drop (trace_list * p_trace, unsigned int key)
+{
+  if (TRACE_NONE != p_trace->where[key])
+    trace_remove (p_trace, p_trace->where[key]);
+} // trace_drop
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+trace_decay (trace_list * p_trace, double factor)
+{
+  unsigned int i = 0;
+
+  // A removal brings an unvisited trace to position i, so i stays put
+  while (i < p_trace->size)
+  {
+    p_trace->values[i] *= factor;
+
+    if (p_trace->values[i] < p_trace->cutoff)
+      trace_remove (p_trace, i);
+    else
+      i++;
+  }
+} // trace_decay
@@ -0,0 +1,177 @@
+/*
+ * File
+ *   trace.h
+ *
+ * Summary
+ *   Sparse eligibility traces for TD(lambda) and Q(lambda) (Sutton &
+ *   Barto, Reinforcement Learning, 2018, ch. 12). Only the keys (states,
+ *   or state-action pairs) whose traces are at least a cutoff are kept,
+ *   in a list with a position index, so visiting, decaying, and clearing
+ *   cost time proportional to the active traces rather than to all keys.
+ *   Traces are replacing: a visit sets a key's trace to 1.
+ *
+ */
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <limits.h>
+
+/* Position of a key with no active trace */
+#define TRACE_NONE UINT_MAX
+
+/* Smallest trace kept unless configured otherwise */
+#define TRACE_DEFAULT_CUTOFF 1e-3
+
+typedef struct {
+  unsigned int   numKeys; /* Keys that may be traced: 0 <= key < numKeys */
+  unsigned int   size;    /* Active traces */
+  unsigned int * keys;    /* Keys of the active traces */
+  double *       values;  /* Traces of the active keys, parallel to keys */
+  unsigned int * where;   /* Position of each key in keys, or TRACE_NONE */
+  double         cutoff;  /* Traces decayed below this are dropped */
+} trace_list;
+
+
+/*  Procedure
+ *    trace_create
+ *
+ *  Purpose
+ *    Allocate an empty trace list
+ *
+ *  Parameters
+ *    numKeys
+ *    cutoff
+ *
+ *  Produces
+ *    p_trace, a trace_list*
+ *
+ *  Preconditions
+ *    numKeys < TRACE_NONE
+ *    cutoff > 0
+ *
+ *  Postconditions
+ *    p_trace has no active traces.
+ *    p_trace must be released with trace_free.
+ *    Any failure causes program exit.
+ */
+trace_list *
+trace_create (unsigned int numKeys, double cutoff);
+
+
+/*  Procedure
+ *    trace_free
+ *
+ *  Purpose
+ *    Release a trace list
+ *
+ *  Parameters
+ *    p_trace
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_trace was produced by trace_create
+ *
+ *  Postconditions
+ *    All memory for p_trace is freed
+ */
+void
+trace_free (trace_list * p_trace);
+
+
+/*  Procedure
+ *    trace_clear
+ *
+ *  Purpose
+ *    Drop every active trace (e.g., at the end of an episode)
+ *
+ *  Parameters
+ *    p_trace
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_trace was produced by trace_create
+ *
+ *  Postconditions
+ *    p_trace has no active traces. Takes time proportional to those
+ *    that were.
+ */
+void
+trace_clear (trace_list * p_trace);
+
+
+/*  Procedure
+ *    trace_visit
+ *
+ *  Purpose
+ *    Make a key fully eligible
+ *
+ *  Parameters
+ *    p_trace
+ *    key
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    key < p_trace->numKeys
+ *
+ *  Postconditions
+ *    The trace of key is 1, and it is active
+ */
+void
+trace_visit (trace_list * p_trace, unsigned int key);
+
+
+/*  Procedure
+ *    trace_drop
+ *
+ *  Purpose
+ *    Make a key ineligible
+ *
+ *  Parameters
+ *    p_trace
+ *    key
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    key < p_trace->numKeys
+ *
+ *  Postconditions
+ *    key has no active trace. The order of the active traces may have
+ *    changed.
+ */
+void
+trace_drop (trace_list * p_trace, unsigned int key);
+
+
+/*  Procedure
+ *    trace_decay
+ *
+ *  Purpose
+ *    Scale every active trace, dropping those that fall below the cutoff
+ *
+ *  Parameters
+ *    p_trace
+ *    factor
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    0 <= factor <= 1
+ *
+ *  Postconditions
+ *    Every trace was multiplied by factor; those now less than
+ *    p_trace->cutoff are no longer active. The order of the active
+ *    traces may have changed.
+ */
+void
+trace_decay (trace_list * p_trace, double factor);
+
+#endif // __TRACE_H__
@@ -0,0 +1,354 @@
+/*
+ * File
+ *   trajlog.c
+ *
+ * Summary
+ *   Trajectory logs written through a lock-free ring buffer by a
+ *   background thread, and their replay.
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "mdp.h"
+#include "environment.h"
+#include "trajlog.h"
+#include "instrument.h"
+
+// Index mask of the ring buffer
+#define TRAJLOG_RING_MASK (TRAJLOG_RING_STEPS - 1)
+
+// Steps read from a log at a time during replay
+#define TRAJLOG_REPLAY_CHUNK 4096
+
+// Pause of the writer when the ring buffer is empty (nanoseconds)
+#define TRAJLOG_IDLE_NS 100000
+
+struct trajlog {
+  // Producer's cache line
+  unsigned long head __attribute__((aligned(64))); /* Steps recorded */
+  const mdp *   p_mdp;     /* MDP being recorded, for its terminal states */
+  rl_agent      inner;     /* Agent wrapped by trajlog_agent */
+
+  // Consumer's cache line
+  unsigned long tail __attribute__((aligned(64))); /* Steps written */
+  bool          closing;   /* Set when no more steps will be recorded */
+  int           error;     /* errno of the first failed write, or 0 */
+  FILE *        file;      /* Destination of the log */
+  pthread_t     writer;    /* Thread draining the ring to file */
+
+  trajlog_step  ring[TRAJLOG_RING_STEPS] __attribute__((aligned(64)));
+};
+
+
+/*  Procedure
+ *    writer_main
+ *
+ *  Purpose
+ *    Write recorded steps to file until the log is closed and drained
+ */
+static void *
+writer_main (void * arg)
+{
+  trajlog * p_log = arg;
+  unsigned long tail = p_log->tail;
+  const struct timespec idle = { 0, TRAJLOG_IDLE_NS };
+
+  while (1)
+  {
+    // Read closing before head, so a final step cannot be missed
+    bool closing = __atomic_load_n (&p_log->closing, __ATOMIC_ACQUIRE);
+    unsigned long head = __atomic_load_n (&p_log->head, __ATOMIC_ACQUIRE);
+
+    if (head == tail)
+    {
+      if (closing)
+        break;
+      nanosleep (&idle, NULL);
+      continue;
+    }
+
+    // Write the available steps, in two pieces if they wrap around
+    while (tail != head)
+    {
+      unsigned long first = tail & TRAJLOG_RING_MASK;
+      unsigned long count = head - tail;
+
+      if (count > TRAJLOG_RING_STEPS - first)
+        count = TRAJLOG_RING_STEPS - first;
+
+      if (0 == p_log->error &&
+          fwrite (p_log->ring + first, sizeof(trajlog_step), count,
+                  p_log->file) != count)
+        p_log->error = errno ? errno : EIO;
+
+      tail += count;
+    }
+
+    // Release the written slots to the producer
+    __atomic_store_n (&p_log->tail, tail, __ATOMIC_RELEASE);
+  }
+
+  return NULL;
+} // writer_main
+
+
+////////////////////////////////////////////////////////////////////////////////
+trajlog *
+trajlog_open (const char * path, const mdp * p_mdp)
+{
+  trajlog * p_log;
+  trajlog_header header;
+
+  if (0 != posix_memalign ((void**)&p_log, 64, sizeof(trajlog)))
+  {
+    fprintf (stderr,"trajlog_open: Unable to allocate log for %s\n", path);
+    return NULL;
+  }
+
+  p_log->head = 0;
+  p_log->tail = 0;
+  p_log->closing = false;
+  p_log->error = 0;
+  p_log->p_mdp = p_mdp;
+  p_log->file = fopen (path, "wb");
+
+  if (NULL == p_log->file)
+  {
+    fprintf (stderr,"trajlog_open: Unable to open %s (%s)\n", path,
+             strerror (errno));
+    free (p_log);
+    return NULL;
+  }
+
+  memcpy (header.magic, TRAJLOG_MAGIC, sizeof(header.magic));
+  header.numStates = p_mdp->numStates;
+  header.numActions = p_mdp->numActions;
+
+  if (fwrite (&header, sizeof(header), 1, p_log->file) != 1)
+  {
+    fprintf (stderr,"trajlog_open: Unable to write %s (%s)\n", path,
+             strerror (errno));
+    fclose (p_log->file);
+    free (p_log);
+    return NULL;
+  }
+
+  if (0 != pthread_create (&p_log->writer, NULL, writer_main, p_log))
+  {
+    fprintf (stderr,"trajlog_open: Unable to start writer for %s\n", path);
+    fclose (p_log->file);
+    free (p_log);
+    return NULL;
+  }
+
+  return p_log;
+} // trajlog_open
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+trajlog_record (trajlog * p_log, unsigned int state, unsigned int action,
+                double reward)
+{
+  unsigned long head = p_log->head; // Only this thread writes head
+
+  // Wait for the writer when the ring is full
+  while (head - __atomic_load_n (&p_log->tail, __ATOMIC_ACQUIRE) ==
+         TRAJLOG_RING_STEPS)
+    sched_yield ();
+
+  trajlog_step * p_step = p_log->ring + (head & TRAJLOG_RING_MASK);
+
+  p_step->state = state;
+  p_step->action = action;
+  p_step->reward = reward;
+
+  // Publish the step to the writer
+  __atomic_store_n (&p_log->head, head + 1, __ATOMIC_RELEASE);
+} // trajlog_record
+
+
+/*  Procedure
+ *    recording_action
+ *
+ *  Purpose
+ *    Act as the wrapped agent, recording the step
+ */
+static unsigned int
+recording_action (void * context, unsigned int state, double reward)
+{
+  trajlog * p_log = context;
+  unsigned int action = p_log->inner.action (p_log->inner.context, state,
+                                             reward);
+
+  trajlog_record (p_log, state,
+                  MDP_IS_TERMINAL(p_log->p_mdp, state) ?
+                  TRAJLOG_TERMINAL : action,
+                  reward);
+
+  return action;
+} // recording_action
+
+
+/*  Procedure
+ *    recording_truncate
+ *
+ *  Purpose
+ *    Tell the wrapped agent of a truncated trial, recording a marker
+ */
+static void
+recording_truncate (void * context)
+{
+  trajlog * p_log = context;
+
+  if (NULL != p_log->inner.truncate)
+    p_log->inner.truncate (p_log->inner.context);
+
+  trajlog_record (p_log, 0, TRAJLOG_TRUNCATED, 0.0);
+} // recording_truncate
+
+
+////////////////////////////////////////////////////////////////////////////////
+rl_agent
+trajlog_agent (trajlog * p_log, const rl_agent * p_inner)
+{
+  rl_agent agent = { p_log, recording_action, recording_truncate };
+
+  p_log->inner = *p_inner;
+
+  return agent;
+} // trajlog_agent
+
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+trajlog_close (trajlog * p_log)
+{
+  bool success;
+
+  __atomic_store_n (&p_log->closing, true, __ATOMIC_RELEASE);
+  pthread_join (p_log->writer, NULL);
+
+  if (0 != fclose (p_log->file) && 0 == p_log->error)
+    p_log->error = errno;
+
+  success = (0 == p_log->error);
+
+  if (!success)
+    fprintf (stderr,"trajlog_close: Failed to write log (%s)\n",
+             strerror (p_log->error));
+
+  free (p_log);
+
+  return success;
+} // trajlog_close
+
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+trajlog_replay (const char * path, const mdp * p_mdp, const rl_agent * p_agent,
+                trajlog_replay_stats * p_stats)
+{
+  trajlog_replay_stats stats = { 0, 0, 0, 0 };
+  trajlog_header header;
+  trajlog_step * chunk;
+  size_t count, i;
+  bool success = true;
+
+  INSTRUMENT_PHASE_BEGIN (start);
+
+  FILE * file = fopen (path, "rb");
+
+  if (NULL == file)
+  {
+    fprintf (stderr,"trajlog_replay: Unable to open %s (%s)\n", path,
+             strerror (errno));
+    return false;
+  }
+
+  if (fread (&header, sizeof(header), 1, file) != 1 ||
+      0 != memcmp (header.magic, TRAJLOG_MAGIC, sizeof(header.magic)))
+  {
+    fprintf (stderr,"trajlog_replay: %s is not a trajectory log\n", path);
+    fclose (file);
+    return false;
+  }
+
+  if (header.numStates != p_mdp->numStates ||
+      header.numActions != p_mdp->numActions)
+  {
+    fprintf (stderr,"trajlog_replay: %s records %u states and %u actions, "
+             "not %u and %u\n", path, header.numStates, header.numActions,
+             p_mdp->numStates, p_mdp->numActions);
+    fclose (file);
+    return false;
+  }
+
+  chunk = malloc (sizeof(trajlog_step) * TRAJLOG_REPLAY_CHUNK);
+
+  if (NULL == chunk)
+  {
+    fprintf (stderr,"trajlog_replay: Unable to allocate buffer (%s)\n",
+             strerror (errno));
+    fclose (file);
+    return false;
+  }
+
+  while (success &&
+         (count = fread (chunk, sizeof(trajlog_step), TRAJLOG_REPLAY_CHUNK,
+                         file)) > 0)
+    for (i=0 ; i < count ; i++)
+    {
+      const trajlog_step * p_step = chunk + i;
+
+      if (TRAJLOG_TRUNCATED == p_step->action)
+      {
+        if (NULL != p_agent->truncate)
+          p_agent->truncate (p_agent->context);
+        stats.truncated++;
+        continue;
+      }
+
+      if (p_step->state >= p_mdp->numStates ||
+          (p_step->action >= p_mdp->numActions &&
+           p_step->action != TRAJLOG_TERMINAL))
+      {
+        fprintf (stderr,"trajlog_replay: Invalid step %llu in %s\n",
+                 stats.steps, path);
+        success = false;
+        break;
+      }
+
+      unsigned int action = p_agent->action (p_agent->context, p_step->state,
+                                             p_step->reward);
+      stats.steps++;
+
+      if (TRAJLOG_TERMINAL == p_step->action)
+        stats.episodes++;
+      else if (action != p_step->action)
+        stats.mismatches++;
+    }
+
+  if (success && ferror (file))
+  {
+    fprintf (stderr,"trajlog_replay: Failed to read %s\n", path);
+    success = false;
+  }
+
+  free (chunk);
+  fclose (file);
+
+  if (NULL != p_stats)
+    *p_stats = stats;
+
+  INSTRUMENT_PHASE_END (INSTRUMENT_REPLAY, start);
+
+  return success;
+} // trajlog_replay
@@ -0,0 +1,204 @@
+/*
+ * File
+ *   trajlog.h
+ *
+ * Summary
+ *   Recording of simulated experience to a compact binary log, and replay
+ *   of a log to an agent without resimulating.
+ *
+ *   A log is a trajlog_header followed by one trajlog_step per agent call,
+ *   in order. Each step holds the state and reward given to the agent and
+ *   the action it took; the successor of a step is the state of the next
+ *   step. A step in a terminal state has action TRAJLOG_TERMINAL and ends
+ *   its episode. An episode cut short by the environment's limits ends
+ *   with a marker step whose action is TRAJLOG_TRUNCATED (and whose state
+ *   and reward are zero); it is not given to agents. All fields are in the
+ *   byte order of the recording host.
+ *
+ *   Steps are recorded through a single-producer, single-consumer ring
+ *   buffer that a background thread drains to the file, so the simulation
+ *   never waits on I/O unless the writer falls a whole ring behind.
+ *
+ */
+#ifndef __TRAJLOG_H__
+#define __TRAJLOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mdp.h"
+#include "environment.h"
+
+/* Identifies trajectory logs; the final byte is the format version */
+#define TRAJLOG_MAGIC "MDPTRAJ\001"
+
+/* Action recorded for a step in a terminal state */
+#define TRAJLOG_TERMINAL UINT32_MAX
+
+/* Action of the marker ending a truncated episode */
+#define TRAJLOG_TRUNCATED (UINT32_MAX - 1)
+
+/* Number of steps the ring buffer holds (a power of two) */
+#define TRAJLOG_RING_STEPS 65536
+
+typedef struct {
+  char     magic[8];   /* TRAJLOG_MAGIC */
+  uint32_t numStates;  /* Number of states of the recorded MDP */
+  uint32_t numActions; /* Number of actions of the recorded MDP */
+} trajlog_header;
+
+typedef struct {
+  uint32_t state;      /* State given to the agent */
+  uint32_t action;     /* Action taken, or TRAJLOG_TERMINAL */
+  double   reward;     /* Reward given to the agent */
+} trajlog_step;
+
+typedef struct trajlog trajlog;
+
+typedef struct {
+  unsigned long long steps;      /* Steps given to the agent */
+  unsigned long long episodes;   /* Complete episodes given to the agent */
+  unsigned long long truncated;  /* Truncated episodes given to the agent */
+  unsigned long long mismatches; /* Non-terminal steps where the agent's
+                                    action differed from the recorded one */
+} trajlog_replay_stats;
+
+
+/*  Procedure
+ *    trajlog_open
+ *
+ *  Purpose
+ *    Create a log file and start its writer thread
+ *
+ *  Parameters
+ *    path
+ *    p_mdp
+ *
+ *  Produces
+ *    p_log, a trajlog*
+ *
+ *  Preconditions
+ *    p_mdp points to a valid mdp that outlives p_log
+ *
+ *  Postconditions
+ *    Upon success, path holds a header for p_mdp and p_log is ready to
+ *    record; it must be released with trajlog_close.
+ *    Upon failure, a message is printed and p_log is NULL.
+ */
+trajlog *
+trajlog_open (const char * path, const mdp * p_mdp);
+
+
+/*  Procedure
+ *    trajlog_record
+ *
+ *  Purpose
+ *    Append a step to a log
+ *
+ *  Parameters
+ *    p_log
+ *    state
+ *    action
+ *    reward
+ *
+ *  Produces
+ *    [Nothing.]
+ *
+ *  Preconditions
+ *    p_log was produced by trajlog_open; only one thread records to it
+ *
+ *  Postconditions
+ *    The step is queued for writing. The caller waits only when the ring
+ *    buffer is full.
+ */
+void
+trajlog_record (trajlog * p_log, unsigned int state, unsigned int action,
+                double reward);
+
+
+/*  Procedure
+ *    trajlog_agent
+ *
+ *  Purpose
+ *    Wrap an agent so that every step it is given is recorded
+ *
+ *  Parameters
+ *    p_log
+ *    p_inner
+ *
+ *  Produces
+ *    agent, an rl_agent
+ *
+ *  Preconditions
+ *    p_log was produced by trajlog_open
+ *    *p_inner is an agent for the MDP of p_log
+ *
+ *  Postconditions
+ *    agent acts as *p_inner does, recording each state, reward and action
+ *    (TRAJLOG_TERMINAL in terminal states) to p_log, and recording a
+ *    TRAJLOG_TRUNCATED marker when told of a truncated trial.
+ *    Only one agent per log may be in use at a time.
+ */
+rl_agent
+trajlog_agent (trajlog * p_log, const rl_agent * p_inner);
+
+
+/*  Procedure
+ *    trajlog_close
+ *
+ *  Purpose
+ *    Flush a log, stop its writer and close its file
+ *
+ *  Parameters
+ *    p_log
+ *
+ *  Produces
+ *    success, a bool
+ *
+ *  Preconditions
+ *    p_log was produced by trajlog_open
+ *
+ *  Postconditions
+ *    success is true when every recorded step was written; otherwise a
+ *    message is printed.
+ *    All memory for p_log is freed.
+ */
+bool
+trajlog_close (trajlog * p_log);
+
+
+/*  Procedure
+ *    trajlog_replay
+ *
+ *  Purpose
+ *    Feed the episodes of a log to an agent
+ *
+ *  Parameters
+ *    path
+ *    p_mdp
+ *    p_agent
+ *    p_stats
+ *
+ *  Produces
+ *    success, a bool
+ *
+ *  Preconditions
+ *    p_mdp is the MDP p_agent acts in
+ *    p_stats is NULL or points to a trajlog_replay_stats
+ *
+ *  Postconditions
+ *    p_agent->action has been called with the state and reward of every
+ *    step, in recorded order, until the end of the log, and
+ *    p_agent->truncate (when not NULL) at every truncation marker. Replay
+ *    is exact
+ *    for agents whose actions agree with the recorded ones (such as the
+ *    same fixed policy); p_stats->mismatches counts disagreements.
+ *    An incomplete final episode is given to the agent but not counted.
+ *    success is false (with a message printed) if the log cannot be read
+ *    or does not match p_mdp.
+ */
+bool
+trajlog_replay (const char * path, const mdp * p_mdp, const rl_agent * p_agent,
+                trajlog_replay_stats * p_stats);
+
+#endif // __TRAJLOG_H__
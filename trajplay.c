@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "mdp.h"
+#include "environment.h"
+#include "td_agent.h"
+#include "trajlog.h"
+
+/* Process command-line arguments, verifying usage */
+void
+process_args (int argc, char * argv[], double * gamma, double * lambda );
+
+/*
+ * Usage: trajplay gamma mdpfile logfile [lambda] < policy
+ *
+ * Replays the episodes of a trajectory log (as recorded by td or qlearn
+ * with MDP_TRAJLOG set; see trajlog.h) to a Passive-TD-Agent following a
+ * fixed policy read from standard input, without simulating the
+ * environment, and prints the utilities learned as td does.
+ *
+ * Replaying a log recorded by td with the same policy, gamma and lambda
+ * reproduces its utilities exactly. Steps at which the policy disagrees
+ * with the recorded action are counted and reported, since the agent then
+ * learns from experience it would not have had.
+ */
+int
+main (int argc, char* argv[])
+{
+  // Read and process configurations
+  double gamma, lambda;
+
+  process_args (argc, argv, &gamma, &lambda);
+
+  // Initialize environment, for the MDP structure alone
+  environment * p_env = env_create (argv[2]);
+
+  // Create Passive-TD-Agent, reading its policy from stdin
+  td_agent * p_agent = td_agent_create (env_get_structure (p_env), gamma,
+                                        lambda);
+  mdp * p_mdp = p_agent->p_mdp;
+
+  mdp_read_policy (stdin, p_mdp, p_agent->policy);
+
+  // Replay!
+  rl_agent agent = td_agent_interface (p_agent);
+  trajlog_replay_stats stats;
+
+  if (!trajlog_replay (argv[3], p_mdp, &agent, &stats))
+    exit (EXIT_FAILURE);
+
+  fprintf (stderr, "%s: %llu steps, %llu episodes and %llu truncated "
+           "episodes replayed; %llu actions differed from the policy\n",
+           argv[0], stats.steps, stats.episodes, stats.truncated,
+           stats.mismatches);
+
+  // Print utilities
+  unsigned int state;
+  for ( state=0 ; state < p_mdp->numStates ; state++)
+    if (p_mdp->numAvailableActions[state] > 0 || p_mdp->terminal[state] )
+      printf ("%1.3f\n", p_agent->utilities[state]);
+    else
+      printf("X\n");
+
+  td_agent_free (p_agent);
+  env_free (p_env);
+
+  return 0;
+} // main
+
+
+/* Process command-line arguments, verifying usage */
+void
+process_args (int argc, char * argv[], double * gamma, double * lambda )
+{
+  if (argc < 4 || argc > 5)
+  {
+    fprintf (stderr,"Usage: %s gamma mdpfile logfile [lambda] < policy\n",
+             argv[0]);
+    exit (EXIT_FAILURE);
+  }
+
+  char * endptr; // String End Location for number parsing
+
+  // Read gamma, the discount factor, as a double
+  *gamma = strtod (argv[1], &endptr);
+
+  if ( (endptr - argv[1])/sizeof(char) < strlen (argv[1]) )
+  {
+    fprintf (stderr, "%s: Illegal non-numeric value in argument gamma=%s\n",
+             argv[0], argv[1]);
+    exit (EXIT_FAILURE);
+  }
+
+  // Read lambda, the trace decay, as a double
+  *lambda = 0;
+
+  if (5 == argc)
+  {
+    *lambda = strtod (argv[4], &endptr);
+
+    if ( (endptr - argv[4])/sizeof(char) < strlen (argv[4]) ||
+         *lambda < 0 || *lambda > 1 )
+    {
+      fprintf (stderr, "%s: Illegal value in argument lambda=%s\n",
+               argv[0], argv[4]);
+      exit (EXIT_FAILURE);
+    }
+  }
+
+} // process_args
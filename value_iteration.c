@@ -4,72 +4,79 @@
 #include <errno.h>
 #include <math.h>
 
-#include "utilities.h"
 #include "mdp.h"
+#include "mdpsolve.h"
+#include "minimize.h"
 
 /* Process command-line arguments, verifying usage */
 void
 process_args (int argc, char* argv[], double * gamma, double * epsilon,
-              mdp ** p_mdp );
+              mdp ** p_mdp, bool * minimize );
 
 
+/*  Procedure
+ *    value_iteration
+ *
+ *  Purpose
+ *    Estimate state utilities by repeated Bellman updates
+ *
+ *  Parameters
+ *   p_mdp
+ *   epsilon
+ *   gamma
+ *   utilities
+ *
+ *  Produces,
+ *   [Nothing.]
+ *
+ *  Preconditions
+ *    p_mdp is a pointer to a valid, complete mdp
+ *    epsilon > 0
+ *    0 < gamma < 1
+ *    utilities points to a valid array of length p_mdp->numStates
+ *
+ *  Postconditions
+ *    utilities[s] holds the utility of state s, within epsilon of the
+ *    true utility. Any failure causes program exit.
+ */
 void
 value_iteration ( const mdp * p_mdp, double epsilon, double gamma,
                   double* utilities)
 {
- 
-  int util_length = p_mdp->numStates;
-  size_t util_bytes = util_length * sizeof(double);
+  mdpsolve_options options;
+  mdpsolve_context * p_ctx = mdpsolve_create (p_mdp->numStates, 1);
 
-  // make updated utilities 
-  double* util_update = (double*) calloc(util_length, sizeof(double));
-  
-   // utilities initially zero
-  bzero(utilities, util_bytes);
+  if (NULL == p_ctx)
+  {
+    fprintf (stderr, "value_iteration: Unable to create solver (%s)\n",
+             strerror (errno));
+    exit (EXIT_FAILURE);
+  }
 
-  double delta;
-  
-  do
-    {
-      memcpy(utilities, util_update, util_bytes);
-     
-      delta = 0;
-      for(unsigned int state = 0; state < p_mdp->numStates; state++)
-        {
-          if(p_mdp->terminal[state])
-            {
-              util_update[state] = p_mdp->rewards[state];
-            } else
-            {
-              double meu = 0;
-              unsigned int action;
-              calc_meu(p_mdp, state, utilities, &meu, &action);
-          
-              util_update[state] = p_mdp->rewards[state] + gamma * meu;
-            }
-          
-          if(fabs(util_update[state] - utilities[state]) > delta)
-            delta = fabs(util_update[state] - utilities[state]);
-            
-        }
-    } while (delta > (epsilon * (1 - gamma))/ gamma); // ????????????????????
-  
-  for(int i = 0; i < util_length; i++) {
-    printf("utilities: %f\n", utilities[i]);
-    printf("util_update: %f\n", util_update[i]);
+  mdpsolve_default_options (&options);
+  options.algorithm = MDPSOLVE_VALUE_ITERATION;
+  options.gamma = gamma;
+  options.epsilon = epsilon;
+
+  if (MDPSOLVE_SUCCESS != mdpsolve_solve (p_ctx, p_mdp, &options, utilities,
+                                          NULL, NULL))
+  {
+    fprintf (stderr, "value_iteration: Solver failed (check gamma=%f and "
+             "epsilon=%f)\n", gamma, epsilon);
+    exit (EXIT_FAILURE);
   }
-  
-  // free utilities
-  free(util_update);
 
+  mdpsolve_free (p_ctx);
 } // value_iteration
 
 
 /*
- * Main: value_iteration gamma epsilon mdpfile
+ * Main: value_iteration [-m] gamma epsilon mdpfile
  *
  * Runs value_iteration algorithm using gamma and with max
  * error of epsilon on utilities of states using MDP in mdpfile.
+ * With -m, the bisimulation quotient of the MDP is solved instead and
+ * its utilities are lifted back to the original states.
  *
  * Author: Jerod Weinman
  */
@@ -79,8 +86,9 @@ main (int argc, char* argv[])
   // Read and process configurations
   double gamma, epsilon;
   mdp *p_mdp;
+  bool minimize;
 
-  process_args (argc,argv,&gamma,&epsilon,&p_mdp);
+  process_args (argc,argv,&gamma,&epsilon,&p_mdp,&minimize);
 
   // Allocate utility array
   double * utilities = malloc ( sizeof(double) * p_mdp->numStates );
@@ -93,8 +101,43 @@ main (int argc, char* argv[])
     exit (EXIT_FAILURE);
   }
 
-  // Run value iteration!
-  value_iteration ( p_mdp, epsilon, gamma, utilities);
+  if (minimize)
+  {
+    // Partition states into bisimilar blocks and solve the quotient
+    unsigned int * block = malloc ( sizeof(unsigned int) * p_mdp->numStates );
+
+    if (NULL == block)
+    {
+      fprintf(stderr,
+              "%s: Unable to allocate block (%s)",
+              argv[0], strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+    mdp * p_quotient = mdp_minimize (p_mdp, MDP_MINIMIZE_TOLERANCE, block);
+    double * quotientUtilities = malloc ( sizeof(double) * 
+                                          p_quotient->numStates );
+
+    if (NULL == quotientUtilities)
+    {
+      fprintf(stderr,
+              "%s: Unable to allocate quotient utilities (%s)",
+              argv[0], strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+    // Run value iteration on the (smaller) quotient!
+    value_iteration ( p_quotient, epsilon, gamma, quotientUtilities);
+
+    mdp_lift_utilities (p_mdp->numStates, block, quotientUtilities, utilities);
+
+    free (quotientUtilities);
+    free (block);
+    mdp_free (p_quotient);
+  }
+  else
+    // Run value iteration!
+    value_iteration ( p_mdp, epsilon, gamma, utilities);
 
   // Print utilities
   unsigned int state;
@@ -114,36 +157,42 @@ main (int argc, char* argv[])
 /* Process command-line arguments, verifying usage */
 void
 process_args  (int argc, char * argv[], double * gamma, double * epsilon,
-               mdp ** p_mdp )
+               mdp ** p_mdp, bool * minimize )
 { 
-  if (argc != 4)
+  // Optional leading -m flag requests model minimization
+  *minimize = (argc == 5 && 0 == strcmp (argv[1], "-m"));
+
+  int arg = *minimize ? 2 : 1; // Index of first positional argument
+
+  if (argc != arg + 3)
   {
-    fprintf (stderr,"Usage: %s gamma epsilon mdpfile\n",argv[0]);
+    fprintf (stderr,"Usage: %s [-m] gamma epsilon mdpfile\n",argv[0]);
     exit (EXIT_FAILURE);
   }
 
   char * endptr; // String End Location for number parsing
   
-  *gamma = strtod(argv[1], &endptr); // Read gamma, the discount factor
+  *gamma = strtod(argv[arg], &endptr); // Read gamma, the discount factor
   
-  if ( (endptr - argv[1]) < strlen(argv[1]) ) 
+  if ( (endptr - argv[arg]) < strlen(argv[arg]) ) 
   { // Error: The entire argument was not consumed by the conversion
     fprintf (stderr, "%s: Illegal non-numeric value in argument gamma=%s\n",
-             argv[0], argv[1]);
+             argv[0], argv[arg]);
     exit (EXIT_FAILURE);
   }
   
   // Read epsilon, maximum allowable state utility error
-  *epsilon = strtod(argv[2], &endptr); 
+  *epsilon = strtod(argv[arg+1], &endptr); 
   
-  if ( (endptr - argv[2]) < strlen(argv[2]) )
+  if ( (endptr - argv[arg+1]) < strlen(argv[arg+1]) )
   { // Error: The entire argument was not consumed by the conversion
     fprintf (stderr, "%s: Illegal non-numeric value in argument epsilon=%s\n",
-             argv[0], argv[2]);
+             argv[0], argv[arg+1]);
     exit (EXIT_FAILURE);
   }
   
-  *p_mdp = mdp_read (argv[3]); // Read MDP file (exits with message if error)
+  // Read MDP file (exits with message if error)
+  *p_mdp = mdp_read (argv[arg+2]);
 
   if (NULL == *p_mdp)
   { // mdp_read prints a message